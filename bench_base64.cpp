@@ -0,0 +1,81 @@
+#include <QCoreApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include "src/core/Base64.h"
+#include <limits>
+
+using namespace DatasetCreator;
+
+namespace {
+
+// Best of several runs, in MB/s of unencoded payload
+template <typename Fn>
+double throughput(qsizetype payloadBytes, int iterations, Fn&& fn) {
+    qint64 best = std::numeric_limits<qint64>::max();
+    for (int run = 0; run < 5; ++run) {
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < iterations; ++i) {
+            fn();
+        }
+        best = qMin(best, timer.nsecsElapsed());
+    }
+    return double(payloadBytes) * iterations / (double(qMax<qint64>(best, 1)) / 1e9) / 1e6;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+
+    qDebug() << "=== Base64 Benchmark: Base64 vs QByteArray ===\n";
+
+    // Small binary blobs, audio clips and images
+    const QList<qsizetype> sizes = {256, 16 * 1024, 1024 * 1024, 16 * 1024 * 1024};
+    bool allMatch = true;
+
+    for (qsizetype size : sizes) {
+        QByteArray payload(size, Qt::Uninitialized);
+        QRandomGenerator generator(42);
+        generator.fillRange(reinterpret_cast<quint32*>(payload.data()), size / 4);
+
+        const QByteArray qtEncoded = payload.toBase64();
+        const QByteArray encoded = Base64::encode(payload);
+        const bool match = encoded == qtEncoded && Base64::decode(encoded) == payload;
+        allMatch = allMatch && match;
+
+        const int iterations = int(qMax<qsizetype>(1, (64 * 1024 * 1024) / size));
+        volatile qsizetype sink = 0;
+
+        const double qtEncode = throughput(size, iterations, [&] { sink = payload.toBase64().size(); });
+        const double simdEncode = throughput(size, iterations, [&] { sink = Base64::encode(payload).size(); });
+        const double qtDecode = throughput(size, iterations, [&] { sink = QByteArray::fromBase64(encoded).size(); });
+        const double simdDecode = throughput(size, iterations, [&] { sink = Base64::decode(encoded).size(); });
+
+        // Decoding into a buffer the caller already owns, as fromVariantMap() does
+        QByteArray scratch;
+        const double inPlaceDecode = throughput(size, iterations, [&] {
+            scratch = encoded;
+            scratch.detach();
+            Base64::decodeInPlace(scratch);
+            sink = scratch.size();
+        });
+
+        qDebug().noquote() << QString("%1 bytes:").arg(size, 9)
+                           << QString("encode Qt %1 MB/s, Base64 %2 MB/s (x%3);")
+                                  .arg(qtEncode, 0, 'f', 0).arg(simdEncode, 0, 'f', 0)
+                                  .arg(simdEncode / qtEncode, 0, 'f', 1)
+                           << QString("decode Qt %1 MB/s, Base64 %2 MB/s (x%3), in place %4 MB/s")
+                                  .arg(qtDecode, 0, 'f', 0).arg(simdDecode, 0, 'f', 0)
+                                  .arg(simdDecode / qtDecode, 0, 'f', 1).arg(inPlaceDecode, 0, 'f', 0)
+                           << (match ? "" : "MISMATCH");
+    }
+
+    // Lenient input must still decode as Qt does
+    const QByteArray messy = "SGVs bG8s\nIHdv=cmxk IQ";
+    const bool lenientMatch = Base64::decode(messy) == QByteArray::fromBase64(messy);
+    qDebug() << "\nLenient input matches Qt:" << lenientMatch;
+
+    return allMatch && lenientMatch ? 0 : 1;
+}
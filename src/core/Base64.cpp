@@ -0,0 +1,353 @@
+#include "Base64.h"
+#include <array>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define DATASETCREATOR_BASE64_X86
+#include <immintrin.h>
+#define BASE64_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+namespace DatasetCreator {
+
+namespace {
+
+constexpr char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// Six-bit value of each character, -1 outside the alphabet (including '=')
+constexpr std::array<qint8, 256> makeDecodeTable() {
+    std::array<qint8, 256> table{};
+    for (auto& entry : table) {
+        entry = -1;
+    }
+    for (int i = 0; i < 64; ++i) {
+        table[uchar(alphabet[i])] = qint8(i);
+    }
+    return table;
+}
+
+constexpr std::array<qint8, 256> decodeTable = makeDecodeTable();
+
+} // namespace
+
+void Base64::encode(QByteArrayView data, char* out) {
+    const uchar* in = reinterpret_cast<const uchar*>(data.data());
+    qsizetype size = data.size();
+
+    qsizetype done = 0;
+    switch (isa()) {
+        case Isa::Avx2: done = encodeBlocksAvx2(in, size, out); break;
+        case Isa::Ssse3: done = encodeBlocksSsse3(in, size, out); break;
+        case Isa::Scalar: break;
+    }
+    in += done;
+    size -= done;
+    out += done / 3 * 4;
+
+    while (size >= 3) {
+        const quint32 bits = (quint32(in[0]) << 16) | (quint32(in[1]) << 8) | in[2];
+        out[0] = alphabet[bits >> 18];
+        out[1] = alphabet[(bits >> 12) & 0x3f];
+        out[2] = alphabet[(bits >> 6) & 0x3f];
+        out[3] = alphabet[bits & 0x3f];
+        in += 3;
+        size -= 3;
+        out += 4;
+    }
+
+    if (size > 0) {
+        const quint32 bits = (quint32(in[0]) << 16) | (size == 2 ? quint32(in[1]) << 8 : 0);
+        out[0] = alphabet[bits >> 18];
+        out[1] = alphabet[(bits >> 12) & 0x3f];
+        out[2] = size == 2 ? alphabet[(bits >> 6) & 0x3f] : '=';
+        out[3] = '=';
+    }
+}
+
+QByteArray Base64::encode(QByteArrayView data) {
+    QByteArray out(encodedSize(data.size()), Qt::Uninitialized);
+    encode(data, out.data());
+    return out;
+}
+
+QByteArray Base64::decode(QByteArrayView base64) {
+    QByteArray out(maxDecodedSize(base64.size()), Qt::Uninitialized);
+    uchar* const dest = reinterpret_cast<uchar*>(out.data());
+
+    qsizetype consumed = 0;
+    qsizetype written = decodeGroups(base64.data(), base64.size(), dest, &consumed);
+    written += decodeTail(base64.data() + consumed, base64.size() - consumed, dest + written);
+    out.truncate(written);
+    return out;
+}
+
+void Base64::decodeInPlace(QByteArray& data) {
+    // Output never overtakes input: each group of four shrinks to three
+    char* const buffer = data.data();
+    uchar* const dest = reinterpret_cast<uchar*>(buffer);
+
+    qsizetype consumed = 0;
+    qsizetype written = decodeGroups(buffer, data.size(), dest, &consumed);
+    written += decodeTail(buffer + consumed, data.size() - consumed, dest + written);
+    data.truncate(written);
+}
+
+qsizetype Base64::decodeGroups(const char* in, qsizetype size, uchar* out, qsizetype* consumed) {
+    qsizetype done = 0;
+    switch (isa()) {
+        case Isa::Avx2: done = decodeBlocksAvx2(in, size, out); break;
+        case Isa::Ssse3: done = decodeBlocksSsse3(in, size, out); break;
+        case Isa::Scalar: break;
+    }
+    qsizetype read = done;
+    qsizetype written = done / 4 * 3;
+
+    while (size - read >= 4) {
+        const qint32 a = decodeTable[uchar(in[read])];
+        const qint32 b = decodeTable[uchar(in[read + 1])];
+        const qint32 c = decodeTable[uchar(in[read + 2])];
+        const qint32 d = decodeTable[uchar(in[read + 3])];
+        if ((a | b | c | d) < 0) {
+            break;
+        }
+        const quint32 bits = (quint32(a) << 18) | (quint32(b) << 12) | (quint32(c) << 6) | quint32(d);
+        out[written] = uchar(bits >> 16);
+        out[written + 1] = uchar(bits >> 8);
+        out[written + 2] = uchar(bits);
+        read += 4;
+        written += 3;
+    }
+
+    *consumed = read;
+    return written;
+}
+
+qsizetype Base64::decodeTail(const char* in, qsizetype size, uchar* out) {
+    // QByteArray::fromBase64()'s lenient rule: skip anything outside the
+    // alphabet, padding included, and emit each byte as soon as eight bits
+    // have accumulated. Called after whole groups, so no bits are pending.
+    quint32 bits = 0;
+    int count = 0;
+    qsizetype written = 0;
+    for (qsizetype i = 0; i < size; ++i) {
+        const qint32 value = decodeTable[uchar(in[i])];
+        if (value < 0) {
+            continue;
+        }
+        bits = (bits << 6) | quint32(value);
+        count += 6;
+        if (count >= 8) {
+            count -= 8;
+            out[written++] = uchar(bits >> count);
+            bits &= (1u << count) - 1;
+        }
+    }
+    return written;
+}
+
+#if defined(DATASETCREATOR_BASE64_X86)
+
+// Kernels after Muła and Lemire, "Faster Base64 Encoding and Decoding Using
+// AVX2 Instructions": split each three bytes into four six-bit indices with
+// two multiplies, then map indices to characters through a pshufb table of
+// per-range offsets. Decoding runs the same in reverse and validates every
+// character with two nibble lookups.
+
+namespace {
+
+BASE64_TARGET("ssse3")
+inline __m128i encodeIndices128(__m128i in) {
+    in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+    const __m128i high = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00)),
+                                         _mm_set1_epi32(0x04000040));
+    const __m128i low = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003f03f0)),
+                                        _mm_set1_epi32(0x01000010));
+    return _mm_or_si128(high, low);
+}
+
+BASE64_TARGET("ssse3")
+inline __m128i encodeCharacters128(__m128i indices) {
+    // 0..25 -> 13 ('A'), 26..51 -> 0 ('a' - 26), 52..61 -> 1..10 ('0' - 52),
+    // 62 -> 11 ('+' - 62), 63 -> 12 ('/' - 63)
+    const __m128i offsets = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                          '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+                                          '/' - 63, 'A', 0, 0);
+    __m128i range = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+    const __m128i upper = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+    range = _mm_or_si128(range, _mm_and_si128(upper, _mm_set1_epi8(13)));
+    return _mm_add_epi8(_mm_shuffle_epi8(offsets, range), indices);
+}
+
+BASE64_TARGET("avx2")
+inline __m256i encodeIndices256(__m256i in) {
+    in = _mm256_shuffle_epi8(in, _mm256_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+                                                 10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+    const __m256i high = _mm256_mulhi_epu16(_mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00)),
+                                            _mm256_set1_epi32(0x04000040));
+    const __m256i low = _mm256_mullo_epi16(_mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0)),
+                                           _mm256_set1_epi32(0x01000010));
+    return _mm256_or_si256(high, low);
+}
+
+BASE64_TARGET("avx2")
+inline __m256i encodeCharacters256(__m256i indices) {
+    const __m256i offsets = _mm256_setr_epi8(
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    __m256i range = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+    const __m256i upper = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+    range = _mm256_or_si256(range, _mm256_and_si256(upper, _mm256_set1_epi8(13)));
+    return _mm256_add_epi8(_mm256_shuffle_epi8(offsets, range), indices);
+}
+
+// Nibble tables: a character is valid when its low- and high-nibble entries
+// share no bit; the roll table, indexed by high nibble ('/' shifted down by
+// one), holds the offset from character to six-bit value
+#define BASE64_DECODE_LO 0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, \
+                         0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a
+#define BASE64_DECODE_HI 0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, \
+                         0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10
+#define BASE64_DECODE_ROLL 0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0
+
+// Returns false, leaving values untouched, when any character is invalid
+BASE64_TARGET("ssse3")
+inline bool decodeValues128(__m128i& values) {
+    const __m128i mask2f = _mm_set1_epi8(0x2f);
+    const __m128i highNibbles = _mm_and_si128(_mm_srli_epi32(values, 4), mask2f);
+    const __m128i lo = _mm_shuffle_epi8(_mm_setr_epi8(BASE64_DECODE_LO), _mm_and_si128(values, mask2f));
+    const __m128i hi = _mm_shuffle_epi8(_mm_setr_epi8(BASE64_DECODE_HI), highNibbles);
+    const __m128i clash = _mm_cmpeq_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128());
+    if (_mm_movemask_epi8(clash) != 0xffff) {
+        return false;
+    }
+    const __m128i slash = _mm_cmpeq_epi8(values, mask2f);
+    const __m128i roll = _mm_shuffle_epi8(_mm_setr_epi8(BASE64_DECODE_ROLL),
+                                          _mm_add_epi8(slash, highNibbles));
+    values = _mm_add_epi8(values, roll);
+    return true;
+}
+
+BASE64_TARGET("ssse3")
+inline __m128i packValues128(__m128i values) {
+    // Merge pairs of six-bit values, then pairs of twelve-bit values, and
+    // gather the three big-endian bytes of each 32-bit lane
+    const __m128i pairs = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+    const __m128i groups = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+    return _mm_shuffle_epi8(groups, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+}
+
+BASE64_TARGET("avx2")
+inline bool decodeValues256(__m256i& values) {
+    const __m256i mask2f = _mm256_set1_epi8(0x2f);
+    const __m256i highNibbles = _mm256_and_si256(_mm256_srli_epi32(values, 4), mask2f);
+    const __m256i lo = _mm256_shuffle_epi8(_mm256_setr_epi8(BASE64_DECODE_LO, BASE64_DECODE_LO),
+                                           _mm256_and_si256(values, mask2f));
+    const __m256i hi = _mm256_shuffle_epi8(_mm256_setr_epi8(BASE64_DECODE_HI, BASE64_DECODE_HI), highNibbles);
+    if (!_mm256_testz_si256(lo, hi)) {
+        return false;
+    }
+    const __m256i slash = _mm256_cmpeq_epi8(values, mask2f);
+    const __m256i roll = _mm256_shuffle_epi8(_mm256_setr_epi8(BASE64_DECODE_ROLL, BASE64_DECODE_ROLL),
+                                             _mm256_add_epi8(slash, highNibbles));
+    values = _mm256_add_epi8(values, roll);
+    return true;
+}
+
+BASE64_TARGET("avx2")
+inline __m256i packValues256(__m256i values) {
+    const __m256i pairs = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+    const __m256i groups = _mm256_madd_epi16(pairs, _mm256_set1_epi32(0x00011000));
+    const __m256i packed = _mm256_shuffle_epi8(groups, _mm256_setr_epi8(
+        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+    // Close the gap between the two 12-byte lanes
+    return _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7));
+}
+
+#undef BASE64_DECODE_LO
+#undef BASE64_DECODE_HI
+#undef BASE64_DECODE_ROLL
+
+} // namespace
+
+BASE64_TARGET("ssse3")
+qsizetype Base64::encodeBlocksSsse3(const uchar* in, qsizetype size, char* out) {
+    // Each step loads 16 bytes and uses 12
+    qsizetype done = 0;
+    for (; size - done >= 16; done += 12, out += 16) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + done));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), encodeCharacters128(encodeIndices128(block)));
+    }
+    return done;
+}
+
+BASE64_TARGET("avx2")
+qsizetype Base64::encodeBlocksAvx2(const uchar* in, qsizetype size, char* out) {
+    // Each step loads 12 + 16 bytes and uses 24
+    qsizetype done = 0;
+    for (; size - done >= 28; done += 24, out += 32) {
+        const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + done));
+        const __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + done + 12));
+        const __m256i block = _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), encodeCharacters256(encodeIndices256(block)));
+    }
+    return done + encodeBlocksSsse3(in + done, size - done, out);
+}
+
+BASE64_TARGET("ssse3")
+qsizetype Base64::decodeBlocksSsse3(const char* in, qsizetype size, uchar* out) {
+    // Each step stores 16 bytes of which 12 are kept; stopping 24 characters
+    // short of the end keeps the spare bytes inside maxDecodedSize(), and
+    // in place they only land on input already loaded
+    qsizetype done = 0;
+    for (; size - done >= 24; done += 16, out += 12) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + done));
+        if (!decodeValues128(block)) {
+            break;
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), packValues128(block));
+    }
+    return done;
+}
+
+BASE64_TARGET("avx2")
+qsizetype Base64::decodeBlocksAvx2(const char* in, qsizetype size, uchar* out) {
+    // As above, with 24 of 32 bytes kept per step
+    qsizetype done = 0;
+    for (; size - done >= 48; done += 32, out += 24) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + done));
+        if (!decodeValues256(block)) {
+            break;
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), packValues256(block));
+    }
+    return done + decodeBlocksSsse3(in + done, size - done, out);
+}
+
+Base64::Isa Base64::isa() {
+    static const Isa detected = [] {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) return Isa::Avx2;
+        if (__builtin_cpu_supports("ssse3")) return Isa::Ssse3;
+        return Isa::Scalar;
+    }();
+    return detected;
+}
+
+#undef BASE64_TARGET
+
+#else
+
+qsizetype Base64::encodeBlocksSsse3(const uchar*, qsizetype, char*) { return 0; }
+qsizetype Base64::encodeBlocksAvx2(const uchar*, qsizetype, char*) { return 0; }
+qsizetype Base64::decodeBlocksSsse3(const char*, qsizetype, uchar*) { return 0; }
+qsizetype Base64::decodeBlocksAvx2(const char*, qsizetype, uchar*) { return 0; }
+
+Base64::Isa Base64::isa() {
+    return Isa::Scalar;
+}
+
+#endif
+
+} // namespace DatasetCreator
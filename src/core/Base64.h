@@ -0,0 +1,56 @@
+#pragma once
+
+#include <QByteArray>
+#include <QByteArrayView>
+
+namespace DatasetCreator {
+
+/**
+ * @brief Base64 codec for sample payloads
+ *
+ * Same results as QByteArray::toBase64() and QByteArray::fromBase64() with
+ * default options, but whole blocks are converted with SSSE3 or AVX2 when
+ * the CPU has them (chosen at runtime), and output goes straight into the
+ * caller's buffer. Decoding handles strict, padded base64 at full speed;
+ * from the first group that is not strictly valid (whitespace, missing
+ * padding, stray characters) a scalar loop follows Qt's lenient rules.
+ */
+class Base64 {
+public:
+    static constexpr qsizetype encodedSize(qsizetype size) { return (size + 2) / 3 * 4; }
+    static constexpr qsizetype maxDecodedSize(qsizetype size) { return size / 4 * 3 + 3; }
+
+    /**
+     * @brief Encode into out, which must have room for encodedSize(data.size()) bytes
+     */
+    static void encode(QByteArrayView data, char* out);
+    static QByteArray encode(QByteArrayView data);
+
+    static QByteArray decode(QByteArrayView base64);
+
+    /**
+     * @brief Decode a buffer the caller owns, replacing its contents
+     */
+    static void decodeInPlace(QByteArray& data);
+
+private:
+    // Decode into out (which may be in), stopping at the first group of four
+    // characters that is not strictly valid; returns the bytes written and
+    // sets consumed to the characters used
+    static qsizetype decodeGroups(const char* in, qsizetype size, uchar* out, qsizetype* consumed);
+
+    // Qt's lenient decoding for whatever decodeGroups() left; out may be in
+    static qsizetype decodeTail(const char* in, qsizetype size, uchar* out);
+
+    // Vector kernels: convert as many whole blocks as they can and return
+    // the input bytes consumed (0 when the CPU lacks the instructions)
+    static qsizetype encodeBlocksSsse3(const uchar* in, qsizetype size, char* out);
+    static qsizetype encodeBlocksAvx2(const uchar* in, qsizetype size, char* out);
+    static qsizetype decodeBlocksSsse3(const char* in, qsizetype size, uchar* out);
+    static qsizetype decodeBlocksAvx2(const char* in, qsizetype size, uchar* out);
+
+    enum class Isa { Scalar, Ssse3, Avx2 };
+    static Isa isa();
+};
+
+} // namespace DatasetCreator
@@ -0,0 +1,207 @@
+#include "BlobStore.h"
+#include <QCryptographicHash>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <algorithm>
+
+namespace DatasetCreator {
+
+BlobStore::BlobStore(const QString& rootPath)
+    : root_(QDir(rootPath).absolutePath())
+{
+}
+
+BlobStore& BlobStore::instance() {
+    static BlobStore store(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/blobs");
+    return store;
+}
+
+QString BlobStore::hashOf(const QByteArray& head, const char* data, qint64 size) {
+    QCryptographicHash hash(QCryptographicHash::Blake2b_256);
+    hash.addData(head);
+    hash.addData(QByteArrayView(data, size));
+    return QString::fromLatin1(hash.result().toHex());
+}
+
+bool BlobStore::isHash(const QString& hash) {
+    return hash.size() == 64 && std::all_of(hash.begin(), hash.end(), [](QChar c) {
+        return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f');
+    });
+}
+
+QString BlobStore::pathFor(const QString& hash) const {
+    return root_ + "/objects/" + hash.left(2) + "/" + hash.mid(2);
+}
+
+QString BlobStore::hashOfPath(const QString& filePath) const {
+    const QString objects = root_ + "/objects/";
+    const QString path = QFileInfo(filePath).absoluteFilePath();
+    if (!path.startsWith(objects)) {
+        return QString();
+    }
+    
+    // objects/ab/cdef... -> abcdef...
+    const QString relative = path.mid(objects.size());
+    if (relative.size() != 65 || relative[2] != '/') {
+        return QString();
+    }
+    const QString hash = relative.left(2) + relative.mid(3);
+    return isHash(hash) ? hash : QString();
+}
+
+bool BlobStore::contains(const QString& hash) const {
+    return isHash(hash) && QFileInfo::exists(pathFor(hash));
+}
+
+void BlobStore::touch(const QString& blobPath) const {
+    // Reused blobs count as new, so collectGarbage() spares them until the
+    // save that reuses them has recorded its references
+    QFile file(blobPath);
+    if (file.open(QIODevice::Append)) {
+        file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+    }
+}
+
+QString BlobStore::put(const QByteArray& head, const char* data, qint64 size) {
+    const QString hash = hashOf(head, data, size);
+    const QString path = pathFor(hash);
+    if (QFileInfo::exists(path)) {
+        touch(path);
+        return hash;
+    }
+    
+    // Concurrent writers of the same blob write identical bytes; whichever
+    // rename lands last wins and the result is the same
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly) ||
+        (!head.isEmpty() && file.write(head) != head.size()) ||
+        (size > 0 && file.write(data, size) != size) ||
+        !file.commit()) {
+        return QString();
+    }
+    return hash;
+}
+
+QString BlobStore::putSource(const PayloadSource& source) {
+    if (!source.isValid()) {
+        return QString();
+    }
+    if (!source.isFile()) {
+        return put(source.bytes);
+    }
+    
+    if (source.offset == 0 && source.length < 0) {
+        const QString hash = hashOfPath(source.path);
+        if (!hash.isEmpty() && QFileInfo::exists(source.path)) {
+            touch(source.path);
+            return hash;
+        }
+    }
+    
+    const QFileInfo info(source.path);
+    const FileKey key{info.absoluteFilePath(), source.offset, source.length, info.size(), info.lastModified()};
+    {
+        QMutexLocker locker(&mutex_);
+        const QString hash = fileHashes_.value(key);
+        if (!hash.isEmpty() && contains(hash)) {
+            touch(pathFor(hash));
+            return hash;
+        }
+    }
+    
+    QFile file(source.path);
+    if (!file.open(QIODevice::ReadOnly) || !file.seek(source.offset)) {
+        return QString();
+    }
+    const QByteArray bytes = source.length < 0 ? file.readAll() : file.read(source.length);
+    const QString hash = put(bytes);
+    if (!hash.isEmpty()) {
+        QMutexLocker locker(&mutex_);
+        fileHashes_.insert(key, hash);
+    }
+    return hash;
+}
+
+QByteArray BlobStore::read(const QString& hash) const {
+    QFile file(pathFor(hash));
+    if (!isHash(hash) || !file.open(QIODevice::ReadOnly)) {
+        return QByteArray();
+    }
+    return file.readAll();
+}
+
+QString BlobStore::refsPathFor(const QString& ownerPath) const {
+    const QByteArray owner = QFileInfo(ownerPath).absoluteFilePath().toUtf8();
+    return root_ + "/refs/" + hashOf(QByteArray(), owner.constData(), owner.size());
+}
+
+bool BlobStore::setReferences(const QString& ownerPath, const QSet<QString>& hashes) {
+    if (hashes.isEmpty()) {
+        removeReferences(ownerPath);
+        return true;
+    }
+    
+    QStringList sorted(hashes.begin(), hashes.end());
+    sorted.sort();
+    QByteArray refs = QFileInfo(ownerPath).absoluteFilePath().toUtf8() + '\n';
+    for (const QString& hash : sorted) {
+        refs += hash.toLatin1() + '\n';
+    }
+    
+    QDir().mkpath(root_ + "/refs");
+    QSaveFile file(refsPathFor(ownerPath));
+    return file.open(QIODevice::WriteOnly) && file.write(refs) == refs.size() && file.commit();
+}
+
+void BlobStore::removeReferences(const QString& ownerPath) {
+    QFile::remove(refsPathFor(ownerPath));
+}
+
+BlobStore::GarbageStats BlobStore::collectGarbage(qint64 minAgeSecs) {
+    GarbageStats stats;
+    
+    // Reference counts over all owners; a missing owner file may just have
+    // been moved, so only removeReferences() forgets one
+    QHash<QString, int> counts;
+    const QFileInfoList refFiles = QDir(root_ + "/refs").entryInfoList(QDir::Files);
+    for (const QFileInfo& refFile : refFiles) {
+        QFile file(refFile.absoluteFilePath());
+        if (!file.open(QIODevice::ReadOnly)) {
+            continue;
+        }
+        file.readLine();  // Owner path
+        while (!file.atEnd()) {
+            const QString hash = QString::fromLatin1(file.readLine()).trimmed();
+            if (isHash(hash)) {
+                ++counts[hash];
+            }
+        }
+    }
+    
+    const QDateTime cutoff = QDateTime::currentDateTime().addSecs(-minAgeSecs);
+    QDirIterator it(root_ + "/objects", QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        const QString path = it.next();
+        const QFileInfo info = it.fileInfo();
+        const QString hash = hashOfPath(path);
+        if (hash.isEmpty() || counts.value(hash) > 0 || info.lastModified() > cutoff) {
+            continue;
+        }
+        
+        const qint64 size = info.size();
+        if (QFile::remove(path)) {
+            ++stats.removedBlobs;
+            stats.freedBytes += size;
+        }
+    }
+    
+    return stats;
+}
+
+} // namespace DatasetCreator
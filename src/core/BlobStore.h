@@ -0,0 +1,113 @@
+#pragma once
+
+#include "DatasetSample.h"
+#include <QDateTime>
+#include <QHash>
+#include <QMutex>
+#include <QSet>
+#include <QString>
+
+namespace DatasetCreator {
+
+/**
+ * @brief Local content-addressed store for sample payloads
+ *
+ * Layout under the root directory:
+ *   objects/ab/cdef...   one file per payload, named by the hex BLAKE2b-256
+ *                        of its bytes and sharded by the first two digits
+ *   refs/<owner hash>    the owner's path, then one blob hash per line
+ *
+ * Projects and exports write each payload here once and refer to it by
+ * hash, so identical payloads are shared across files and saving the same
+ * content again only checks that its blob exists. Every owner (a project
+ * or export file) records the blobs it uses; collectGarbage() removes the
+ * blobs no owner refers to. An owner is only forgotten through
+ * removeReferences(), since a file that was moved, renamed or copied
+ * elsewhere still needs its blobs.
+ * Stored blobs are plain files, so a sample can be backed by one directly.
+ * Thread-safe.
+ */
+class BlobStore {
+public:
+    explicit BlobStore(const QString& rootPath);
+    
+    /**
+     * @brief The shared store in the application data directory
+     */
+    static BlobStore& instance();
+    
+    // Payloads smaller than this are cheaper to keep inline than as a file
+    static constexpr qint64 MinBlobSize = 4096;
+    
+    QString rootPath() const { return root_; }
+    
+    /**
+     * @brief Hex hash of head followed by data
+     */
+    static QString hashOf(const QByteArray& head, const char* data, qint64 size);
+    
+    /**
+     * @brief Store bytes unless a blob with their hash exists
+     * @return The hash, or an empty string if writing failed
+     */
+    QString put(const QByteArray& data) { return put(QByteArray(), data.constData(), data.size()); }
+    QString put(const QByteArray& head, const char* data, qint64 size);
+    
+    /**
+     * @brief Store the bytes a payload source refers to
+     *
+     * A source that is already a blob of this store costs nothing; file
+     * ranges are hashed once per file modification and then remembered.
+     */
+    QString putSource(const PayloadSource& source);
+    
+    bool contains(const QString& hash) const;
+    QString pathFor(const QString& hash) const;
+    QString hashOfPath(const QString& filePath) const;  // Empty unless filePath is a blob here
+    QByteArray read(const QString& hash) const;
+    
+    /**
+     * @brief Replace the set of blobs an owner file refers to
+     */
+    bool setReferences(const QString& ownerPath, const QSet<QString>& hashes);
+    void removeReferences(const QString& ownerPath);
+    
+    struct GarbageStats {
+        int removedBlobs = 0;
+        qint64 freedBytes = 0;
+    };
+    
+    /**
+     * @brief Remove blobs no owner refers to
+     *
+     * Owners count whether or not their file is still at the recorded
+     * path. Blobs written or reused within the last minAgeSecs are kept,
+     * since a save in progress has not recorded its references yet.
+     */
+    GarbageStats collectGarbage(qint64 minAgeSecs = 3600);
+
+private:
+    struct FileKey {
+        QString path;
+        qint64 offset;
+        qint64 length;
+        qint64 size;
+        QDateTime modified;
+        
+        bool operator==(const FileKey& other) const {
+            return path == other.path && offset == other.offset && length == other.length &&
+                   size == other.size && modified == other.modified;
+        }
+    };
+    friend size_t qHash(const FileKey& key, size_t seed) { return qHashMulti(seed, key.path, key.offset, key.length); }
+    
+    static bool isHash(const QString& hash);
+    QString refsPathFor(const QString& ownerPath) const;
+    void touch(const QString& blobPath) const;
+    
+    QString root_;
+    mutable QMutex mutex_;
+    QHash<FileKey, QString> fileHashes_;   // Hashes of source files already stored
+};
+
+} // namespace DatasetCreator
@@ -1,4 +1,5 @@
 #include "Dataset.h"
+#include <QSet>
 
 namespace DatasetCreator {
 
@@ -8,59 +9,70 @@ DatasetSubset::DatasetSubset(const QString& name) {
 }
 
 void DatasetSubset::addSample(const DatasetSample& sample) {
-    samples_.append(sample);
+    if (!ownTable_) {
+        ownTable_ = std::make_shared<SampleTable>();
+        table_ = ownTable_.get();
+    }
+    rows_.append(ownTable_->append(sample));
+    stats_.add(sample);
 }
 
 void DatasetSubset::addSamples(const QList<DatasetSample>& samples) {
-    samples_.append(samples);
+    for (const auto& sample : samples) {
+        addSample(sample);
+    }
 }
 
 void DatasetSubset::removeSample(int index) {
-    if (index >= 0 && index < samples_.size()) {
-        samples_.removeAt(index);
+    if (index >= 0 && index < rows_.size()) {
+        stats_.remove(table_->at(rows_[index]));
+        rows_.removeAt(index);
     }
 }
 
-void DatasetSubset::clearSamples() {
-    samples_.clear();
+void DatasetSubset::removeSamples(const QList<int>& indices) {
+    for (SampleRow row : RowSet::take(rows_, indices)) {
+        stats_.remove(table_->at(row));
+    }
 }
 
-qint64 DatasetSubset::totalSize() const {
-    qint64 total = 0;
-    for (const auto& sample : samples_) {
-        total += sample.dataSize();
+DatasetSubset DatasetSubset::mid(int position, int length) const {
+    DatasetSubset part;
+    part.metadata_ = metadata_;
+    part.table_ = table_;
+    part.ownTable_ = ownTable_;
+    part.rows_ = rows_.mid(position, length);
+    for (SampleRow row : part.rows_) {
+        part.stats_.add(table_->at(row));
     }
-    return total;
+    return part;
 }
 
-QMap<SampleType, int> DatasetSubset::typeDistribution() const {
-    QMap<SampleType, int> distribution;
-    for (const auto& sample : samples_) {
-        distribution[sample.type()]++;
-    }
-    return distribution;
+void DatasetSubset::clearSamples() {
+    rows_.clear();
+    stats_.clear();
 }
 
-QVariantMap DatasetSubset::toVariantMap() const {
+QVariantMap DatasetSubset::toVariantMap(BlobStore* store) const {
     QVariantMap map;
     map["metadata"] = metadata_.toVariantMap();
     
     QVariantList samplesList;
-    for (const auto& sample : samples_) {
-        samplesList.append(sample.toVariantMap());
+    for (const auto& sample : samples()) {
+        samplesList.append(sample.toVariantMap(store));
     }
     map["samples"] = samplesList;
     
     return map;
 }
 
-DatasetSubset DatasetSubset::fromVariantMap(const QVariantMap& map) {
+DatasetSubset DatasetSubset::fromVariantMap(const QVariantMap& map, const BlobStore* store) {
     DatasetSubset subset;
     subset.metadata_ = SubsetMetadata::fromVariantMap(map.value("metadata").toMap());
     
     QVariantList samplesList = map.value("samples").toList();
     for (const auto& sampleVar : samplesList) {
-        subset.samples_.append(DatasetSample::fromVariantMap(sampleVar.toMap()));
+        subset.addSample(DatasetSample::fromVariantMap(sampleVar.toMap(), store));
     }
     
     return subset;
@@ -78,63 +90,222 @@ Dataset::Dataset(const QString& name) {
     metadata_.modified = QDateTime::currentDateTime();
 }
 
+// Subsets point at table_, so copies and moves rebind them to their own table
+Dataset::Dataset(const Dataset& other)
+    : metadata_(other.metadata_)
+    , table_(other.table_)
+    , rootRows_(other.rootRows_)
+    , subsets_(other.subsets_)
+    , idIndex_(other.idIndex_)
+    , rootStats_(other.rootStats_)
+    , distinctStats_(other.distinctStats_)
+    , labelCounts_(other.labelCounts_)
+{
+    bindSubsets();
+}
+
+Dataset::Dataset(Dataset&& other) noexcept
+    : metadata_(std::move(other.metadata_))
+    , table_(std::move(other.table_))
+    , rootRows_(std::move(other.rootRows_))
+    , subsets_(std::move(other.subsets_))
+    , idIndex_(std::move(other.idIndex_))
+    , rootStats_(other.rootStats_)
+    , distinctStats_(other.distinctStats_)
+    , labelCounts_(std::move(other.labelCounts_))
+    , journal_(std::move(other.journal_))
+{
+    bindSubsets();
+}
+
+Dataset& Dataset::operator=(const Dataset& other) {
+    if (this != &other) {
+        metadata_ = other.metadata_;
+        table_ = other.table_;
+        rootRows_ = other.rootRows_;
+        subsets_ = other.subsets_;
+        idIndex_ = other.idIndex_;
+        rootStats_ = other.rootStats_;
+        distinctStats_ = other.distinctStats_;
+        labelCounts_ = other.labelCounts_;
+        journal_.reset();  // The journal describes the replaced contents
+        bindSubsets();
+    }
+    return *this;
+}
+
+Dataset& Dataset::operator=(Dataset&& other) noexcept {
+    if (this != &other) {
+        metadata_ = std::move(other.metadata_);
+        table_ = std::move(other.table_);
+        rootRows_ = std::move(other.rootRows_);
+        subsets_ = std::move(other.subsets_);
+        idIndex_ = std::move(other.idIndex_);
+        rootStats_ = other.rootStats_;
+        distinctStats_ = other.distinctStats_;
+        labelCounts_ = std::move(other.labelCounts_);
+        journal_ = std::move(other.journal_);
+        bindSubsets();
+    }
+    return *this;
+}
+
+void Dataset::bindSubsets() {
+    for (auto& subset : subsets_) {
+        subset.table_ = &table_;
+        subset.ownTable_.reset();
+    }
+}
+
 void Dataset::addSample(const DatasetSample& sample) {
-    samples_.append(sample);
+    attachRow(-1, insertSample(sample));
+    metadata_.modified = QDateTime::currentDateTime();
+}
+
+void Dataset::addSample(const DatasetSample& sample, const QString& subsetName) {
+    if (subsetName.isEmpty()) {
+        addSample(sample);
+        return;
+    }
+    
+    int target = ensureSubset(subsetName);
+    attachRow(target, insertSample(sample));
+    metadata_.modified = QDateTime::currentDateTime();
+}
+
+void Dataset::addSample(const DatasetSample& sample, const QStringList& subsetNames) {
+    if (subsetNames.isEmpty()) {
+        addSample(sample);
+        return;
+    }
+    
+    const SampleRow row = insertSample(sample);
+    for (const QString& name : subsetNames) {
+        attachRow(name.isEmpty() ? -1 : ensureSubset(name), row);
+    }
     metadata_.modified = QDateTime::currentDateTime();
 }
 
 void Dataset::addSamples(const QList<DatasetSample>& samples) {
-    samples_.append(samples);
+    rootRows_.reserve(rootRows_.size() + samples.size());
+    for (const auto& sample : samples) {
+        attachRow(-1, insertSample(sample));
+    }
+    metadata_.modified = QDateTime::currentDateTime();
+}
+
+void Dataset::merge(const Dataset& other) {
+    if (&other == this) {
+        return;
+    }
+    
+    for (SampleRow row : other.rootRows_) {
+        attachRow(-1, insertSample(other.table_.at(row)));
+    }
+    
+    // Rows of the other table -> rows here, so shared samples are added once
+    QHash<SampleRow, SampleRow> inserted;
+    for (const DatasetSubset& subset : other.subsets_) {
+        const int target = ensureSubset(subset.name());
+        for (SampleRow row : subset.rows()) {
+            auto it = inserted.constFind(row);
+            if (it == inserted.cend()) {
+                it = inserted.insert(row, insertSample(other.table_.at(row)));
+            }
+            attachRow(target, *it);
+        }
+    }
     metadata_.modified = QDateTime::currentDateTime();
 }
 
 void Dataset::removeSample(int index) {
-    if (index >= 0 && index < samples_.size()) {
-        samples_.removeAt(index);
+    if (index >= 0 && index < rootRows_.size()) {
+        SampleRow row = rootRows_[index];
+        detachRow(-1, row);
+        dropSample(row);
+        maybeCompact();
         metadata_.modified = QDateTime::currentDateTime();
     }
 }
 
 void Dataset::clearSamples() {
-    samples_.clear();
+    for (SampleRow row : rootRows_) {
+        dropSample(row);
+    }
+    rootRows_.clear();
+    rootStats_.clear();
+    maybeCompact();
     metadata_.modified = QDateTime::currentDateTime();
 }
 
 int Dataset::sampleCount() const {
-    return samples_.size();
+    return rootRows_.size();
 }
 
 void Dataset::addSubset(const DatasetSubset& subset) {
-    subsets_.append(subset);
+    DatasetSubset added(subset.name());
+    added.metadata_ = subset.metadata_;
+    added.table_ = &table_;
+    subsets_.append(added);
+    
+    const int index = subsets_.size() - 1;
+    if (journal_) {
+        journal_->record(JournalEntry::Op::AddSubset, QString(), index, added.metadata_.toVariantMap());
+    }
+    
+    for (const auto& sample : subset.samples()) {
+        attachRow(index, insertSample(sample));
+    }
     metadata_.modified = QDateTime::currentDateTime();
 }
 
 void Dataset::removeSubset(const QString& name) {
+    int index = subsetIndex(name);
+    if (index < 0) return;
+    
+    const QList<SampleRow> rows = subsets_[index].rows_;
+    subsets_.removeAt(index);
+    if (journal_) {
+        journal_->record(JournalEntry::Op::RemoveSubset, QString(), index);
+    }
+    
+    // Samples go with the subset unless another subset still holds them
+    for (SampleRow row : rows) {
+        if (!inAnySubset(row)) {
+            dropSample(row);
+        }
+    }
+    maybeCompact();
+    metadata_.modified = QDateTime::currentDateTime();
+}
+
+int Dataset::subsetIndex(const QString& name) const {
     for (int i = 0; i < subsets_.size(); ++i) {
         if (subsets_[i].name() == name) {
-            subsets_.removeAt(i);
-            metadata_.modified = QDateTime::currentDateTime();
-            return;
+            return i;
         }
     }
+    return -1;
 }
 
-DatasetSubset* Dataset::getSubset(const QString& name) {
-    for (auto& subset : subsets_) {
-        if (subset.name() == name) {
-            return &subset;
+int Dataset::ensureSubset(const QString& name) {
+    int index = subsetIndex(name);
+    if (index < 0) {
+        // Create new subset if it doesn't exist
+        DatasetSubset subset(name);
+        subset.table_ = &table_;
+        subsets_.append(subset);
+        index = subsets_.size() - 1;
+        if (journal_) {
+            journal_->record(JournalEntry::Op::AddSubset, QString(), index, subset.metadata_.toVariantMap());
         }
     }
-    return nullptr;
+    return index;
 }
 
 const DatasetSubset* Dataset::getSubset(const QString& name) const {
-    for (const auto& subset : subsets_) {
-        if (subset.name() == name) {
-            return &subset;
-        }
-    }
-    return nullptr;
+    int index = subsetIndex(name);
+    return index >= 0 ? &subsets_[index] : nullptr;
 }
 
 QList<QString> Dataset::subsetNames() const {
@@ -146,99 +317,457 @@ QList<QString> Dataset::subsetNames() const {
 }
 
 void Dataset::moveSampleToSubset(int sampleIndex, const QString& subsetName) {
-    if (sampleIndex < 0 || sampleIndex >= samples_.size()) {
+    if (sampleIndex < 0 || sampleIndex >= rootRows_.size()) {
         return;
     }
     
-    DatasetSubset* subset = getSubset(subsetName);
-    if (!subset) {
-        // Create new subset if it doesn't exist
-        DatasetSubset newSubset(subsetName);
-        subsets_.append(newSubset);
-        subset = &subsets_.last();
-    }
-    
-    subset->addSample(samples_[sampleIndex]);
-    samples_.removeAt(sampleIndex);
+    int target = ensureSubset(subsetName);
+    SampleRow row = rootRows_[sampleIndex];
+    detachRow(-1, row);
+    attachRow(target, row);
     metadata_.modified = QDateTime::currentDateTime();
 }
 
 void Dataset::moveSampleFromSubset(const QString& subsetName, int sampleIndex) {
-    DatasetSubset* subset = getSubset(subsetName);
-    if (!subset || sampleIndex < 0 || sampleIndex >= subset->sampleCount()) {
+    int source = subsetIndex(subsetName);
+    if (source < 0 || sampleIndex < 0 || sampleIndex >= subsets_[source].sampleCount()) {
         return;
     }
     
-    samples_.append((*subset)[sampleIndex]);
-    subset->removeSample(sampleIndex);
+    SampleRow row = subsets_[source].rows_[sampleIndex];
+    detachRow(source, row);
+    if (!inAnySubset(row)) {
+        attachRow(-1, row);
+    }
     metadata_.modified = QDateTime::currentDateTime();
 }
 
-qint64 Dataset::totalSize() const {
-    qint64 total = 0;
+bool Dataset::addSampleToSubset(const QString& id, const QString& subsetName) {
+    const SampleRow row = idIndex_.value(id);
+    if (row == SampleTable::InvalidRow || subsetName.isEmpty()) {
+        return false;
+    }
+    
+    int target = ensureSubset(subsetName);
+    detachRow(-1, row);
+    attachRow(target, row);
+    metadata_.modified = QDateTime::currentDateTime();
+    return true;
+}
+
+int Dataset::moveSamplesToSubset(const QList<int>& sampleIndices, const QString& subsetName) {
+    QMap<QString, QList<int>> indicesBySubset;
+    indicesBySubset.insert(subsetName, sampleIndices);
+    return moveSamplesToSubsets(indicesBySubset);
+}
+
+int Dataset::moveSamplesToSubsets(const QMap<QString, QList<int>>& indicesBySubset) {
+    // Target subset per root position; a later entry wins for repeated indices
+    std::vector<int> target(rootRows_.size(), -1);
+    for (auto it = indicesBySubset.cbegin(); it != indicesBySubset.cend(); ++it) {
+        if (it.key().isEmpty()) continue;
+        
+        int subset = -1;
+        for (int index : it.value()) {
+            if (index < 0 || index >= rootRows_.size()) continue;
+            if (subset < 0) {
+                subset = ensureSubset(it.key());
+            }
+            target[index] = subset;
+        }
+    }
+    
+    // Root rows are sorted, so every bucket comes out sorted too
+    QList<QList<SampleRow>> buckets(subsets_.size());
+    int kept = 0;
+    for (int i = 0; i < rootRows_.size(); ++i) {
+        if (target[i] < 0) {
+            rootRows_[kept++] = rootRows_[i];
+        } else {
+            buckets[target[i]].append(rootRows_[i]);
+        }
+    }
+    
+    const int moved = rootRows_.size() - kept;
+    if (moved == 0) return 0;
+    
+    rootRows_.resize(kept);
+    for (int i = 0; i < buckets.size(); ++i) {
+        for (SampleRow row : buckets[i]) {
+            rootStats_.remove(table_.at(row));
+            record(JournalEntry::Op::Detach, row, -1);
+        }
+        attachRows(i, buckets[i]);
+    }
+    metadata_.modified = QDateTime::currentDateTime();
+    return moved;
+}
+
+int Dataset::moveSamplesFromSubset(const QString& subsetName, const QList<int>& sampleIndices) {
+    int source = subsetIndex(subsetName);
+    if (source < 0) return 0;
+    
+    const QList<SampleRow> taken = takeRows(source, sampleIndices);
+    if (taken.isEmpty()) return 0;
+    
+    QList<SampleRow> toRoot;
+    for (SampleRow row : taken) {
+        if (!inAnySubset(row)) {
+            toRoot.append(row);
+        }
+    }
+    attachRows(-1, toRoot);
+    metadata_.modified = QDateTime::currentDateTime();
+    return taken.size();
+}
+
+int Dataset::removeSamples(const QList<int>& sampleIndices) {
+    const QList<SampleRow> taken = takeRows(-1, sampleIndices);
+    if (taken.isEmpty()) return 0;
+    
+    for (SampleRow row : taken) {
+        dropSample(row);
+    }
+    maybeCompact();
+    metadata_.modified = QDateTime::currentDateTime();
+    return taken.size();
+}
+
+int Dataset::removeSamplesFromSubset(const QString& subsetName, const QList<int>& sampleIndices) {
+    int source = subsetIndex(subsetName);
+    if (source < 0) return 0;
+    
+    const QList<SampleRow> taken = takeRows(source, sampleIndices);
+    if (taken.isEmpty()) return 0;
+    
+    // Samples still held by another subset only lose this membership
+    for (SampleRow row : taken) {
+        if (!inAnySubset(row)) {
+            dropSample(row);
+        }
+    }
+    maybeCompact();
+    metadata_.modified = QDateTime::currentDateTime();
+    return taken.size();
+}
+
+int Dataset::addTagToSamples(const QList<int>& sampleIndices, const QString& tag) {
+    int tagged = 0;
+    for (int index : sampleIndices) {
+        DatasetSample* sample = getSample(index);
+        if (sample && !sample->metadata().tags.contains(tag)) {
+            sample->metadata().tags.append(tag);
+            record(JournalEntry::Op::SetTags, rootRows_[index], -1, sample->metadata().tags);
+            ++tagged;
+        }
+    }
+    
+    if (tagged > 0) {
+        metadata_.modified = QDateTime::currentDateTime();
+    }
+    return tagged;
+}
+
+int Dataset::removeTagFromSamples(const QList<int>& sampleIndices, const QString& tag) {
+    int untagged = 0;
+    for (int index : sampleIndices) {
+        DatasetSample* sample = getSample(index);
+        if (sample && sample->metadata().tags.removeAll(tag) > 0) {
+            record(JournalEntry::Op::SetTags, rootRows_[index], -1, sample->metadata().tags);
+            ++untagged;
+        }
+    }
+    
+    if (untagged > 0) {
+        metadata_.modified = QDateTime::currentDateTime();
+    }
+    return untagged;
+}
+
+Dataset::SampleLocation Dataset::findSample(const QString& id) const {
+    SampleLocation location;
+    const SampleRow row = idIndex_.value(id);
+    if (row == SampleTable::InvalidRow) {
+        return location;
+    }
     
-    for (const auto& sample : samples_) {
-        total += sample.dataSize();
+    location.index = RowSet::indexOf(rootRows_, row);
+    if (location.index >= 0) {
+        return location;
     }
     
     for (const auto& subset : subsets_) {
-        total += subset.totalSize();
+        location.index = RowSet::indexOf(subset.rows_, row);
+        if (location.index >= 0) {
+            location.subsetName = subset.name();
+            return location;
+        }
+    }
+    return location;
+}
+
+const DatasetSample* Dataset::sampleById(const QString& id) const {
+    const SampleRow row = idIndex_.value(id);
+    if (row == SampleTable::InvalidRow) {
+        return nullptr;
+    }
+    return &table_.at(row);
+}
+
+bool Dataset::moveSampleById(const QString& id, const QString& subsetName) {
+    const SampleRow row = idIndex_.value(id);
+    if (row == SampleTable::InvalidRow) {
+        return false;
     }
     
-    return total;
+    // The sample ends up only in the target, whatever it belonged to before
+    detachRow(-1, row);
+    for (int i = 0; i < subsets_.size(); ++i) {
+        detachRow(i, row);
+    }
+    attachRow(subsetName.isEmpty() ? -1 : ensureSubset(subsetName), row);
+    metadata_.modified = QDateTime::currentDateTime();
+    return true;
 }
 
-QMap<SampleType, int> Dataset::typeDistribution() const {
-    QMap<SampleType, int> distribution;
+QString Dataset::uniqueSampleId(const QString& id) const {
+    if (id.isEmpty() || !idIndex_.contains(id)) {
+        return id;
+    }
     
-    for (const auto& sample : samples_) {
-        distribution[sample.type()]++;
+    // Same scheme file managers use for duplicate names: "name (2)"
+    for (int n = 2; ; ++n) {
+        QString candidate = QString("%1 (%2)").arg(id).arg(n);
+        if (!idIndex_.contains(candidate)) {
+            return candidate;
+        }
+    }
+}
+
+SampleRow Dataset::insertSample(const DatasetSample& sample) {
+    const QString& id = sample.metadata().id;
+    SampleRow row;
+    
+    if (id.isEmpty() || !idIndex_.contains(id)) {
+        row = table_.append(sample);
+    } else {
+        DatasetSample renamed = sample;
+        renamed.metadata().id = uniqueSampleId(id);
+        row = table_.append(renamed);
     }
     
+    const DatasetSample& stored = table_.at(row);
+    if (!stored.metadata().id.isEmpty()) {
+        idIndex_.insert(stored.metadata().id, row);
+    }
+    distinctStats_.add(stored);
+    labelCounts_.add(stored.metadata().labels);
+    if (journal_) {
+        journal_->recordInsert(stored);
+    }
+    return row;
+}
+
+void Dataset::dropSample(SampleRow row) {
+    record(JournalEntry::Op::Drop, row);
+    const DatasetSample& sample = table_.at(row);
+    idIndex_.remove(sample.metadata().id);
+    distinctStats_.remove(sample);
+    labelCounts_.remove(sample.metadata().labels);
+    table_.remove(row);
+}
+
+bool Dataset::attachRow(int subset, SampleRow row) {
+    if (!RowSet::insert(rowsOf(subset), row)) {
+        return false;
+    }
+    statsOf(subset).add(table_.at(row));
+    record(JournalEntry::Op::Attach, row, subset);
+    return true;
+}
+
+bool Dataset::detachRow(int subset, SampleRow row) {
+    if (!RowSet::remove(rowsOf(subset), row)) {
+        return false;
+    }
+    statsOf(subset).remove(table_.at(row));
+    record(JournalEntry::Op::Detach, row, subset);
+    return true;
+}
+
+void Dataset::attachRows(int subset, const QList<SampleRow>& sortedRows) {
+    // Callers only pass rows the list does not hold yet
+    SampleStats& stats = statsOf(subset);
+    for (SampleRow row : sortedRows) {
+        stats.add(table_.at(row));
+        record(JournalEntry::Op::Attach, row, subset);
+    }
+    RowSet::merge(rowsOf(subset), sortedRows);
+}
+
+QList<SampleRow> Dataset::takeRows(int subset, const QList<int>& positions) {
+    QList<SampleRow> taken = RowSet::take(rowsOf(subset), positions);
+    SampleStats& stats = statsOf(subset);
+    for (SampleRow row : taken) {
+        stats.remove(table_.at(row));
+        record(JournalEntry::Op::Detach, row, subset);
+    }
+    return taken;
+}
+
+bool Dataset::inAnySubset(SampleRow row) const {
     for (const auto& subset : subsets_) {
-        auto subsetDist = subset.typeDistribution();
-        for (auto it = subsetDist.begin(); it != subsetDist.end(); ++it) {
-            distribution[it.key()] += it.value();
+        if (subset.containsRow(row)) {
+            return true;
         }
     }
+    return false;
+}
+
+void Dataset::maybeCompact() {
+    // Removed rows are cheap, so only renumber once they dominate the table
+    if (table_.deadCount() < 4096 || table_.deadCount() < table_.liveCount()) {
+        return;
+    }
     
-    return distribution;
+    const std::vector<SampleRow> remap = table_.compact();
+    for (SampleRow& row : rootRows_) {
+        row = remap[row];
+    }
+    for (auto& subset : subsets_) {
+        for (SampleRow& row : subset.rows_) {
+            row = remap[row];
+        }
+    }
+    idIndex_.remap(remap);
 }
 
-int Dataset::totalSampleCount() const {
-    int total = samples_.size();
+void Dataset::record(JournalEntry::Op op, SampleRow row, int list, const QVariant& value) {
+    if (journal_) {
+        journal_->record(op, table_.at(row).metadata().id, list, value);
+    }
+}
+
+bool Dataset::applyJournalEntry(const JournalEntry& entry) {
+    // Lists named by an entry must exist at this point of the replay
+    auto validList = [this](int list) { return list >= -1 && list < subsets_.size(); };
+    auto rowOf = [this](const QString& id) { return idIndex_.value(id); };
+    
+    switch (entry.op) {
+        case JournalEntry::Op::Insert:
+            insertSample(entry.sample);
+            return true;
+        case JournalEntry::Op::Drop: {
+            SampleRow row = rowOf(entry.sampleId);
+            if (row == SampleTable::InvalidRow) return false;
+            for (int list = -1; list < subsets_.size(); ++list) {
+                detachRow(list, row);
+            }
+            dropSample(row);
+            maybeCompact();
+            return true;
+        }
+        case JournalEntry::Op::Attach:
+        case JournalEntry::Op::Detach: {
+            SampleRow row = rowOf(entry.sampleId);
+            if (row == SampleTable::InvalidRow || !validList(entry.list)) return false;
+            if (entry.op == JournalEntry::Op::Attach) {
+                attachRow(entry.list, row);
+            } else {
+                detachRow(entry.list, row);
+            }
+            return true;
+        }
+        case JournalEntry::Op::AddSubset: {
+            DatasetSubset subset;
+            subset.metadata_ = SubsetMetadata::fromVariantMap(entry.value.toMap());
+            subset.table_ = &table_;
+            subsets_.append(subset);
+            return true;
+        }
+        case JournalEntry::Op::RemoveSubset:
+            if (entry.list < 0 || entry.list >= subsets_.size()) return false;
+            subsets_.removeAt(entry.list);
+            return true;
+        case JournalEntry::Op::SetTags:
+        case JournalEntry::Op::SetLabels: {
+            SampleRow row = rowOf(entry.sampleId);
+            if (row == SampleTable::InvalidRow) return false;
+            SampleMetadata& meta = table_.mutableAt(row).metadata();
+            if (entry.op == JournalEntry::Op::SetTags) {
+                meta.tags = entry.value.toStringList();
+            } else {
+                labelCounts_.remove(meta.labels);
+                meta.labels = entry.value.toMap();
+                labelCounts_.add(meta.labels);
+            }
+            return true;
+        }
+        case JournalEntry::Op::SetMetadata:
+            metadata_ = DatasetMetadata::fromVariantMap(entry.value.toMap());
+            return true;
+        case JournalEntry::Op::Clear:
+            clear();
+            return true;
+    }
+    return false;
+}
+
+qint64 Dataset::totalSize() const {
+    qint64 total = rootStats_.bytes;
     for (const auto& subset : subsets_) {
-        total += subset.sampleCount();
+        total += subset.totalSize();
     }
     return total;
 }
 
+QMap<SampleType, int> Dataset::typeDistribution() const {
+    SampleStats combined = rootStats_;
+    for (const auto& subset : subsets_) {
+        combined.merge(subset.stats());
+    }
+    return combined.typeDistribution();
+}
+
+int Dataset::totalSampleCount() const {
+    return distinctStats_.count;
+}
+
 void Dataset::clear() {
-    samples_.clear();
+    if (journal_) {
+        journal_->record(JournalEntry::Op::Clear);
+    }
+    table_.clear();
+    rootRows_.clear();
     subsets_.clear();
+    idIndex_.clear();
+    rootStats_.clear();
+    distinctStats_.clear();
+    labelCounts_.clear();
     metadata_ = DatasetMetadata();
     metadata_.created = QDateTime::currentDateTime();
     metadata_.modified = QDateTime::currentDateTime();
 }
 
 bool Dataset::isEmpty() const {
-    return samples_.isEmpty() && subsets_.isEmpty();
+    return rootRows_.isEmpty() && subsets_.isEmpty();
 }
 
 DatasetSample* Dataset::getSample(int index) {
-    if (index < 0 || index >= samples_.size()) return nullptr;
-    return &samples_[index];
+    if (index < 0 || index >= rootRows_.size()) return nullptr;
+    return &table_.mutableAt(rootRows_[index]);
 }
 
 const DatasetSample* Dataset::getSample(int index) const {
-    if (index < 0 || index >= samples_.size()) return nullptr;
-    return &samples_[index];
+    if (index < 0 || index >= rootRows_.size()) return nullptr;
+    return &table_.at(rootRows_[index]);
 }
 
 bool Dataset::updateSampleTags(int index, const QStringList& tags) {
     DatasetSample* sample = getSample(index);
     if (!sample) return false;
     sample->metadata().tags = tags;
+    record(JournalEntry::Op::SetTags, rootRows_[index], -1, tags);
     metadata_.modified = QDateTime::currentDateTime();
     return true;
 }
@@ -246,7 +775,10 @@ bool Dataset::updateSampleTags(int index, const QStringList& tags) {
 bool Dataset::updateSampleLabels(int index, const QVariantMap& labels) {
     DatasetSample* sample = getSample(index);
     if (!sample) return false;
+    labelCounts_.remove(sample->metadata().labels);
     sample->metadata().labels = labels;
+    labelCounts_.add(labels);
+    record(JournalEntry::Op::SetLabels, rootRows_[index], -1, labels);
     metadata_.modified = QDateTime::currentDateTime();
     return true;
 }
@@ -256,6 +788,7 @@ bool Dataset::addSampleTag(int index, const QString& tag) {
     if (!sample) return false;
     if (!sample->metadata().tags.contains(tag)) {
         sample->metadata().tags.append(tag);
+        record(JournalEntry::Op::SetTags, rootRows_[index], -1, sample->metadata().tags);
         metadata_.modified = QDateTime::currentDateTime();
     }
     return true;
@@ -264,27 +797,48 @@ bool Dataset::addSampleTag(int index, const QString& tag) {
 bool Dataset::addSampleLabel(int index, const QString& key, const QVariant& value) {
     DatasetSample* sample = getSample(index);
     if (!sample) return false;
+    labelCounts_.remove(sample->metadata().labels);
     sample->metadata().labels[key] = value;
+    labelCounts_.add(sample->metadata().labels);
+    record(JournalEntry::Op::SetLabels, rootRows_[index], -1, sample->metadata().labels);
     metadata_.modified = QDateTime::currentDateTime();
     return true;
 }
 
-QVariantMap Dataset::toVariantMap() const {
+QVariantMap Dataset::toVariantMap(BlobStore* store) const {
     QVariantMap map;
     map["metadata"] = metadata_.toVariantMap();
     
-    if (!samples_.isEmpty()) {
+    if (!rootRows_.isEmpty()) {
         QVariantList samplesList;
-        for (const auto& sample : samples_) {
-            samplesList.append(sample.toVariantMap());
+        for (const auto& sample : samples()) {
+            samplesList.append(sample.toVariantMap(store));
         }
         map["samples"] = samplesList;
     }
     
     if (!subsets_.isEmpty()) {
+        // A sample in several subsets is written once; later subsets refer to it by ID
+        QSet<SampleRow> written;
         QVariantList subsetsList;
         for (const auto& subset : subsets_) {
-            subsetsList.append(subset.toVariantMap());
+            QVariantList samplesList;
+            for (SampleRow row : subset.rows_) {
+                const DatasetSample& sample = table_.at(row);
+                if (written.contains(row) && !sample.metadata().id.isEmpty()) {
+                    QVariantMap ref;
+                    ref["ref"] = sample.metadata().id;
+                    samplesList.append(ref);
+                } else {
+                    samplesList.append(sample.toVariantMap(store));
+                    written.insert(row);
+                }
+            }
+            
+            QVariantMap subsetMap;
+            subsetMap["metadata"] = subset.metadata().toVariantMap();
+            subsetMap["samples"] = samplesList;
+            subsetsList.append(subsetMap);
         }
         map["subsets"] = subsetsList;
     }
@@ -292,24 +846,40 @@ QVariantMap Dataset::toVariantMap() const {
     return map;
 }
 
-Dataset Dataset::fromVariantMap(const QVariantMap& map) {
+Dataset Dataset::fromVariantMap(const QVariantMap& map, const BlobStore* store) {
     Dataset dataset;
-    dataset.metadata_ = DatasetMetadata::fromVariantMap(map.value("metadata").toMap());
     
     if (map.contains("samples")) {
         QVariantList samplesList = map.value("samples").toList();
         for (const auto& sampleVar : samplesList) {
-            dataset.samples_.append(DatasetSample::fromVariantMap(sampleVar.toMap()));
+            dataset.addSample(DatasetSample::fromVariantMap(sampleVar.toMap(), store));
         }
     }
     
     if (map.contains("subsets")) {
         QVariantList subsetsList = map.value("subsets").toList();
         for (const auto& subsetVar : subsetsList) {
-            dataset.subsets_.append(DatasetSubset::fromVariantMap(subsetVar.toMap()));
+            QVariantMap subsetMap = subsetVar.toMap();
+            DatasetSubset subset;
+            subset.metadata_ = SubsetMetadata::fromVariantMap(subsetMap.value("metadata").toMap());
+            int index = dataset.ensureSubset(subset.name());
+            dataset.subsets_[index].metadata_ = subset.metadata_;
+            
+            QVariantList samplesList = subsetMap.value("samples").toList();
+            for (const auto& sampleVar : samplesList) {
+                QVariantMap sampleMap = sampleVar.toMap();
+                if (sampleMap.contains("ref")) {
+                    dataset.addSampleToSubset(sampleMap.value("ref").toString(), subset.name());
+                } else {
+                    dataset.attachRow(index, dataset.insertSample(DatasetSample::fromVariantMap(sampleMap, store)));
+                }
+            }
         }
     }
     
+    // Set last so loading does not bump the modification time
+    dataset.metadata_ = DatasetMetadata::fromVariantMap(map.value("metadata").toMap());
+    
     return dataset;
 }
 
@@ -1,16 +1,27 @@
 #pragma once
 
+#include "DatasetJournal.h"
 #include "DatasetSample.h"
+#include "DatasetStats.h"
 #include "Metadata.h"
+#include "SampleTable.h"
 #include <QString>
 #include <QList>
 #include <QMap>
+#include <QHash>
 #include <memory>
 
 namespace DatasetCreator {
 
 /**
  * @brief Dataset subset - a logical grouping of samples
+ *
+ * A subset stores no samples itself, only the sorted rows of the sample
+ * table they live in. Subsets inside a Dataset reference the dataset's table
+ * and are changed through the Dataset; a standalone subset (one that has not
+ * been added to a dataset yet) owns a small table of its own.
+ *
+ * Size and type statistics are kept up to date on every change.
  */
 class DatasetSubset {
 public:
@@ -24,39 +35,92 @@ public:
     SubsetMetadata& metadata() { return metadata_; }
     const SubsetMetadata& metadata() const { return metadata_; }
     
-    // Sample management
+    // Sample management (standalone subsets)
     void addSample(const DatasetSample& sample);
     void addSamples(const QList<DatasetSample>& samples);
     void removeSample(int index);
+    void removeSamples(const QList<int>& indices);
     void clearSamples();
     
-    int sampleCount() const { return samples_.size(); }
-    const QList<DatasetSample>& samples() const { return samples_; }
-    QList<DatasetSample>& samples() { return samples_; }
+    int sampleCount() const { return rows_.size(); }
+    SampleView samples() const { return SampleView(table_, &rows_); }
+    const QList<SampleRow>& rows() const { return rows_; }
+    bool containsRow(SampleRow row) const { return RowSet::contains(rows_, row); }
     
-    DatasetSample& operator[](int index) { return samples_[index]; }
-    const DatasetSample& operator[](int index) const { return samples_[index]; }
+    const DatasetSample& operator[](int index) const { return table_->at(rows_[index]); }
     
-    // Statistics
-    qint64 totalSize() const;
-    QMap<SampleType, int> typeDistribution() const;
+    // The samples from position on, with the same metadata; the part shares
+    // this subset's table and rows, so it must not outlive them
+    DatasetSubset mid(int position, int length = -1) const;
     
-    // Serialization
-    QVariantMap toVariantMap() const;
-    static DatasetSubset fromVariantMap(const QVariantMap& map);
+    // Statistics (constant time)
+    const SampleStats& stats() const { return stats_; }
+    qint64 totalSize() const { return stats_.bytes; }
+    QMap<SampleType, int> typeDistribution() const { return stats_.typeDistribution(); }
     
+    // Serialization (see DatasetSample::toVariantMap for the store)
+    QVariantMap toVariantMap(BlobStore* store = nullptr) const;
+    static DatasetSubset fromVariantMap(const QVariantMap& map, const BlobStore* store = nullptr);
+
 private:
+    friend class Dataset;
+    
     SubsetMetadata metadata_;
-    QList<DatasetSample> samples_;
+    QList<SampleRow> rows_;                  // Sorted rows of table_
+    const SampleTable* table_ = nullptr;
+    std::shared_ptr<SampleTable> ownTable_;  // Storage of a standalone subset
+    SampleStats stats_;
 };
 
 /**
  * @brief Dataset - the root container for all dataset data
+ *
+ * Every sample is stored once in a central SampleTable. The root list and
+ * each subset hold sorted row lists, so moving a sample between them copies
+ * no sample data, and one sample may belong to several subsets. Root samples
+ * are the ones that belong to no subset.
+ *
+ * Samples are indexed by SampleMetadata::id. Sample and subset membership
+ * is only changed through Dataset so the index stays in sync; a sample whose
+ * ID is already taken is given a unique one when it is added.
+ *
+ * Statistics (bytes, per-type counts for the root and every subset, and
+ * label value counts) are running aggregates updated with each mutation, so
+ * reading them never walks the samples.
+ *
+ * With a DatasetJournal attached, every mutation is also recorded there so
+ * that a save only has to write what changed. Copies start without one.
+ *
+ * Copies are cheap snapshots: the sample table and ID index are shared
+ * chunk by chunk and the row lists are implicitly shared, so copying costs
+ * O(subsets), and later changes to either side copy only the parts they
+ * touch. A snapshot can be saved or exported on a worker thread while the
+ * original keeps changing on the GUI thread.
  */
 class Dataset {
 public:
+    /**
+     * @brief Where a sample lives: the root list or a named subset
+     */
+    struct SampleLocation {
+        QString subsetName;   // Empty for root samples (first subset if several)
+        int index = -1;       // Position in the root list or the subset
+        
+        bool isValid() const { return index >= 0; }
+        bool isRoot() const { return subsetName.isEmpty(); }
+    };
+    
     Dataset();
     explicit Dataset(const QString& name);
+    Dataset(const Dataset& other);
+    Dataset(Dataset&& other) noexcept;
+    Dataset& operator=(const Dataset& other);
+    Dataset& operator=(Dataset&& other) noexcept;
+    
+    /**
+     * @brief Immutable copy to hand to another thread (see class notes)
+     */
+    std::shared_ptr<const Dataset> snapshot() const { return std::make_shared<const Dataset>(*this); }
     
     // Global metadata
     DatasetMetadata& metadata() { return metadata_; }
@@ -64,37 +128,71 @@ public:
     
     // Sample management (flat structure - no subsets)
     void addSample(const DatasetSample& sample);
+    void addSample(const DatasetSample& sample, const QString& subsetName);  // Empty name is root
+    void addSample(const DatasetSample& sample, const QStringList& subsetNames);  // One sample shared by all
     void addSamples(const QList<DatasetSample>& samples);
+    
+    /**
+     * @brief Add all samples of another dataset, with their subsets
+     *
+     * A sample the other dataset shares between subsets stays shared here;
+     * clashing ids are renamed as addSample() does. Missing subsets are
+     * created, and the metadata of this dataset is kept.
+     */
+    void merge(const Dataset& other);
     void removeSample(int index);
     void clearSamples();
     
     int sampleCount() const;
-    const QList<DatasetSample>& samples() const { return samples_; }
-    QList<DatasetSample>& samples() { return samples_; }
+    SampleView samples() const { return SampleView(&table_, &rootRows_); }
     
     // Subset management (hierarchical structure)
     void addSubset(const DatasetSubset& subset);
     void removeSubset(const QString& name);
-    DatasetSubset* getSubset(const QString& name);
     const DatasetSubset* getSubset(const QString& name) const;
     
     bool hasSubsets() const { return !subsets_.isEmpty(); }
     int subsetCount() const { return subsets_.size(); }
     QList<QString> subsetNames() const;
     const QList<DatasetSubset>& subsets() const { return subsets_; }
-    QList<DatasetSubset>& subsets() { return subsets_; }
     
     // Move samples between flat and hierarchical structures
     void moveSampleToSubset(int sampleIndex, const QString& subsetName);
     void moveSampleFromSubset(const QString& subsetName, int sampleIndex);
-    
-    // Statistics
+    bool addSampleToSubset(const QString& id, const QString& subsetName);  // Keeps other memberships
+    
+    /**
+     * @brief Bulk operations
+     *
+     * Indices refer to positions before the call, in any order; invalid and
+     * repeated indices are ignored. Each call is a single linear pass over
+     * the affected row lists and updates the modification time once.
+     * @return Number of samples affected
+     */
+    int moveSamplesToSubset(const QList<int>& sampleIndices, const QString& subsetName);
+    int moveSamplesToSubsets(const QMap<QString, QList<int>>& indicesBySubset);
+    int moveSamplesFromSubset(const QString& subsetName, const QList<int>& sampleIndices);
+    int removeSamples(const QList<int>& sampleIndices);
+    int removeSamplesFromSubset(const QString& subsetName, const QList<int>& sampleIndices);
+    int addTagToSamples(const QList<int>& sampleIndices, const QString& tag);
+    int removeTagFromSamples(const QList<int>& sampleIndices, const QString& tag);
+    
+    // Lookup by sample ID (constant time)
+    bool containsSample(const QString& id) const { return idIndex_.contains(id); }
+    SampleLocation findSample(const QString& id) const;
+    const DatasetSample* sampleById(const QString& id) const;
+    bool moveSampleById(const QString& id, const QString& subsetName);  // Sole membership; empty name is root
+    QString uniqueSampleId(const QString& id) const;
+    
+    // Statistics (constant time, or linear in the number of subsets)
     qint64 totalSize() const;
     QMap<SampleType, int> typeDistribution() const;
-    int totalSampleCount() const;  // Includes all samples in subsets
+    int totalSampleCount() const;  // Distinct samples, including those in subsets
+    const SampleStats& rootStats() const { return rootStats_; }
+    const SampleStats& distinctStats() const { return distinctStats_; }  // Each sample counted once
+    const LabelCounts& labelCounts() const { return labelCounts_; }      // Over distinct samples
     
-    // Sample metadata updates
-    DatasetSample* getSample(int index);
+    // Sample metadata updates (the sample ID must not be changed through these)
     const DatasetSample* getSample(int index) const;
     bool updateSampleTags(int index, const QStringList& tags);
     bool updateSampleLabels(int index, const QVariantMap& labels);
@@ -105,14 +203,43 @@ public:
     void clear();
     bool isEmpty() const;
     
-    // Serialization
-    QVariantMap toVariantMap() const;
-    static Dataset fromVariantMap(const QVariantMap& map);
+    // Change journal
+    void setJournal(std::shared_ptr<DatasetJournal> journal) { journal_ = std::move(journal); }
+    std::shared_ptr<DatasetJournal> journal() const { return journal_; }
+    bool applyJournalEntry(const JournalEntry& entry);  // Replay; false if it does not fit
     
+    // Serialization (see DatasetSample::toVariantMap for the store)
+    QVariantMap toVariantMap(BlobStore* store = nullptr) const;
+    static Dataset fromVariantMap(const QVariantMap& map, const BlobStore* store = nullptr);
+
 private:
+    int subsetIndex(const QString& name) const;
+    int ensureSubset(const QString& name);
+    SampleRow insertSample(const DatasetSample& sample);
+    void dropSample(SampleRow row);
+    DatasetSample* getSample(int index);
+    
+    // Membership changes that keep the per-list statistics in step; -1 is the root
+    QList<SampleRow>& rowsOf(int subset) { return subset < 0 ? rootRows_ : subsets_[subset].rows_; }
+    SampleStats& statsOf(int subset) { return subset < 0 ? rootStats_ : subsets_[subset].stats_; }
+    bool attachRow(int subset, SampleRow row);
+    bool detachRow(int subset, SampleRow row);
+    void attachRows(int subset, const QList<SampleRow>& sortedRows);
+    QList<SampleRow> takeRows(int subset, const QList<int>& positions);
+    bool inAnySubset(SampleRow row) const;
+    void maybeCompact();
+    void bindSubsets();
+    void record(JournalEntry::Op op, SampleRow row, int list = -1, const QVariant& value = QVariant());
+    
     DatasetMetadata metadata_;
-    QList<DatasetSample> samples_;        // Top-level samples (flat structure)
-    QList<DatasetSubset> subsets_;        // Hierarchical subsets
+    SampleTable table_;                    // Every sample, stored once
+    QList<SampleRow> rootRows_;            // Samples in no subset (flat structure)
+    QList<DatasetSubset> subsets_;         // Hierarchical subsets
+    SampleIdIndex idIndex_;                // Sample ID -> table row
+    SampleStats rootStats_;
+    SampleStats distinctStats_;
+    LabelCounts labelCounts_;
+    std::shared_ptr<DatasetJournal> journal_;
 };
 
 } // namespace DatasetCreator
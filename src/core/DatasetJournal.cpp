@@ -0,0 +1,43 @@
+#include "DatasetJournal.h"
+
+namespace DatasetCreator {
+
+DatasetJournal::DatasetJournal(const QString& filePath, quint64 journalId, quint64 nextSequence)
+    : filePath_(filePath)
+    , journalId_(journalId)
+    , nextSequence_(qMax<quint64>(1, nextSequence))
+{
+}
+
+void DatasetJournal::record(JournalEntry::Op op, const QString& sampleId, int list, const QVariant& value) {
+    const bool sampleOp = op == JournalEntry::Op::Insert || op == JournalEntry::Op::Drop ||
+                          op == JournalEntry::Op::Attach || op == JournalEntry::Op::Detach ||
+                          op == JournalEntry::Op::SetTags || op == JournalEntry::Op::SetLabels;
+    if (sampleOp && sampleId.isEmpty()) {
+        // Samples are addressed by ID; without one the change cannot be replayed
+        valid_ = false;
+    }
+    if (!valid_) {
+        return;
+    }
+    
+    JournalEntry entry;
+    entry.op = op;
+    entry.sequence = nextSequence_++;
+    entry.sampleId = sampleId;
+    entry.list = list;
+    entry.value = value;
+    entries_.append(entry);
+}
+
+void DatasetJournal::recordInsert(const DatasetSample& sample) {
+    record(JournalEntry::Op::Insert, sample.metadata().id);
+    insertedBytes_ += sample.dataSize();
+}
+
+void DatasetJournal::clearEntries() {
+    entries_.clear();
+    insertedBytes_ = 0;
+}
+
+} // namespace DatasetCreator
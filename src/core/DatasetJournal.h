@@ -0,0 +1,87 @@
+#pragma once
+
+#include "DatasetSample.h"
+#include <QList>
+#include <QString>
+#include <QVariant>
+
+namespace DatasetCreator {
+
+/**
+ * @brief One recorded dataset mutation
+ *
+ * Entries describe the primitive changes a Dataset makes (a sample stored
+ * or dropped, a row attached to or detached from a list, ...), so replaying
+ * them in order reproduces the dataset exactly. Lists are identified by
+ * subset index, -1 being the root list.
+ */
+struct JournalEntry {
+    enum class Op : quint8 {
+        Insert = 1,     // Sample stored in the table (sample; membership follows)
+        Drop,           // Sample removed from every list and the table
+        Attach,         // Sample added to list
+        Detach,         // Sample removed from list
+        AddSubset,      // Subset appended (value: subset metadata)
+        RemoveSubset,   // Subset at list removed; its samples are handled by later entries
+        SetTags,        // value: tags
+        SetLabels,      // value: labels
+        SetMetadata,    // value: dataset metadata
+        Clear           // Everything removed
+    };
+    
+    Op op = Op::Insert;
+    quint64 sequence = 0;
+    QString sampleId;
+    int list = -1;
+    QVariant value;
+    DatasetSample sample;    // Insert entries being replayed
+};
+
+/**
+ * @brief Mutation log attached to a Dataset for incremental saves
+ *
+ * While a journal is attached, the dataset records every change here.
+ * Entries only carry sample IDs; the payload of an inserted sample is
+ * looked up when the entries are written out. A journal that saw a change
+ * it cannot describe (a sample without an ID) becomes invalid, and the
+ * owner must fall back to a full save.
+ *
+ * The binding (where the entries go and which snapshot they extend) is
+ * opaque to the dataset and kept for the storage code.
+ */
+class DatasetJournal {
+public:
+    DatasetJournal(const QString& filePath, quint64 journalId, quint64 nextSequence);
+    
+    // Recording (called by Dataset)
+    void record(JournalEntry::Op op, const QString& sampleId = QString(),
+                int list = -1, const QVariant& value = QVariant());
+    void recordInsert(const DatasetSample& sample);
+    void invalidate() { valid_ = false; }
+    
+    // Pending entries, oldest first
+    const QList<JournalEntry>& entries() const { return entries_; }
+    bool isEmpty() const { return entries_.isEmpty(); }
+    qint64 insertedBytes() const { return insertedBytes_; }   // Payload bytes of pending inserts
+    void clearEntries();
+    
+    bool isValid() const { return valid_; }
+    quint64 lastSequence() const { return nextSequence_ - 1; }
+    
+    // Binding
+    const QString& filePath() const { return filePath_; }
+    quint64 journalId() const { return journalId_; }
+    qint64 logSize() const { return logSize_; }
+    void setLogSize(qint64 size) { logSize_ = size; }
+
+private:
+    QString filePath_;
+    quint64 journalId_;
+    quint64 nextSequence_;
+    qint64 logSize_ = 0;
+    qint64 insertedBytes_ = 0;
+    bool valid_ = true;
+    QList<JournalEntry> entries_;
+};
+
+} // namespace DatasetCreator
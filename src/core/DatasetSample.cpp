@@ -1,13 +1,21 @@
 #include "DatasetSample.h"
+#include "Base64.h"
+#include "BlobStore.h"
+#include "JsonEmitter.h"
+#include "PayloadCache.h"
 #include <QBuffer>
+#include <QFile>
+#include <QFileInfo>
+#include <QImageReader>
 #include <QImageWriter>
+#include <type_traits>
 
 namespace DatasetCreator {
 
 // AudioData implementation
 QVariantMap AudioData::toVariantMap() const {
     QVariantMap map;
-    map["samples"] = samples.toBase64();
+    map["samples"] = Base64::encode(samples);
     map["sample_rate"] = format.sampleRate();
     map["channel_count"] = format.channelCount();
     map["sample_format"] = static_cast<int>(format.sampleFormat());
@@ -15,9 +23,27 @@ QVariantMap AudioData::toVariantMap() const {
     return map;
 }
 
+void AudioData::writeJson(JsonEmitter& json, bool withSamples) const {
+    json.beginObject();
+    json.key("channel_count");
+    json.value(format.channelCount());
+    json.key("duration_ms");
+    json.value(durationMs);
+    json.key("sample_format");
+    json.value(static_cast<int>(format.sampleFormat()));
+    json.key("sample_rate");
+    json.value(format.sampleRate());
+    if (withSamples) {
+        json.key("samples");
+        json.base64Value(samples);
+    }
+    json.endObject();
+}
+
 AudioData AudioData::fromVariantMap(const QVariantMap& map) {
     AudioData data;
-    data.samples = QByteArray::fromBase64(map.value("samples").toByteArray());
+    data.samples = map.value("samples").toByteArray();
+    Base64::decodeInPlace(data.samples);
     
     data.format.setSampleRate(map.value("sample_rate").toInt());
     data.format.setChannelCount(map.value("channel_count").toInt());
@@ -29,16 +55,49 @@ AudioData AudioData::fromVariantMap(const QVariantMap& map) {
 }
 
 // MultimodalData implementation
+QImage MultimodalData::image() const {
+    if (encodedImage_.isEmpty()) {
+        return image_;
+    }
+    
+    PayloadSource source;
+    source.bytes = encodedImage_;
+    source.format = imageFormat_;
+    const std::shared_ptr<const SamplePayload> decoded = PayloadCache::instance().fetch(SampleType::Image, source);
+    const QImage* image = std::get_if<QImage>(decoded.get());
+    return image ? *image : QImage();
+}
+
+void MultimodalData::setImage(const QImage& image) {
+    image_ = image;
+    encodedImage_.clear();
+    imageFormat_.clear();
+}
+
+void MultimodalData::setEncodedImage(const QByteArray& bytes, const QByteArray& format) {
+    image_ = QImage();
+    encodedImage_ = bytes;
+    imageFormat_ = format;
+}
+
+qint64 MultimodalData::imageSize() const {
+    return encodedImage_.isEmpty() ? image_.sizeInBytes() : encodedImage_.size();
+}
+
 QVariantMap MultimodalData::toVariantMap() const {
     QVariantMap map;
     if (!text.isEmpty()) map["text"] = text;
     
-    if (!image.isNull()) {
+    if (!encodedImage_.isEmpty()) {
+        // Original bytes pass through; no PNG re-encode
+        map["image"] = Base64::encode(encodedImage_);
+        if (!imageFormat_.isEmpty()) map["image_format"] = QString(imageFormat_);
+    } else if (!image_.isNull()) {
         QByteArray imageData;
         QBuffer buffer(&imageData);
         buffer.open(QIODevice::WriteOnly);
-        image.save(&buffer, "PNG");
-        map["image"] = imageData.toBase64();
+        image_.save(&buffer, "PNG");
+        map["image"] = Base64::encode(imageData);
     }
     
     if (!audio.samples.isEmpty()) {
@@ -52,13 +111,49 @@ QVariantMap MultimodalData::toVariantMap() const {
     return map;
 }
 
+void MultimodalData::writeJson(JsonEmitter& json) const {
+    json.beginObject();
+    if (!additionalData.isEmpty()) {
+        json.key("additional");
+        json.value(additionalData);
+    }
+    if (!audio.samples.isEmpty()) {
+        json.key("audio");
+        audio.writeJson(json);
+    }
+    
+    if (!encodedImage_.isEmpty()) {
+        json.key("image");
+        json.base64Value(encodedImage_);
+        if (!imageFormat_.isEmpty()) {
+            json.key("image_format");
+            json.value(QString(imageFormat_));
+        }
+    } else if (!image_.isNull()) {
+        QByteArray imageData;
+        QBuffer buffer(&imageData);
+        buffer.open(QIODevice::WriteOnly);
+        image_.save(&buffer, "PNG");
+        json.key("image");
+        json.base64Value(imageData);
+    }
+    
+    if (!text.isEmpty()) {
+        json.key("text");
+        json.value(text);
+    }
+    json.endObject();
+}
+
 MultimodalData MultimodalData::fromVariantMap(const QVariantMap& map) {
     MultimodalData data;
     data.text = map.value("text").toString();
     
     if (map.contains("image")) {
-        QByteArray imageData = QByteArray::fromBase64(map.value("image").toByteArray());
-        data.image.loadFromData(imageData);
+        // Kept encoded; decoded on first access
+        QByteArray encoded = map.value("image").toByteArray();
+        Base64::decodeInPlace(encoded);
+        data.setEncodedImage(encoded, map.value("image_format").toString().toLatin1());
     }
     
     if (map.contains("audio")) {
@@ -71,90 +166,174 @@ MultimodalData MultimodalData::fromVariantMap(const QVariantMap& map) {
 
 // DatasetSample implementation
 DatasetSample::DatasetSample()
-    : type_(SampleType::Text)
 {
     metadata_.timestamp = QDateTime::currentDateTime();
 }
 
 DatasetSample::DatasetSample(SampleType type)
-    : type_(type)
 {
+    setType(type);
     metadata_.timestamp = QDateTime::currentDateTime();
 }
 
-QString DatasetSample::asText() const {
-    return data_.toString();
+void DatasetSample::setType(SampleType type) {
+    if (type == this->type()) {
+        return;
+    }
+    
+    data_ = emptyPayload(type);
+    source_ = PayloadSource();
 }
 
-QImage DatasetSample::asImage() const {
-    return data_.value<QImage>();
+void DatasetSample::setText(const QString& text) {
+    data_.emplace<Utf8Text>(text);
+    source_ = PayloadSource();
 }
 
-AudioData DatasetSample::asAudio() const {
-    return data_.value<AudioData>();
+void DatasetSample::setText(const Utf8Text& text) {
+    data_.emplace<Utf8Text>(text);
+    source_ = PayloadSource();
 }
 
-QByteArray DatasetSample::asBinary() const {
-    return data_.toByteArray();
+void DatasetSample::setImage(const QImage& image) {
+    data_.emplace<QImage>(image);
+    source_ = PayloadSource();
 }
 
-MultimodalData DatasetSample::asMultimodal() const {
-    return data_.value<MultimodalData>();
+void DatasetSample::setAudio(const AudioData& audio) {
+    data_.emplace<AudioData>(audio);
+    source_ = PayloadSource();
 }
 
-void DatasetSample::setText(const QString& text) {
-    type_ = SampleType::Text;
-    data_ = text;
+void DatasetSample::setBinary(const QByteArray& data) {
+    data_.emplace<QByteArray>(data);
+    source_ = PayloadSource();
 }
 
-void DatasetSample::setImage(const QImage& image) {
-    type_ = SampleType::Image;
-    data_ = QVariant::fromValue(image);
+void DatasetSample::setMultimodal(const MultimodalData& data) {
+    data_.emplace<MultimodalData>(data);
+    source_ = PayloadSource();
 }
 
-void DatasetSample::setAudio(const AudioData& audio) {
-    type_ = SampleType::Audio;
-    data_ = QVariant::fromValue(audio);
+void DatasetSample::setSource(SampleType type, const PayloadSource& source) {
+    data_ = emptyPayload(type);  // Drop any in-memory payload
+    source_ = source;
 }
 
-void DatasetSample::setBinary(const QByteArray& data) {
-    type_ = SampleType::Binary;
-    data_ = data;
+void DatasetSample::setEncodedImage(const QByteArray& bytes, const QByteArray& format, const QSize& size) {
+    PayloadSource source;
+    source.bytes = bytes;
+    source.format = format;
+    source.decodedSize = size.isValid() ? qint64(size.width()) * size.height() * 4 : bytes.size();
+    setSource(SampleType::Image, source);
 }
 
-void DatasetSample::setMultimodal(const MultimodalData& data) {
-    type_ = SampleType::Multimodal;
-    data_ = QVariant::fromValue(data);
+QByteArray DatasetSample::encodedImage() const {
+    if (type() != SampleType::Image || !source_.isValid()) {
+        return QByteArray();
+    }
+    if (!source_.isFile()) {
+        return source_.bytes;
+    }
+    
+    QFile file(source_.path);
+    if (!file.open(QIODevice::ReadOnly) || !file.seek(source_.offset)) {
+        return QByteArray();
+    }
+    return source_.length < 0 ? file.readAll() : file.read(source_.length);
+}
+
+std::shared_ptr<const SamplePayload> DatasetSample::loadPayload() const {
+    return PayloadCache::instance().fetch(type(), source_);
 }
 
-QVariantMap DatasetSample::toVariantMap() const {
+QVariantMap DatasetSample::toVariantMap(BlobStore* store) const {
     QVariantMap map;
     
     // Add type
-    map["type"] = static_cast<int>(type_);
+    map["type"] = static_cast<int>(type());
+    
+    // Large payloads go to the store when there is one; an empty hash
+    // (write failed) falls back to inline data
+    auto storeBytes = [store](const QByteArray& bytes) {
+        return store && bytes.size() >= BlobStore::MinBlobSize ? store->put(bytes) : QString();
+    };
     
     // Add data based on type
-    switch (type_) {
-        case SampleType::Text:
-            map["data"] = asText();
+    switch (type()) {
+        case SampleType::Text: {
+            // Text loaded from one of the store's blobs is that blob already
+            if (store && isFileBacked() && !store->hashOfPath(source_.path).isEmpty()) {
+                map["blob"] = store->putSource(source_);
+                break;
+            }
+            
+            const Utf8Text text = asUtf8Text();
+            const QString hash = storeBytes(text.toByteArray());
+            if (!hash.isEmpty()) {
+                map["blob"] = hash;
+            } else {
+                map["data"] = text.toString();
+            }
             break;
+        }
         case SampleType::Image: {
-            QImage img = asImage();
-            if (!img.isNull()) {
-                QByteArray imageData;
-                QBuffer buffer(&imageData);
+            // Original compressed bytes pass through; pixels are only
+            // encoded (as PNG) for images that have none
+            if (store && source_.isValid()) {
+                const QString hash = store->putSource(source_);
+                if (!hash.isEmpty()) {
+                    map["blob"] = hash;
+                    if (!source_.format.isEmpty()) map["format"] = QString(source_.format);
+                    break;
+                }
+            }
+            
+            QByteArray encoded = encodedImage();
+            const bool original = !encoded.isEmpty();
+            if (!original && !asImage().isNull()) {
+                QBuffer buffer(&encoded);
                 buffer.open(QIODevice::WriteOnly);
-                img.save(&buffer, "PNG");
-                map["data"] = imageData.toBase64();
+                asImage().save(&buffer, "PNG");
+            }
+            if (encoded.isEmpty()) {
+                break;
             }
+            
+            const QString hash = store ? store->put(encoded) : QString();
+            if (!hash.isEmpty()) {
+                map["blob"] = hash;
+            } else {
+                map["data"] = Base64::encode(encoded);
+            }
+            if (original && !source_.format.isEmpty()) map["format"] = QString(source_.format);
             break;
         }
-        case SampleType::Audio:
-            map["data"] = asAudio().toVariantMap();
+        case SampleType::Audio: {
+            const AudioData audio = asAudio();
+            const QString hash = storeBytes(audio.samples);
+            if (hash.isEmpty()) {
+                map["data"] = audio.toVariantMap();
+                break;
+            }
+            
+            AudioData header = audio;
+            header.samples.clear();
+            QVariantMap data = header.toVariantMap();
+            data.remove("samples");
+            map["data"] = data;
+            map["blob"] = hash;
             break;
-        case SampleType::Binary:
-            map["data"] = asBinary().toBase64();
+        }
+        case SampleType::Binary: {
+            const QString hash = storeBytes(asBinary());
+            if (!hash.isEmpty()) {
+                map["blob"] = hash;
+            } else {
+                map["data"] = Base64::encode(asBinary());
+            }
             break;
+        }
         case SampleType::Multimodal:
             map["data"] = asMultimodal().toVariantMap();
             break;
@@ -166,28 +345,165 @@ QVariantMap DatasetSample::toVariantMap() const {
     return map;
 }
 
-DatasetSample DatasetSample::fromVariantMap(const QVariantMap& map) {
+QString DatasetSample::writeJsonMembers(JsonEmitter& json, BlobStore* store) const {
+    // The decisions of toVariantMap(), written in the key order of its map:
+    // blob, data, format, metadata, type
+    auto storeBytes = [store](const QByteArray& bytes) {
+        return store && bytes.size() >= BlobStore::MinBlobSize ? store->put(bytes) : QString();
+    };
+    auto writeBlob = [&json](const QString& hash) {
+        json.key("blob");
+        json.value(hash);
+        return hash;
+    };
+    
+    QString blob;
+    switch (type()) {
+        case SampleType::Text: {
+            if (store && isFileBacked() && !store->hashOfPath(source_.path).isEmpty()) {
+                blob = writeBlob(store->putSource(source_));
+                break;
+            }
+            
+            const Utf8Text text = asUtf8Text();
+            const QString hash = storeBytes(text.toByteArray());
+            if (!hash.isEmpty()) {
+                blob = writeBlob(hash);
+            } else {
+                json.key("data");
+                json.utf8Value(text.utf8());
+            }
+            break;
+        }
+        case SampleType::Image: {
+            if (store && source_.isValid()) {
+                const QString hash = store->putSource(source_);
+                if (!hash.isEmpty()) {
+                    blob = writeBlob(hash);
+                    if (!source_.format.isEmpty()) {
+                        json.key("format");
+                        json.value(QString(source_.format));
+                    }
+                    break;
+                }
+            }
+            
+            QByteArray encoded = encodedImage();
+            const bool original = !encoded.isEmpty();
+            if (!original && !asImage().isNull()) {
+                QBuffer buffer(&encoded);
+                buffer.open(QIODevice::WriteOnly);
+                asImage().save(&buffer, "PNG");
+            }
+            if (encoded.isEmpty()) {
+                break;
+            }
+            
+            const QString hash = store ? store->put(encoded) : QString();
+            if (!hash.isEmpty()) {
+                blob = writeBlob(hash);
+            } else {
+                json.key("data");
+                json.base64Value(encoded);
+            }
+            if (original && !source_.format.isEmpty()) {
+                json.key("format");
+                json.value(QString(source_.format));
+            }
+            break;
+        }
+        case SampleType::Audio: {
+            const AudioData audio = asAudio();
+            const QString hash = storeBytes(audio.samples);
+            if (!hash.isEmpty()) {
+                blob = writeBlob(hash);
+            }
+            json.key("data");
+            audio.writeJson(json, hash.isEmpty());
+            break;
+        }
+        case SampleType::Binary: {
+            const QString hash = storeBytes(asBinary());
+            if (!hash.isEmpty()) {
+                blob = writeBlob(hash);
+            } else {
+                json.key("data");
+                json.base64Value(asBinary());
+            }
+            break;
+        }
+        case SampleType::Multimodal:
+            json.key("data");
+            asMultimodal().writeJson(json);
+            break;
+    }
+    
+    json.key("metadata");
+    metadata_.writeJson(json);
+    json.key("type");
+    json.value(static_cast<int>(type()));
+    return blob;
+}
+
+DatasetSample DatasetSample::fromVariantMap(const QVariantMap& map, const BlobStore* store) {
     auto type = static_cast<SampleType>(map.value("type").toInt());
     DatasetSample sample(type);
     
     QVariant dataVariant = map.value("data");
     
+    // Payloads kept in a store are read from the blob file on access
+    const QString blob = map.value("blob").toString();
+    PayloadSource blobSource;
+    if (!blob.isEmpty() && store && store->contains(blob)) {
+        blobSource.path = store->pathFor(blob);
+        blobSource.decodedSize = QFileInfo(blobSource.path).size();
+    }
+    
     switch (type) {
         case SampleType::Text:
-            sample.setText(dataVariant.toString());
+            if (!blob.isEmpty()) {
+                sample.setSource(type, blobSource);
+            } else {
+                sample.setText(dataVariant.toString());
+            }
             break;
         case SampleType::Image: {
-            QByteArray imageData = QByteArray::fromBase64(dataVariant.toByteArray());
-            QImage img;
-            img.loadFromData(imageData);
-            sample.setImage(img);
+            QByteArray format = map.value("format").toString().toLatin1();
+            if (!blob.isEmpty()) {
+                QImageReader reader(blobSource.path, format);
+                const QSize size = reader.size();
+                blobSource.format = format.isEmpty() ? reader.format() : format;
+                if (size.isValid()) blobSource.decodedSize = qint64(size.width()) * size.height() * 4;
+                sample.setSource(type, blobSource);
+                break;
+            }
+            
+            // Keep the bytes and decode on first access; the header gives the size
+            QByteArray imageData = dataVariant.toByteArray();
+            Base64::decodeInPlace(imageData);
+            QBuffer buffer(&imageData);
+            buffer.open(QIODevice::ReadOnly);
+            QImageReader reader(&buffer);
+            if (format.isEmpty()) format = reader.format();
+            sample.setEncodedImage(imageData, format, reader.size());
             break;
         }
-        case SampleType::Audio:
-            sample.setAudio(AudioData::fromVariantMap(dataVariant.toMap()));
+        case SampleType::Audio: {
+            AudioData audio = AudioData::fromVariantMap(dataVariant.toMap());
+            if (!blob.isEmpty() && store) {
+                audio.samples = store->read(blob);
+            }
+            sample.setAudio(audio);
             break;
+        }
         case SampleType::Binary:
-            sample.setBinary(QByteArray::fromBase64(dataVariant.toByteArray()));
+            if (!blob.isEmpty()) {
+                sample.setSource(type, blobSource);
+            } else {
+                QByteArray bytes = dataVariant.toByteArray();
+                Base64::decodeInPlace(bytes);
+                sample.setBinary(bytes);
+            }
             break;
         case SampleType::Multimodal:
             sample.setMultimodal(MultimodalData::fromVariantMap(dataVariant.toMap()));
@@ -200,41 +516,64 @@ DatasetSample DatasetSample::fromVariantMap(const QVariantMap& map) {
 }
 
 bool DatasetSample::isEmpty() const {
-    switch (type_) {
+    if (source_.isValid()) {
+        return false;  // Not decoded just to find out
+    }
+    return payloadIsEmpty(data_);
+}
+
+qint64 DatasetSample::dataSize() const {
+    if (source_.isValid()) {
+        return source_.decodedSize;
+    }
+    return payloadSize(data_);
+}
+
+// Payload helpers
+SamplePayload emptyPayload(SampleType type) {
+    switch (type) {
         case SampleType::Text:
-            return asText().isEmpty();
+            return Utf8Text();
         case SampleType::Image:
-            return asImage().isNull();
+            return QImage();
         case SampleType::Audio:
-            return asAudio().samples.isEmpty();
+            return AudioData();
         case SampleType::Binary:
-            return asBinary().isEmpty();
+            return QByteArray();
         case SampleType::Multimodal:
-            return asMultimodal().text.isEmpty() && 
-                   asMultimodal().image.isNull() && 
-                   asMultimodal().audio.samples.isEmpty();
+            return MultimodalData();
     }
-    return true;
+    return Utf8Text();
 }
 
-qint64 DatasetSample::dataSize() const {
-    switch (type_) {
-        case SampleType::Text:
-            return asText().size();
-        case SampleType::Image: {
-            QImage img = asImage();
-            return img.sizeInBytes();
+qint64 payloadSize(const SamplePayload& payload) {
+    return std::visit([](const auto& value) -> qint64 {
+        using T = std::decay_t<decltype(value)>;
+        if constexpr (std::is_same_v<T, QImage>) {
+            return value.sizeInBytes();
+        } else if constexpr (std::is_same_v<T, AudioData>) {
+            return value.samples.size();
+        } else if constexpr (std::is_same_v<T, MultimodalData>) {
+            return value.text.size() + value.imageSize() + value.audio.samples.size();
+        } else {
+            return value.size();
         }
-        case SampleType::Audio:
-            return asAudio().samples.size();
-        case SampleType::Binary:
-            return asBinary().size();
-        case SampleType::Multimodal: {
-            auto mm = asMultimodal();
-            return mm.text.size() + mm.image.sizeInBytes() + mm.audio.samples.size();
+    }, payload);
+}
+
+bool payloadIsEmpty(const SamplePayload& payload) {
+    return std::visit([](const auto& value) -> bool {
+        using T = std::decay_t<decltype(value)>;
+        if constexpr (std::is_same_v<T, QImage>) {
+            return value.isNull();
+        } else if constexpr (std::is_same_v<T, AudioData>) {
+            return value.samples.isEmpty();
+        } else if constexpr (std::is_same_v<T, MultimodalData>) {
+            return value.text.isEmpty() && !value.hasImage() && value.audio.samples.isEmpty();
+        } else {
+            return value.isEmpty();
         }
-    }
-    return 0;
+    }, payload);
 }
 
 } // namespace DatasetCreator
@@ -1,20 +1,25 @@
 #pragma once
 
 #include "Metadata.h"
+#include "Utf8.h"
 #include <QString>
 #include <QVariant>
 #include <QImage>
 #include <QByteArray>
 #include <QAudioFormat>
 #include <memory>
+#include <variant>
 
 namespace DatasetCreator {
 
+class BlobStore;
+class JsonEmitter;
+
 /**
  * @brief Sample data type enumeration
  */
 enum class SampleType {
-    Text,          // Plain text data
+    Text,          // Plain text data (UTF-8)
     Image,         // Image data (QImage)
     Audio,         // Audio data (raw PCM samples)
     Binary,        // Generic binary data
@@ -27,27 +32,92 @@ enum class SampleType {
 struct AudioData {
     QByteArray samples;          // Raw audio samples (PCM)
     QAudioFormat format;         // Audio format information
-    qint64 durationMs;          // Duration in milliseconds
+    qint64 durationMs = 0;      // Duration in milliseconds
     
     QVariantMap toVariantMap() const;
     static AudioData fromVariantMap(const QVariantMap& map);
+    void writeJson(JsonEmitter& json, bool withSamples = true) const;
 };
 
 /**
  * @brief Multimodal data container
+ *
+ * The image is held either as pixels or as its original compressed bytes,
+ * never both. Compressed bytes are written through unchanged and decoded
+ * through the shared PayloadCache when image() is called.
  */
 struct MultimodalData {
     QString text;
-    QImage image;
     AudioData audio;
     QVariantMap additionalData;
     
+    QImage image() const;
+    void setImage(const QImage& image);                                  // Drops encoded bytes
+    void setEncodedImage(const QByteArray& bytes, const QByteArray& format);  // Drops pixels
+    QByteArray encodedImage() const { return encodedImage_; }
+    QByteArray imageFormat() const { return imageFormat_; }
+    bool hasImage() const { return !encodedImage_.isEmpty() || !image_.isNull(); }
+    qint64 imageSize() const;    // Bytes held for the image
+    
     QVariantMap toVariantMap() const;
     static MultimodalData fromVariantMap(const QVariantMap& map);
+    void writeJson(JsonEmitter& json) const;
+
+private:
+    QImage image_;
+    QByteArray encodedImage_;    // Original compressed bytes of the image
+    QByteArray imageFormat_;     // Format of encodedImage_ ("jpeg", "png", ...)
+};
+
+/**
+ * @brief Sample payload - one alternative per SampleType, in enum order
+ */
+using SamplePayload = std::variant<Utf8Text, QImage, AudioData, QByteArray, MultimodalData>;
+
+template<SampleType T>
+using PayloadType = std::variant_alternative_t<static_cast<std::size_t>(T), SamplePayload>;
+
+SamplePayload emptyPayload(SampleType type);
+qint64 payloadSize(const SamplePayload& payload);  // Approximate size in bytes
+bool payloadIsEmpty(const SamplePayload& payload);
+
+/**
+ * @brief Where a lazily decoded payload is decoded from
+ *
+ * Either a byte range of a file, or encoded bytes held in memory (an image
+ * loaded from a project or export keeps its original compressed bytes).
+ */
+struct PayloadSource {
+    QString path;
+    qint64 offset = 0;           // Byte offset of the payload in the file
+    qint64 length = -1;          // Payload bytes, -1 for the rest of the file
+    QByteArray bytes;            // In-memory encoded payload (instead of path)
+    QByteArray format;           // Encoded format if known ("jpeg", "png", ...)
+    qint64 decodedSize = 0;      // Expected decoded size, known without decoding
+    std::shared_ptr<const void> keepAlive;  // Keeps path valid while the source is in use
+    
+    bool isValid() const { return !path.isEmpty() || !bytes.isEmpty(); }
+    bool isFile() const { return !path.isEmpty(); }
 };
 
 /**
  * @brief Dataset sample - represents a single data point in the dataset
+ *
+ * The sample type is the active alternative of the payload, so the two can
+ * never disagree. The as*() accessors return the payload (or an empty value
+ * if the sample holds another type) by value; the payload types are
+ * implicitly shared, so this shares the data rather than copying it.
+ * asText() converts the UTF-8 text to a QString on each call, so code that
+ * does not display it should use asUtf8Text().
+ *
+ * A file-backed sample holds only a PayloadSource and is decoded on access
+ * through the shared PayloadCache. The returned value keeps the decoded
+ * data alive after the cache drops it; views into it (such as
+ * Utf8Text::utf8()) are only valid while that value is.
+ *
+ * Image samples read from compressed files keep those bytes: serializers
+ * write encodedImage() through unchanged instead of re-encoding pixels,
+ * and pixels are only decoded when asImage() is called.
  */
 class DatasetSample {
 public:
@@ -55,43 +125,91 @@ public:
     explicit DatasetSample(SampleType type);
     
     // Type accessors
-    SampleType type() const { return type_; }
-    void setType(SampleType type) { type_ = type; }
+    SampleType type() const { return static_cast<SampleType>(data_.index()); }
+    void setType(SampleType type);  // Clears the payload if the type changes
     
     // Data accessors (type-safe getters)
-    QString asText() const;
-    QImage asImage() const;
-    AudioData asAudio() const;
-    QByteArray asBinary() const;
-    MultimodalData asMultimodal() const;
+    QString asText() const { return payload<SampleType::Text>().toString(); }
+    Utf8Text asUtf8Text() const { return payload<SampleType::Text>(); }
+    QImage asImage() const { return payload<SampleType::Image>(); }
+    AudioData asAudio() const { return payload<SampleType::Audio>(); }
+    QByteArray asBinary() const { return payload<SampleType::Binary>(); }
+    MultimodalData asMultimodal() const { return payload<SampleType::Multimodal>(); }
+    
+    /**
+     * @brief Payload of a type known at compile time
+     * @return The payload, or an empty value if the sample holds another type
+     */
+    template<SampleType T>
+    PayloadType<T> payload() const {
+        const std::shared_ptr<const SamplePayload> loaded = source_.isValid() ? loadPayload() : nullptr;
+        const auto* value = std::get_if<static_cast<std::size_t>(T)>(loaded ? loaded.get() : &data_);
+        return value ? *value : PayloadType<T>();
+    }
     
     // Data setters
     void setText(const QString& text);
+    void setText(const Utf8Text& text);
     void setImage(const QImage& image);
     void setAudio(const AudioData& audio);
     void setBinary(const QByteArray& data);
     void setMultimodal(const MultimodalData& data);
     
-    // Generic data access (for custom types)
-    QVariant data() const { return data_; }
-    void setData(const QVariant& data) { data_ = data; }
+    // Generic payload access (e.g. for std::visit)
+    SamplePayload data() const { return source_.isValid() ? *loadPayload() : data_; }
+    void setData(const SamplePayload& data) { data_ = data; source_ = PayloadSource(); }
+    
+    // File-backed payloads (any setter replaces the source with in-memory data)
+    void setSource(SampleType type, const PayloadSource& source);
+    const PayloadSource& source() const { return source_; }
+    bool isFileBacked() const { return source_.isFile(); }
+    bool isLazy() const { return source_.isValid(); }  // File-backed or held encoded
+    
+    /**
+     * @brief Original compressed image bytes
+     *
+     * setEncodedImage() makes an image sample that holds only the encoded
+     * bytes, decoded on first access. encodedImage() returns them (reading
+     * the source range of a file-backed image), or an empty array if the
+     * sample only has pixels.
+     */
+    void setEncodedImage(const QByteArray& bytes, const QByteArray& format, const QSize& size);
+    QByteArray encodedImage() const;
+    QByteArray encodedImageFormat() const { return source_.format; }
     
     // Metadata accessors
     SampleMetadata& metadata() { return metadata_; }
     const SampleMetadata& metadata() const { return metadata_; }
     void setMetadata(const SampleMetadata& meta) { metadata_ = meta; }
     
-    // Serialization
-    QVariantMap toVariantMap() const;
-    static DatasetSample fromVariantMap(const QVariantMap& map);
+    /**
+     * @brief Serialization
+     *
+     * With a store, image, binary, audio and larger text payloads are put
+     * into it and written as {"blob": hash} instead of inline base64; reading
+     * such a map back makes the sample backed by the blob file.
+     */
+    QVariantMap toVariantMap(BlobStore* store = nullptr) const;
+    static DatasetSample fromVariantMap(const QVariantMap& map, const BlobStore* store = nullptr);
+    
+    /**
+     * @brief Write the members of toVariantMap(store) into an open JSON object
+     *
+     * The same bytes QJsonDocument writes for that map, without building
+     * it. Callers may write members whose keys sort before "blob" first.
+     * @return The blob hash written, or an empty string
+     */
+    QString writeJsonMembers(JsonEmitter& json, BlobStore* store = nullptr) const;
     
     // Utility
     bool isEmpty() const;
     qint64 dataSize() const;  // Approximate size in bytes
-    
+
 private:
-    SampleType type_;
-    QVariant data_;
+    std::shared_ptr<const SamplePayload> loadPayload() const;
+    
+    SamplePayload data_;         // Empty placeholder of the type when file-backed
+    PayloadSource source_;
     SampleMetadata metadata_;
 };
 
@@ -0,0 +1,69 @@
+#include "DatasetStats.h"
+
+namespace DatasetCreator {
+
+// SampleStats implementation
+void SampleStats::add(const DatasetSample& sample) {
+    ++count;
+    bytes += sample.dataSize();
+    ++typeCounts[static_cast<int>(sample.type())];
+}
+
+void SampleStats::remove(const DatasetSample& sample) {
+    --count;
+    bytes -= sample.dataSize();
+    --typeCounts[static_cast<int>(sample.type())];
+}
+
+void SampleStats::merge(const SampleStats& other) {
+    count += other.count;
+    bytes += other.bytes;
+    for (std::size_t i = 0; i < typeCounts.size(); ++i) {
+        typeCounts[i] += other.typeCounts[i];
+    }
+}
+
+QMap<SampleType, int> SampleStats::typeDistribution() const {
+    QMap<SampleType, int> distribution;
+    for (std::size_t i = 0; i < typeCounts.size(); ++i) {
+        if (typeCounts[i] > 0) {
+            distribution[static_cast<SampleType>(i)] = typeCounts[i];
+        }
+    }
+    return distribution;
+}
+
+// LabelCounts implementation
+void LabelCounts::add(const QVariantMap& labels) {
+    for (auto it = labels.cbegin(); it != labels.cend(); ++it) {
+        ++counts_[it.key()][it.value().toString()];
+    }
+}
+
+void LabelCounts::remove(const QVariantMap& labels) {
+    for (auto it = labels.cbegin(); it != labels.cend(); ++it) {
+        auto key = counts_.find(it.key());
+        if (key == counts_.end()) continue;
+        
+        auto value = key->find(it.value().toString());
+        if (value != key->end() && --value.value() <= 0) {
+            key->erase(value);
+            if (key->isEmpty()) {
+                counts_.erase(key);
+            }
+        }
+    }
+}
+
+QStringList LabelCounts::keys() const {
+    QStringList keys = counts_.keys();
+    keys.sort();
+    return keys;
+}
+
+int LabelCounts::count(const QString& key, const QString& value) const {
+    auto it = counts_.constFind(key);
+    return it == counts_.constEnd() ? 0 : it->value(value);
+}
+
+} // namespace DatasetCreator
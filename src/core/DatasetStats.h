@@ -0,0 +1,47 @@
+#pragma once
+
+#include "DatasetSample.h"
+#include <QHash>
+#include <QMap>
+#include <QStringList>
+#include <array>
+
+namespace DatasetCreator {
+
+/**
+ * @brief Running sample count, byte total and per-type counts
+ *
+ * Updated by the owner on every add/remove, so reading is O(1).
+ */
+struct SampleStats {
+    int count = 0;
+    qint64 bytes = 0;
+    std::array<int, 5> typeCounts{};    // Indexed by SampleType
+    
+    void add(const DatasetSample& sample);
+    void remove(const DatasetSample& sample);
+    void merge(const SampleStats& other);
+    void clear() { *this = SampleStats(); }
+    
+    int typeCount(SampleType type) const { return typeCounts[static_cast<int>(type)]; }
+    QMap<SampleType, int> typeDistribution() const;  // Types with at least one sample
+};
+
+/**
+ * @brief Running counts of label values: label key -> value -> samples
+ */
+class LabelCounts {
+public:
+    void add(const QVariantMap& labels);
+    void remove(const QVariantMap& labels);
+    void clear() { counts_.clear(); }
+    
+    QStringList keys() const;
+    QHash<QString, int> valueCounts(const QString& key) const { return counts_.value(key); }
+    int count(const QString& key, const QString& value) const;
+
+private:
+    QHash<QString, QHash<QString, int>> counts_;
+};
+
+} // namespace DatasetCreator
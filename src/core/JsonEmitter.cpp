@@ -0,0 +1,483 @@
+#include "JsonEmitter.h"
+#include "Base64.h"
+#include <QJsonArray>
+#include <QJsonObject>
+#include <bit>
+#include <charconv>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace DatasetCreator {
+
+JsonEmitter::JsonEmitter(Style style)
+    : style_(style)
+{
+}
+
+void JsonEmitter::clear(int depth) {
+    out_.resize(0);  // Keeps the capacity, unlike QByteArray::clear()
+    hasElements_.clear();
+    depth_ = depth;
+    afterKey_ = false;
+}
+
+char* JsonEmitter::grow(qsizetype bytes) {
+    const qsizetype size = out_.size();
+    if (out_.capacity() < size + bytes) {
+        out_.reserve(qMax(2 * out_.capacity(), size + bytes));
+    }
+    out_.resize(size + bytes);
+    return out_.data() + size;
+}
+
+void JsonEmitter::appendIndent(int depth) {
+    out_.append(4 * depth, ' ');
+}
+
+void JsonEmitter::beginValue() {
+    // A member value follows its key; array elements need a separator
+    if (afterKey_) {
+        afterKey_ = false;
+        return;
+    }
+    if (hasElements_.isEmpty()) {
+        return;
+    }
+    
+    if (hasElements_.last()) {
+        out_.append(style_ == Style::Compact ? "," : ",\n");
+    }
+    hasElements_.last() = true;
+    if (style_ == Style::Indented) {
+        appendIndent(depth_ + hasElements_.size());
+    }
+}
+
+void JsonEmitter::open(char bracket) {
+    beginValue();
+    out_.append(bracket);
+    if (style_ == Style::Indented) {
+        out_.append('\n');
+    }
+    hasElements_.append(false);
+}
+
+void JsonEmitter::close(char bracket) {
+    const bool hadElements = hasElements_.takeLast();
+    if (style_ == Style::Indented) {
+        if (hadElements) {
+            out_.append('\n');
+        }
+        appendIndent(depth_ + hasElements_.size());
+    }
+    out_.append(bracket);
+}
+
+void JsonEmitter::beginObject() { open('{'); }
+void JsonEmitter::endObject() { close('}'); }
+void JsonEmitter::beginArray() { open('['); }
+void JsonEmitter::endArray() { close(']'); }
+
+void JsonEmitter::key(const char* name) {
+    beginValue();
+    out_.append('"');
+    out_.append(name);
+    out_.append(style_ == Style::Compact ? "\":" : "\": ");
+    afterKey_ = true;
+}
+
+void JsonEmitter::key(QStringView name) {
+    beginValue();
+    appendString(name);
+    out_.append(style_ == Style::Compact ? ":" : ": ");
+    afterKey_ = true;
+}
+
+void JsonEmitter::nullValue() {
+    beginValue();
+    out_.append("null");
+}
+
+void JsonEmitter::value(bool b) {
+    beginValue();
+    out_.append(b ? "true" : "false");
+}
+
+void JsonEmitter::value(qint64 n) {
+    beginValue();
+    char* const begin = grow(24);
+    const auto result = std::to_chars(begin, begin + 24, n);
+    out_.truncate(result.ptr - out_.constData());
+}
+
+void JsonEmitter::value(double d) {
+    beginValue();
+    if (std::isfinite(d)) {
+        appendDouble(out_, d);
+    } else {
+        out_.append("null");  // As QJsonDocument writes infinities and NaN
+    }
+}
+
+void JsonEmitter::value(QStringView text) {
+    beginValue();
+    appendString(text);
+}
+
+void JsonEmitter::value(const QStringList& list) {
+    beginArray();
+    for (const QString& item : list) {
+        value(QStringView(item));
+    }
+    endArray();
+}
+
+void JsonEmitter::value(const QVariantMap& map) {
+    // QVariantMap and QJsonObject both order keys by UTF-16 code units
+    beginObject();
+    for (auto it = map.constBegin(); it != map.constEnd(); ++it) {
+        key(QStringView(it.key()));
+        value(it.value());
+    }
+    endObject();
+}
+
+void JsonEmitter::value(const QVariantList& list) {
+    beginArray();
+    for (const QVariant& item : list) {
+        value(item);
+    }
+    endArray();
+}
+
+void JsonEmitter::value(const QVariant& variant) {
+    // The common metadata types directly; anything else as QJsonValue
+    // would convert it
+    switch (variant.metaType().id()) {
+        case QMetaType::Bool:
+            value(variant.toBool());
+            break;
+        case QMetaType::Short:
+        case QMetaType::UShort:
+        case QMetaType::Int:
+        case QMetaType::UInt:
+        case QMetaType::Long:
+        case QMetaType::LongLong:
+            value(variant.toLongLong());
+            break;
+        case QMetaType::ULong:
+        case QMetaType::ULongLong:
+            if (variant.toULongLong() <= quint64(std::numeric_limits<qint64>::max())) {
+                value(variant.toLongLong());
+            } else {
+                value(variant.toDouble());
+            }
+            break;
+        case QMetaType::Float:
+        case QMetaType::Double:
+            value(variant.toDouble());
+            break;
+        case QMetaType::QString:
+            value(variant.toString());
+            break;
+        case QMetaType::QStringList:
+            value(variant.toStringList());
+            break;
+        case QMetaType::QVariantList:
+            value(variant.toList());
+            break;
+        case QMetaType::QVariantMap:
+            value(variant.toMap());
+            break;
+        default:
+            value(QJsonValue::fromVariant(variant));
+            break;
+    }
+}
+
+void JsonEmitter::value(const QJsonValue& json) {
+    switch (json.type()) {
+        case QJsonValue::Bool:
+            value(json.toBool());
+            break;
+        case QJsonValue::Double: {
+            // Integers are kept apart from doubles and written without rounding
+            const QVariant number = json.toVariant();
+            if (number.metaType().id() == QMetaType::LongLong) {
+                value(number.toLongLong());
+            } else {
+                value(number.toDouble());
+            }
+            break;
+        }
+        case QJsonValue::String:
+            value(json.toString());
+            break;
+        case QJsonValue::Array: {
+            const QJsonArray array = json.toArray();
+            beginArray();
+            for (const QJsonValue& item : array) {
+                value(item);
+            }
+            endArray();
+            break;
+        }
+        case QJsonValue::Object: {
+            const QJsonObject object = json.toObject();
+            beginObject();
+            for (auto it = object.constBegin(); it != object.constEnd(); ++it) {
+                key(QStringView(it.key()));
+                value(it.value());
+            }
+            endObject();
+            break;
+        }
+        case QJsonValue::Null:
+        case QJsonValue::Undefined:
+            nullValue();
+            break;
+    }
+}
+
+void JsonEmitter::asciiValue(const QByteArray& ascii) {
+    if (ascii.isEmpty()) {
+        value(QVariant(ascii));
+        return;
+    }
+    beginValue();
+    out_.append('"');
+    out_.append(ascii);
+    out_.append('"');
+}
+
+void JsonEmitter::base64Value(QByteArrayView data) {
+    if (data.isEmpty()) {
+        value(QVariant(QByteArray()));
+        return;
+    }
+    beginValue();
+    char* const cursor = grow(Base64::encodedSize(data.size()) + 2);
+    cursor[0] = '"';
+    Base64::encode(data, cursor + 1);
+    cursor[Base64::encodedSize(data.size()) + 1] = '"';
+}
+
+void JsonEmitter::utf8Value(QByteArrayView utf8) {
+    beginValue();
+    appendUtf8String(utf8);
+}
+
+void JsonEmitter::appendDouble(QByteArray& out, double d) {
+    // Shortest round-trip digits, then Qt's choice between decimal and
+    // exponent form: decimal unless it needs more than bias extra characters
+    char buffer[32];
+    const char* const end = std::to_chars(buffer, buffer + sizeof(buffer), d,
+                                          std::chars_format::scientific).ptr;
+    const char* p = buffer;
+    if (*p == '-') {
+        out.append('-');
+        ++p;
+    }
+    
+    char digits[20];
+    int digitCount = 0;
+    for (; *p != 'e'; ++p) {
+        if (*p != '.') digits[digitCount++] = *p;
+    }
+    ++p;
+    const bool negativeExponent = *p == '-';
+    int exponent = 0;
+    std::from_chars(p + 1, end, exponent);
+    if (negativeExponent) exponent = -exponent;
+    
+    const int decimalPoint = exponent + 1;
+    // "e+XX" is four characters; the decimal form loses its point when all
+    // digits come before it, the exponent form when there is only one digit
+    int bias = 4;
+    if (digitCount > 1 && digitCount <= decimalPoint) {
+        ++bias;
+    } else if (digitCount == 1 && decimalPoint <= 0) {
+        --bias;
+    }
+    const bool useDecimal = decimalPoint <= 0 ? 1 - decimalPoint <= bias : decimalPoint <= digitCount + bias;
+    if (!useDecimal) {
+        out.append(digits[0]);
+        if (digitCount > 1) {
+            out.append('.');
+            out.append(digits + 1, digitCount - 1);
+        }
+        out.append(negativeExponent ? "e-" : "e+");
+        const int magnitude = negativeExponent ? -exponent : exponent;
+        if (magnitude < 10) out.append('0');
+        out.append(QByteArray::number(magnitude));
+    } else if (decimalPoint <= 0) {
+        out.append("0.");
+        out.append(-decimalPoint, '0');
+        out.append(digits, digitCount);
+    } else if (decimalPoint >= digitCount) {
+        out.append(digits, digitCount);
+        out.append(decimalPoint - digitCount, '0');
+    } else {
+        out.append(digits, decimalPoint);
+        out.append('.');
+        out.append(digits + decimalPoint, digitCount - decimalPoint);
+    }
+}
+
+void JsonEmitter::appendString(QStringView text) {
+    static constexpr char hex[] = "0123456789abcdef";
+    
+    // Worst case is six bytes per UTF-16 unit (\u00XX, lone surrogates)
+    char* const begin = grow(6 * text.size() + 2);
+    char* cursor = begin;
+    *cursor++ = '"';
+    
+    const char16_t* src = text.utf16();
+    const char16_t* const end = src + text.size();
+    while (src != end) {
+#if defined(__SSE2__)
+        // Printable ASCII other than '"' and '\' is narrowed eight units at
+        // a time; all eight are stored, the cursor only moves past the run
+        while (end - src >= 8) {
+            const __m128i units = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+            const __m128i nonAscii = _mm_andnot_si128(
+                _mm_cmpeq_epi16(_mm_and_si128(units, _mm_set1_epi16(short(0xff80))), _mm_setzero_si128()),
+                _mm_set1_epi16(-1));
+            const __m128i control = _mm_cmplt_epi16(units, _mm_set1_epi16(0x20));
+            const __m128i escaped = _mm_or_si128(_mm_cmpeq_epi16(units, _mm_set1_epi16('"')),
+                                                 _mm_cmpeq_epi16(units, _mm_set1_epi16('\\')));
+            const unsigned special = unsigned(_mm_movemask_epi8(
+                _mm_or_si128(nonAscii, _mm_or_si128(control, escaped))));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(cursor), _mm_packus_epi16(units, units));
+            if (special) {
+                const int run = std::countr_zero(special) / 2;
+                cursor += run;
+                src += run;
+                break;
+            }
+            cursor += 8;
+            src += 8;
+        }
+        if (src == end) {
+            break;
+        }
+#endif
+        // Same escapes and UTF-8 conversion as QJsonDocument
+        const char16_t u = *src++;
+        if (u < 0x80) {
+            if (u >= 0x20 && u != '"' && u != '\\') {
+                *cursor++ = char(u);
+                continue;
+            }
+            *cursor++ = '\\';
+            switch (u) {
+                case '"': *cursor++ = '"'; break;
+                case '\\': *cursor++ = '\\'; break;
+                case '\b': *cursor++ = 'b'; break;
+                case '\f': *cursor++ = 'f'; break;
+                case '\n': *cursor++ = 'n'; break;
+                case '\r': *cursor++ = 'r'; break;
+                case '\t': *cursor++ = 't'; break;
+                default:
+                    *cursor++ = 'u';
+                    *cursor++ = '0';
+                    *cursor++ = '0';
+                    *cursor++ = hex[u >> 4];
+                    *cursor++ = hex[u & 0xf];
+                    break;
+            }
+        } else if (u < 0x800) {
+            *cursor++ = char(0xc0 | (u >> 6));
+            *cursor++ = char(0x80 | (u & 0x3f));
+        } else if (!QChar::isSurrogate(u)) {
+            *cursor++ = char(0xe0 | (u >> 12));
+            *cursor++ = char(0x80 | ((u >> 6) & 0x3f));
+            *cursor++ = char(0x80 | (u & 0x3f));
+        } else if (QChar::isHighSurrogate(u) && src != end && QChar::isLowSurrogate(*src)) {
+            const char32_t ucs4 = QChar::surrogateToUcs4(u, *src++);
+            *cursor++ = char(0xf0 | (ucs4 >> 18));
+            *cursor++ = char(0x80 | ((ucs4 >> 12) & 0x3f));
+            *cursor++ = char(0x80 | ((ucs4 >> 6) & 0x3f));
+            *cursor++ = char(0x80 | (ucs4 & 0x3f));
+        } else {
+            // Lone surrogates have no UTF-8 form
+            *cursor++ = '\\';
+            *cursor++ = 'u';
+            *cursor++ = hex[u >> 12];
+            *cursor++ = hex[(u >> 8) & 0xf];
+            *cursor++ = hex[(u >> 4) & 0xf];
+            *cursor++ = hex[u & 0xf];
+        }
+    }
+    
+    *cursor++ = '"';
+    out_.truncate(cursor - out_.constData());
+}
+
+void JsonEmitter::appendUtf8String(QByteArrayView utf8) {
+    static constexpr char hex[] = "0123456789abcdef";
+    
+    // Only ASCII is escaped, so multibyte sequences are copied as they are;
+    // the worst case is six bytes per byte (\u00XX)
+    char* const begin = grow(6 * utf8.size() + 2);
+    char* cursor = begin;
+    *cursor++ = '"';
+    
+    const char* src = utf8.data();
+    const char* const end = src + utf8.size();
+    while (src != end) {
+#if defined(__SSE2__)
+        // Sixteen bytes at a time up to the next control character, '"' or '\'
+        while (end - src >= 16) {
+            const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+            const __m128i control = _mm_cmpeq_epi8(_mm_min_epu8(bytes, _mm_set1_epi8(0x1f)), bytes);
+            const __m128i escaped = _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('"')),
+                                                 _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\\')));
+            const unsigned special = unsigned(_mm_movemask_epi8(_mm_or_si128(control, escaped)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(cursor), bytes);
+            if (special) {
+                const int run = std::countr_zero(special);
+                cursor += run;
+                src += run;
+                break;
+            }
+            cursor += 16;
+            src += 16;
+        }
+        if (src == end) {
+            break;
+        }
+#endif
+        const uchar c = uchar(*src++);
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            *cursor++ = char(c);
+            continue;
+        }
+        *cursor++ = '\\';
+        switch (c) {
+            case '"': *cursor++ = '"'; break;
+            case '\\': *cursor++ = '\\'; break;
+            case '\b': *cursor++ = 'b'; break;
+            case '\f': *cursor++ = 'f'; break;
+            case '\n': *cursor++ = 'n'; break;
+            case '\r': *cursor++ = 'r'; break;
+            case '\t': *cursor++ = 't'; break;
+            default:
+                *cursor++ = 'u';
+                *cursor++ = '0';
+                *cursor++ = '0';
+                *cursor++ = hex[c >> 4];
+                *cursor++ = hex[c & 0xf];
+                break;
+        }
+    }
+    
+    *cursor++ = '"';
+    out_.truncate(cursor - out_.constData());
+}
+
+} // namespace DatasetCreator
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QJsonValue>
+#include <QList>
+#include <QString>
+#include <QVariant>
+
+namespace DatasetCreator {
+
+/**
+ * @brief Streaming JSON serializer into a reusable buffer
+ *
+ * Produces exactly the bytes QJsonDocument::toJson() would for the same
+ * values (compact or indented), without building a QJsonDocument: keys are
+ * written in the order given, so objects must be written with sorted keys
+ * as QJsonObject would hold them. Strings are escaped and converted to
+ * UTF-8 in one pass, eight characters at a time where SIMD is available.
+ *
+ * Typical use per record: clear(), write the value, append buffer() to the
+ * output. The buffer keeps its capacity across records.
+ */
+class JsonEmitter {
+public:
+    enum class Style {
+        Compact,       // QJsonDocument::Compact
+        Indented       // QJsonDocument::Indented, four spaces per level
+    };
+    
+    explicit JsonEmitter(Style style = Style::Compact);
+    
+    const QByteArray& buffer() const { return out_; }
+    
+    /**
+     * @brief Start a new value, keeping the buffer's capacity
+     * @param depth Nesting level of the value, for indented values embedded
+     *              in a larger document
+     */
+    void clear(int depth = 0);
+    
+    void beginObject();
+    void endObject();
+    void beginArray();
+    void endArray();
+    
+    // Object member name; a literal is written as is and must need no escaping
+    void key(const char* name);
+    void key(QStringView name);
+    
+    void nullValue();
+    void value(bool b);
+    void value(qint64 n);
+    void value(int n) { value(qint64(n)); }
+    void value(double d);
+    void value(QStringView text);
+    void value(const char* text) = delete;  // Would convert to bool
+    void value(const QString& text) { value(QStringView(text)); }
+    void value(const QStringList& list);
+    void value(const QVariantMap& map);
+    void value(const QVariantList& list);
+    
+    /**
+     * @brief Any value QJsonValue::fromVariant() accepts, converted the same way
+     */
+    void value(const QVariant& variant);
+    void value(const QJsonValue& json);
+    
+    /**
+     * @brief A string known to need no escaping (base64, hex hashes)
+     *
+     * Empty arrays go through value(QVariant) to match how QJsonDocument
+     * converts an empty QByteArray.
+     */
+    void asciiValue(const QByteArray& ascii);
+    
+    /**
+     * @brief Bytes as a base64 string, encoded straight into the buffer
+     */
+    void base64Value(QByteArrayView data);
+    
+    /**
+     * @brief Valid UTF-8 text, escaped as value() escapes the same text
+     */
+    void utf8Value(QByteArrayView utf8);
+    
+    /**
+     * @brief Double formatted as QByteArray::number(d, 'g', QLocale::FloatingPointShortest)
+     */
+    static void appendDouble(QByteArray& out, double d);
+
+private:
+    void beginValue();
+    void open(char bracket);
+    void close(char bracket);
+    void appendIndent(int depth);
+    void appendString(QStringView text);
+    void appendUtf8String(QByteArrayView utf8);
+    char* grow(qsizetype bytes);
+    
+    QByteArray out_;
+    QList<bool> hasElements_;    // One entry per open container
+    Style style_;
+    int depth_ = 0;
+    bool afterKey_ = false;
+};
+
+} // namespace DatasetCreator
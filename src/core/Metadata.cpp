@@ -1,4 +1,5 @@
 #include "Metadata.h"
+#include "JsonEmitter.h"
 
 namespace DatasetCreator {
 
@@ -15,6 +16,19 @@ QVariantMap SampleMetadata::toVariantMap() const {
     return map;
 }
 
+void SampleMetadata::writeJson(JsonEmitter& json) const {
+    // Keys in the order of the map toVariantMap() returns
+    json.beginObject();
+    if (!annotations.isEmpty()) { json.key("annotations"); json.value(annotations); }
+    if (!attributes.isEmpty()) { json.key("attributes"); json.value(attributes); }
+    if (!id.isEmpty()) { json.key("id"); json.value(id); }
+    if (!labels.isEmpty()) { json.key("labels"); json.value(labels); }
+    if (!sourceFile.isEmpty()) { json.key("source_file"); json.value(sourceFile); }
+    if (!tags.isEmpty()) { json.key("tags"); json.value(tags); }
+    if (timestamp.isValid()) { json.key("timestamp"); json.value(timestamp.toString(Qt::ISODate)); }
+    json.endObject();
+}
+
 SampleMetadata SampleMetadata::fromVariantMap(const QVariantMap& map) {
     SampleMetadata meta;
     meta.id = map.value("id").toString();
@@ -7,6 +7,8 @@
 
 namespace DatasetCreator {
 
+class JsonEmitter;
+
 /**
  * @brief Sample-level metadata
  * Stores metadata for individual dataset samples
@@ -23,6 +25,7 @@ struct SampleMetadata {
     // Serialization
     QVariantMap toVariantMap() const;
     static SampleMetadata fromVariantMap(const QVariantMap& map);
+    void writeJson(JsonEmitter& json) const;  // toVariantMap() as a JSON object
 };
 
 /**
@@ -0,0 +1,144 @@
+#include "PayloadCache.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QMutexLocker>
+
+namespace DatasetCreator {
+
+PayloadCache& PayloadCache::instance() {
+    static PayloadCache cache;
+    return cache;
+}
+
+PayloadCache::PayloadCache() {
+    cache_.setMaxCost(512LL * 1024 * 1024);
+}
+
+QString PayloadCache::keyFor(const PayloadSource& source) {
+    if (!source.isFile()) {
+        // In-memory bytes are keyed by their buffer; the entry holds a
+        // reference to it, so the address cannot be reused while cached
+        return QString("mem:%1:%2").arg(quintptr(source.bytes.constData())).arg(source.bytes.size());
+    }
+    // A file rewritten in place changes size or modification time, so
+    // its old entries are no longer found
+    const QFileInfo info(source.path);
+    return QString("%1:%2:%3:%4:%5").arg(source.path).arg(source.offset).arg(source.length)
+                                    .arg(info.size()).arg(info.lastModified().toMSecsSinceEpoch());
+}
+
+std::shared_ptr<const SamplePayload> PayloadCache::fetch(SampleType type, const PayloadSource& source) {
+    const QString key = keyFor(source);
+    
+    {
+        QMutexLocker locker(&mutex_);
+        if (auto* entry = cache_.object(key)) {
+            ++hits_;
+            return entry->payload;
+        }
+    }
+    
+    ++misses_;
+    auto payload = std::make_shared<const SamplePayload>(decode(type, source));
+    const qint64 cost = qMax<qint64>(1, payloadSize(*payload));
+    
+    QMutexLocker locker(&mutex_);
+    cache_.insert(key, new Entry{payload, source.bytes}, cost);
+    return payload;
+}
+
+void PayloadCache::setByteBudget(qint64 bytes) {
+    QMutexLocker locker(&mutex_);
+    cache_.setMaxCost(qMax<qint64>(0, bytes));
+}
+
+qint64 PayloadCache::byteBudget() const {
+    QMutexLocker locker(&mutex_);
+    return cache_.maxCost();
+}
+
+qint64 PayloadCache::bytesUsed() const {
+    QMutexLocker locker(&mutex_);
+    return cache_.totalCost();
+}
+
+void PayloadCache::resetCounters() {
+    hits_ = 0;
+    misses_ = 0;
+}
+
+void PayloadCache::clear() {
+    QMutexLocker locker(&mutex_);
+    cache_.clear();
+}
+
+SamplePayload PayloadCache::decode(SampleType type, const PayloadSource& source) {
+    SamplePayload payload = emptyPayload(type);
+    
+    if (!source.isFile()) {
+        switch (type) {
+            case SampleType::Text:
+                payload.emplace<Utf8Text>(Utf8Text::fromUtf8(source.bytes));
+                break;
+            case SampleType::Image:
+                payload.emplace<QImage>(QImage::fromData(source.bytes, source.format.isEmpty()
+                                                         ? nullptr : source.format.constData()));
+                break;
+            case SampleType::Binary:
+                payload.emplace<QByteArray>(source.bytes);
+                break;
+            case SampleType::Audio:
+            case SampleType::Multimodal:
+                break;
+        }
+        return payload;
+    }
+    
+    QFile file(source.path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return payload;
+    }
+    
+    const bool wholeFile = source.offset == 0 && source.length < 0;
+    QByteArray bytes;
+    if (!wholeFile || type == SampleType::Binary) {
+        file.seek(source.offset);
+        bytes = source.length < 0 ? file.readAll() : file.read(source.length);
+    }
+    
+    switch (type) {
+        case SampleType::Text:
+            if (wholeFile) {
+                // Same decoding TextReader uses for eager reads, from the mapped file
+                const qint64 size = file.size();
+                const uchar* mapped = size > 0 ? file.map(0, size) : nullptr;
+                if (!mapped) {
+                    bytes = file.readAll();
+                }
+                payload.emplace<Utf8Text>(Utf8Text::fromTextFile(
+                    mapped ? QByteArrayView(reinterpret_cast<const char*>(mapped), size) : QByteArrayView(bytes)));
+            } else {
+                payload.emplace<Utf8Text>(Utf8Text::fromUtf8(bytes));
+            }
+            break;
+        case SampleType::Image:
+            if (wholeFile) {
+                QImageReader reader(&file, source.format);
+                payload.emplace<QImage>(reader.read());
+            } else {
+                payload.emplace<QImage>(QImage::fromData(bytes));
+            }
+            break;
+        case SampleType::Binary:
+            payload.emplace<QByteArray>(bytes);
+            break;
+        case SampleType::Audio:
+        case SampleType::Multimodal:
+            break;  // No decoder for these sources yet
+    }
+    
+    return payload;
+}
+
+} // namespace DatasetCreator
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "DatasetSample.h"
+#include <QCache>
+#include <QMutex>
+#include <atomic>
+#include <memory>
+
+namespace DatasetCreator {
+
+/**
+ * @brief Shared LRU cache of decoded file-backed payloads
+ *
+ * Lazy samples (see DatasetSample::setSource) keep only a PayloadSource,
+ * a file range or encoded bytes in memory; the first access decodes the
+ * payload and stores it here.
+ * Entries are charged their decoded size and the least recently used ones
+ * are dropped once the byte budget is exceeded. Thread-safe.
+ */
+class PayloadCache {
+public:
+    static PayloadCache& instance();
+    
+    /**
+     * @brief Decoded payload for a source, from the cache or decoded now
+     *
+     * Decoding runs outside the lock, so two threads missing on the same
+     * source may both decode it. File sources are looked up with the
+     * file's current size and modification time, one stat per call.
+     */
+    std::shared_ptr<const SamplePayload> fetch(SampleType type, const PayloadSource& source);
+    
+    // Budget and statistics
+    void setByteBudget(qint64 bytes);
+    qint64 byteBudget() const;
+    qint64 bytesUsed() const;
+    qint64 hits() const { return hits_; }
+    qint64 misses() const { return misses_; }
+    void resetCounters();
+    void clear();
+    
+    static SamplePayload decode(SampleType type, const PayloadSource& source);
+
+private:
+    PayloadCache();
+    
+    struct Entry {
+        std::shared_ptr<const SamplePayload> payload;
+        QByteArray bytes;    // Keeps an in-memory source (and its key) alive
+    };
+    
+    static QString keyFor(const PayloadSource& source);
+    
+    mutable QMutex mutex_;
+    QCache<QString, Entry> cache_;
+    std::atomic<qint64> hits_{0};
+    std::atomic<qint64> misses_{0};
+};
+
+} // namespace DatasetCreator
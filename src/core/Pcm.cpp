@@ -0,0 +1,393 @@
+#include "Pcm.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numbers>
+#include <numeric>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace DatasetCreator {
+
+namespace {
+
+constexpr float Int16Scale = 32768.0f;
+constexpr double Int32Scale = 2147483648.0;
+
+// Stereo downmix of the usual WAVE channel orders (ITU-R BS.775): centre
+// and surrounds at -3 dB, a back centre at -3 dB into each side, and LFE
+// dropped. Rows are left, then right.
+struct StereoDownmix {
+    int channels;
+    float left[8];
+    float right[8];
+};
+
+constexpr float Minus3dB = 0.70710678f;
+constexpr StereoDownmix StereoDownmixes[] = {
+    {3, {1, 0, Minus3dB}, {0, 1, Minus3dB}},                                            // L R C
+    {4, {1, 0, Minus3dB, 0}, {0, 1, 0, Minus3dB}},                                      // L R Ls Rs
+    {5, {1, 0, Minus3dB, Minus3dB, 0}, {0, 1, Minus3dB, 0, Minus3dB}},                  // L R C Ls Rs
+    {6, {1, 0, Minus3dB, 0, Minus3dB, 0}, {0, 1, Minus3dB, 0, 0, Minus3dB}},            // 5.1
+    {7, {1, 0, Minus3dB, 0, 0.5f, Minus3dB, 0}, {0, 1, Minus3dB, 0, 0.5f, 0, Minus3dB}},  // 6.1
+    {8, {1, 0, Minus3dB, 0, Minus3dB, 0, Minus3dB, 0},
+        {0, 1, Minus3dB, 0, 0, Minus3dB, 0, Minus3dB}},                                 // 7.1
+};
+
+// outChannels rows of inChannels weights, each row summing to 1 so that
+// downmixing cannot clip
+std::vector<float> mixMatrix(int inChannels, int outChannels) {
+    std::vector<float> matrix(qsizetype(outChannels) * inChannels, 0.0f);
+    
+    const StereoDownmix* downmix = nullptr;
+    for (const StereoDownmix& candidate : StereoDownmixes) {
+        if (outChannels == 2 && candidate.channels == inChannels) {
+            downmix = &candidate;
+        }
+    }
+    
+    if (downmix) {
+        std::copy_n(downmix->left, inChannels, matrix.begin());
+        std::copy_n(downmix->right, inChannels, matrix.begin() + inChannels);
+    } else if (outChannels > inChannels) {
+        // The source's channels in order, repeated
+        for (int channel = 0; channel < outChannels; ++channel) {
+            matrix[channel * inChannels + channel % inChannels] = 1.0f;
+        }
+    } else {
+        // The first channels in order, with the rest spread over all of them
+        for (int channel = 0; channel < outChannels; ++channel) {
+            float* row = matrix.data() + channel * inChannels;
+            row[channel] = 1.0f;
+            for (int extra = outChannels; extra < inChannels; ++extra) {
+                row[extra] = 1.0f / float(outChannels);
+            }
+        }
+    }
+    
+    for (int channel = 0; channel < outChannels; ++channel) {
+        float* row = matrix.data() + channel * inChannels;
+        const float sum = std::accumulate(row, row + inChannels, 0.0f);
+        std::transform(row, row + inChannels, row, [sum](float weight) { return weight / sum; });
+    }
+    return matrix;
+}
+
+inline float dot(const float* a, const float* b, int count) {
+#if defined(__SSE2__)
+    __m128 sum = _mm_setzero_ps();
+    for (int i = 0; i < count; i += 4) {
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    }
+    __m128 swapped = _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(2, 3, 0, 1));
+    sum = _mm_add_ps(sum, swapped);
+    swapped = _mm_movehl_ps(swapped, sum);
+    return _mm_cvtss_f32(_mm_add_ss(sum, swapped));
+#else
+    float sum = 0.0f;
+    for (int i = 0; i < count; ++i) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+#endif
+}
+
+double besselI0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 64 && term > 1e-12 * sum; ++k) {
+        const double factor = x / (2.0 * k);
+        term *= factor * factor;
+        sum += term;
+    }
+    return sum;
+}
+
+} // namespace
+
+void Pcm::toFloat(const char* in, QAudioFormat::SampleFormat format, qsizetype count, float* out) {
+    switch (format) {
+        case QAudioFormat::UInt8:
+            for (qsizetype i = 0; i < count; ++i) {
+                out[i] = float(int(uchar(in[i])) - 128) * (1.0f / 128.0f);
+            }
+            return;
+        case QAudioFormat::Int16: {
+            qsizetype i = 0;
+#if defined(__SSE2__)
+            // Sign-extend by unpacking each sample into the high half of a lane
+            const __m128 scale = _mm_set1_ps(1.0f / Int16Scale);
+            for (; count - i >= 8; i += 8) {
+                const __m128i samples = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 2 * i));
+                const __m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16);
+                const __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(samples, samples), 16);
+                _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(low), scale));
+                _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(high), scale));
+            }
+#endif
+            for (; i < count; ++i) {
+                qint16 sample;
+                std::memcpy(&sample, in + 2 * i, sizeof(sample));
+                out[i] = float(sample) * (1.0f / Int16Scale);
+            }
+            return;
+        }
+        case QAudioFormat::Int32:
+            for (qsizetype i = 0; i < count; ++i) {
+                qint32 sample;
+                std::memcpy(&sample, in + 4 * i, sizeof(sample));
+                out[i] = float(sample / Int32Scale);
+            }
+            return;
+        case QAudioFormat::Float:
+            std::memcpy(out, in, count * sizeof(float));
+            return;
+        default:
+            std::fill(out, out + count, 0.0f);
+            return;
+    }
+}
+
+void Pcm::fromFloat(const float* in, qsizetype count, QAudioFormat::SampleFormat format, char* out) {
+    switch (format) {
+        case QAudioFormat::UInt8:
+            for (qsizetype i = 0; i < count; ++i) {
+                out[i] = char(std::clamp(int(std::lrint(in[i] * 128.0f)) + 128, 0, 255));
+            }
+            return;
+        case QAudioFormat::Int16: {
+            qsizetype i = 0;
+#if defined(__SSE2__)
+            // Clamped first: out of range floats convert to INT_MIN. The
+            // pack saturates the one value left over, 32768
+            const __m128 low = _mm_set1_ps(-1.0f);
+            const __m128 high = _mm_set1_ps(1.0f);
+            const __m128 scale = _mm_set1_ps(Int16Scale);
+            for (; count - i >= 8; i += 8) {
+                const __m128 a = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i), low), high);
+                const __m128 b = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i + 4), low), high);
+                const __m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(_mm_mul_ps(a, scale)),
+                                                       _mm_cvtps_epi32(_mm_mul_ps(b, scale)));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2 * i), packed);
+            }
+#endif
+            for (; i < count; ++i) {
+                const qint16 sample = qint16(std::clamp(std::lrint(std::clamp(in[i], -1.0f, 1.0f) * Int16Scale),
+                                                        -32768L, 32767L));
+                std::memcpy(out + 2 * i, &sample, sizeof(sample));
+            }
+            return;
+        }
+        case QAudioFormat::Int32:
+            for (qsizetype i = 0; i < count; ++i) {
+                const double scaled = std::clamp(double(in[i]), -1.0, 1.0) * Int32Scale;
+                const qint32 sample = qint32(std::clamp(std::llrint(scaled), -2147483648LL, 2147483647LL));
+                std::memcpy(out + 4 * i, &sample, sizeof(sample));
+            }
+            return;
+        case QAudioFormat::Float:
+            std::memcpy(out, in, count * sizeof(float));
+            return;
+        default:
+            return;
+    }
+}
+
+void Pcm::mix(const float* in, int inChannels, qsizetype frames, float* out, int outChannels) {
+    if (inChannels == outChannels) {
+        std::memcpy(out, in, frames * inChannels * sizeof(float));
+        return;
+    }
+
+    if (outChannels == 1) {
+        qsizetype frame = 0;
+#if defined(__SSE2__)
+        if (inChannels == 2) {
+            // Four stereo frames: split left and right, then average
+            const __m128 half = _mm_set1_ps(0.5f);
+            for (; frames - frame >= 4; frame += 4) {
+                const __m128 a = _mm_loadu_ps(in + 2 * frame);
+                const __m128 b = _mm_loadu_ps(in + 2 * frame + 4);
+                const __m128 left = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+                const __m128 right = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+                _mm_storeu_ps(out + frame, _mm_mul_ps(_mm_add_ps(left, right), half));
+            }
+        }
+#endif
+        const float scale = 1.0f / float(inChannels);
+        for (; frame < frames; ++frame) {
+            float sum = 0.0f;
+            for (int channel = 0; channel < inChannels; ++channel) {
+                sum += in[frame * inChannels + channel];
+            }
+            out[frame] = sum * scale;
+        }
+        return;
+    }
+
+    const std::vector<float> matrix = mixMatrix(inChannels, outChannels);
+    for (qsizetype frame = 0; frame < frames; ++frame) {
+        const float* source = in + frame * inChannels;
+        for (int channel = 0; channel < outChannels; ++channel) {
+            const float* row = matrix.data() + channel * inChannels;
+            float sum = 0.0f;
+            for (int i = 0; i < inChannels; ++i) {
+                sum += row[i] * source[i];
+            }
+            out[frame * outChannels + channel] = sum;
+        }
+    }
+}
+
+PcmResampler::PcmResampler(int inRate, int outRate, int channels)
+    : inRate_(inRate), outRate_(outRate), channels_(channels)
+{
+    // Cutoff relative to the input Nyquist frequency, with a 5% transition
+    // band; sixteen zero crossings each side and Kaiser beta 8 keep the
+    // stopband below -80 dB
+    constexpr int ZeroCrossings = 16;
+    constexpr double Beta = 8.0;
+    const double cutoff = 0.95 * std::min(1.0, double(outRate) / double(inRate));
+    halfWidth_ = int(std::ceil(ZeroCrossings / cutoff));
+    taps_ = (2 * halfWidth_ + 3) & ~3;
+
+    table_.assign(std::size_t(Phases) * taps_, 0.0f);
+    const double norm = besselI0(Beta);
+    for (int phase = 0; phase < Phases; ++phase) {
+        float* row = &table_[std::size_t(phase) * taps_];
+        double sum = 0.0;
+        for (int j = 0; j < 2 * halfWidth_; ++j) {
+            // Distance from the output instant to input frame i - halfWidth + 1 + j
+            const double x = double(phase) / Phases - (j - halfWidth_ + 1);
+            const double u = x / halfWidth_;
+            if (std::abs(u) >= 1.0) {
+                continue;
+            }
+            const double arg = std::numbers::pi * cutoff * x;
+            const double sinc = arg == 0.0 ? 1.0 : std::sin(arg) / arg;
+            const double tap = cutoff * sinc * besselI0(Beta * std::sqrt(1.0 - u * u)) / norm;
+            row[j] = float(tap);
+            sum += tap;
+        }
+        // Unity gain at DC for every phase
+        for (int j = 0; j < taps_; ++j) {
+            row[j] = float(row[j] / sum);
+        }
+    }
+
+    // Silence before the first frame, so the first outputs have full windows
+    history_.assign(channels_, std::vector<float>(halfWidth_ - 1, 0.0f));
+    base_ = -(halfWidth_ - 1);
+}
+
+void PcmResampler::process(const float* in, qsizetype frames, std::vector<float>& out) {
+    for (int channel = 0; channel < channels_; ++channel) {
+        std::vector<float>& history = history_[channel];
+        const std::size_t start = history.size();
+        history.resize(start + frames);
+        for (qsizetype frame = 0; frame < frames; ++frame) {
+            history[start + frame] = in[frame * channels_ + channel];
+        }
+    }
+    inFrames_ += frames;
+    produce(false, out);
+}
+
+void PcmResampler::flush(std::vector<float>& out) {
+    for (std::vector<float>& history : history_) {
+        history.resize(history.size() + taps_, 0.0f);
+    }
+    produce(true, out);
+}
+
+void PcmResampler::produce(bool flushing, std::vector<float>& out) {
+    const qint64 available = base_ + qint64(history_[0].size());
+    const qint64 total = (inFrames_ * outRate_ + inRate_ - 1) / inRate_;
+
+    while (!flushing || next_ < total) {
+        // Output frame next_ falls at input frame next_ * inRate / outRate,
+        // rounded to the nearest of Phases steps between frames
+        const qint64 position = next_ * inRate_;
+        qint64 frame = position / outRate_;
+        int phase = int(((position % outRate_) * Phases + outRate_ / 2) / outRate_);
+        if (phase == Phases) {
+            ++frame;
+            phase = 0;
+        }
+        const qint64 first = frame - halfWidth_ + 1;
+        if (first + taps_ > available) {
+            break;
+        }
+
+        const float* row = &table_[std::size_t(phase) * taps_];
+        for (int channel = 0; channel < channels_; ++channel) {
+            out.push_back(dot(row, history_[channel].data() + (first - base_), taps_));
+        }
+        ++next_;
+    }
+
+    // Input before the next output's window is no longer needed
+    const qint64 keepFrom = (next_ * inRate_) / outRate_ - halfWidth_ + 1;
+    const qint64 drop = std::min(keepFrom - base_, qint64(history_[0].size()));
+    if (drop > 0) {
+        for (std::vector<float>& history : history_) {
+            history.erase(history.begin(), history.begin() + drop);
+        }
+        base_ += drop;
+    }
+}
+
+PcmConverter::PcmConverter(const QAudioFormat& from, const QAudioFormat& to)
+    : from_(from), to_(to)
+{
+    passThrough_ = from.sampleFormat() == to.sampleFormat()
+        && from.channelCount() == to.channelCount()
+        && from.sampleRate() == to.sampleRate();
+    if (from.sampleRate() != to.sampleRate()) {
+        resampler_ = std::make_unique<PcmResampler>(from.sampleRate(), to.sampleRate(), to.channelCount());
+    }
+}
+
+PcmConverter::~PcmConverter() = default;
+
+QByteArray PcmConverter::convert(QByteArrayView pcm) {
+    if (passThrough_) {
+        return pcm.toByteArray();
+    }
+
+    const qsizetype frames = from_.bytesPerFrame() > 0 ? pcm.size() / from_.bytesPerFrame() : 0;
+    decoded_.resize(frames * from_.channelCount());
+    Pcm::toFloat(pcm.data(), from_.sampleFormat(), qsizetype(decoded_.size()), decoded_.data());
+
+    const std::vector<float>* samples = &decoded_;
+    if (from_.channelCount() != to_.channelCount()) {
+        mixed_.resize(frames * to_.channelCount());
+        Pcm::mix(decoded_.data(), from_.channelCount(), frames, mixed_.data(), to_.channelCount());
+        samples = &mixed_;
+    }
+    if (resampler_) {
+        resampled_.clear();
+        resampler_->process(samples->data(), frames, resampled_);
+        samples = &resampled_;
+    }
+    return encode(*samples);
+}
+
+QByteArray PcmConverter::flush() {
+    if (!resampler_) {
+        return QByteArray();
+    }
+    resampled_.clear();
+    resampler_->flush(resampled_);
+    return encode(resampled_);
+}
+
+QByteArray PcmConverter::encode(const std::vector<float>& samples) const {
+    QByteArray pcm(qsizetype(samples.size()) * to_.bytesPerSample(), Qt::Uninitialized);
+    Pcm::fromFloat(samples.data(), qsizetype(samples.size()), to_.sampleFormat(), pcm.data());
+    return pcm;
+}
+
+} // namespace DatasetCreator
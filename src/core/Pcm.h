@@ -0,0 +1,98 @@
+#pragma once
+
+#include <QAudioFormat>
+#include <QByteArray>
+#include <QByteArrayView>
+#include <memory>
+#include <vector>
+
+namespace DatasetCreator {
+
+/**
+ * @brief Interleaved PCM kernels
+ *
+ * Samples are converted to and from float in [-1, 1] (Int16 and Float
+ * eight or four at a time with SSE2), and channels are mixed frame by
+ * frame.
+ */
+class Pcm {
+public:
+    static void toFloat(const char* in, QAudioFormat::SampleFormat format, qsizetype count, float* out);
+    static void fromFloat(const float* in, qsizetype count, QAudioFormat::SampleFormat format, char* out);
+
+    /**
+     * @brief Change the channel count of interleaved frames
+     *
+     * Mono is the mean of all channels. Stereo from the usual WAVE layouts
+     * of 3 to 8 channels (up to 7.1) is the ITU-R BS.775 downmix: centre
+     * and surrounds at -3 dB, LFE dropped. Other counts take the
+     * channels in order, repeating the source's when it has fewer and
+     * spreading the rest over all outputs when it has more. Each output
+     * is normalized so that a downmix cannot clip.
+     */
+    static void mix(const float* in, int inChannels, qsizetype frames, float* out, int outChannels);
+};
+
+/**
+ * @brief Streaming sample rate converter for interleaved float frames
+ *
+ * A Kaiser-windowed sinc filter, cut off just below the lower of the two
+ * Nyquist frequencies, is tabulated at 256 phases; each output sample is
+ * the dot product of one phase with the input around it. Input may arrive
+ * in blocks of any size; flush() pads the end with silence and emits the
+ * rest, so the output has ceil(frames * outRate / inRate) frames in all.
+ */
+class PcmResampler {
+public:
+    PcmResampler(int inRate, int outRate, int channels);
+
+    void process(const float* in, qsizetype frames, std::vector<float>& out);  // Appends to out
+    void flush(std::vector<float>& out);
+
+private:
+    static constexpr int Phases = 256;
+
+    void produce(bool flushing, std::vector<float>& out);
+
+    qint64 inRate_;
+    qint64 outRate_;
+    int channels_;
+    int halfWidth_;              // Taps each side of the centre
+    int taps_;                   // Per phase, a multiple of four
+    std::vector<float> table_;   // Phases rows of taps_
+    std::vector<std::vector<float>> history_;   // Per channel, from frame base_
+    qint64 base_;
+    qint64 inFrames_ = 0;        // Frames passed to process()
+    qint64 next_ = 0;            // Next output frame
+};
+
+/**
+ * @brief Converts PCM between two formats
+ *
+ * Sample format, channel count and sample rate may all differ; frames go
+ * through float, are mixed, then resampled. When the formats are equal
+ * the bytes are passed through untouched.
+ */
+class PcmConverter {
+public:
+    PcmConverter(const QAudioFormat& from, const QAudioFormat& to);
+    ~PcmConverter();
+
+    bool isPassThrough() const { return passThrough_; }
+
+    QByteArray convert(QByteArrayView pcm);   // Whole frames of the source format
+    QByteArray flush();                       // End of input
+
+private:
+    QByteArray encode(const std::vector<float>& samples) const;
+
+    QAudioFormat from_;
+    QAudioFormat to_;
+    bool passThrough_;
+    std::unique_ptr<PcmResampler> resampler_;
+    std::vector<float> decoded_;
+    std::vector<float> mixed_;
+    std::vector<float> resampled_;
+};
+
+} // namespace DatasetCreator
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "core/Dataset.h"
+#include "core/Progress.h"
+#include <QHash>
 #include <QString>
 #include <QStringList>
 #include <QIODevice>
@@ -34,12 +36,72 @@ public:
     virtual DatasetSample read(const QString& filePath) = 0;
     virtual QList<DatasetSample> readBatch(const QStringList& files) = 0;
     
-    // Optional: Progressive reading for large files
+    // Threading: return true if read() may run on several threads at once.
+    // Non-reentrant readers are serialized by ImportManager.
+    virtual bool isReentrant() const { return false; }
+    
+    // Optional: Progressive reading for large files, one sample per
+    // readNext() until atEnd(); endRead() releases the file
     virtual bool supportsStreaming() const { return false; }
     virtual bool beginRead(const QString& filePath) { Q_UNUSED(filePath); return false; }
     virtual DatasetSample readNext() { return DatasetSample(); }
+    virtual bool atEnd() const { return true; }
     virtual bool endRead() { return false; }
     
+    // Optional: Subset of the sample readNext() returned last, for formats
+    // that record one (empty for the root). Readers that may name one
+    // return true from providesSubsets(); ImportManager imports their
+    // files through streamInto()
+    virtual QString subsetName() const { return QString(); }
+    virtual bool providesSubsets() const { return false; }
+    
+    // Optional: Dataset metadata the streamed file records, valid from
+    // beginRead() on
+    virtual DatasetMetadata datasetMetadata() const { return DatasetMetadata(); }
+    
+    /**
+     * @brief Add the samples of a streamed file to a dataset
+     *
+     * Each sample goes to the subset subsetName() gives. A subset sample
+     * whose id an earlier subset sample of the same file had joins that
+     * sample's subsets rather than being added again, so a sample shared
+     * by subsets stays shared. Samples already in the dataset are never
+     * merged with; clashing ids are renamed as addSample() does. progress
+     * is called before each sample with the count so far and no total;
+     * returning false stops the read, which fails, keeping what was added.
+     */
+    static bool streamInto(IDataReader& reader, const QString& filePath, Dataset& dataset,
+                           const ProgressCallback& progress = {}) {
+        if (!reader.beginRead(filePath)) {
+            return false;
+        }
+        QHash<QString, QString> added;   // Id in the file -> id in the dataset, for subset samples
+        int count = 0;
+        while (!reader.atEnd()) {
+            if (progress && !progress(count++, 0, 0)) {
+                reader.endRead();
+                return false;
+            }
+            const DatasetSample sample = reader.readNext();
+            const QString subset = reader.subsetName();
+            const QString& id = sample.metadata().id;
+            const auto shared = added.constFind(id);
+            if (!subset.isEmpty() && shared != added.cend()) {
+                dataset.addSampleToSubset(*shared, subset);
+                continue;
+            }
+            if (!subset.isEmpty() && !id.isEmpty()) {
+                added.insert(id, dataset.uniqueSampleId(id));
+            }
+            dataset.addSample(sample, subset);
+        }
+        return reader.endRead();
+    }
+    
+    // Optional: A new reader with the same options, so several files can be
+    // streamed at once (see ImportManager::importBatch)
+    virtual std::unique_ptr<IDataReader> clone() const { return nullptr; }
+    
     // Metadata extraction (without loading full data)
     virtual QVariantMap extractMetadata(const QString& filePath) = 0;
     
@@ -70,7 +132,8 @@ public:
     virtual bool write(const QString& outputPath, 
                       const Dataset& dataset) = 0;
     
-    // Optional: Streaming for large datasets
+    // Optional: Streaming for large datasets. Root samples come first, then
+    // each subset; endWrite() finishes the output and abortWrite() discards it
     virtual bool supportsStreaming() const { return false; }
     virtual bool beginWrite(const QString& outputPath, const DatasetMetadata& metadata) { 
         Q_UNUSED(outputPath); Q_UNUSED(metadata); return false; 
@@ -82,12 +145,47 @@ public:
         Q_UNUSED(subset); return false; 
     }
     virtual bool endWrite() { return false; }
+    virtual void abortWrite() {}
+    
+    /**
+     * @brief Write a dataset through a writer's streaming calls
+     *
+     * Only one sample is serialized at a time, so memory does not grow
+     * with the dataset.
+     */
+    static bool streamDataset(IDataWriter& writer, const QString& outputPath, const Dataset& dataset) {
+        if (!writer.beginWrite(outputPath, dataset.metadata())) {
+            return false;
+        }
+        for (const auto& sample : dataset.samples()) {
+            if (!writer.writeSample(sample)) {
+                writer.abortWrite();
+                return false;
+            }
+        }
+        for (const auto& subset : dataset.subsets()) {
+            if (!writer.writeSubset(subset)) {
+                writer.abortWrite();
+                return false;
+            }
+        }
+        return writer.endWrite();
+    }
     
     // Configuration
     virtual QVariantMap defaultOptions() const { return QVariantMap(); }
     virtual void setOptions(const QVariantMap& options) { Q_UNUSED(options); }
     virtual QVariantMap currentOptions() const { return QVariantMap(); }
     
+    // Optional: Progress of write() or a streamed write (which passes a
+    // total of 0), failing without leaving the output file behind when the
+    // callback returns false
+    virtual void setProgressCallback(const ProgressCallback& callback) { Q_UNUSED(callback); }
+    
+    // Optional: A new writer with the same options, so several files can be
+    // written at once (see ExportManager::exportSharded)
+    virtual std::unique_ptr<IDataWriter> clone() const { return nullptr; }
+    
     // Validation
     virtual bool canWrite(const Dataset& dataset) const { Q_UNUSED(dataset); return true; }
     virtual QString validationError() const { return QString(); }
@@ -118,5 +216,7 @@ public:
 
 } // namespace DatasetCreator
 
-// Qt plugin interface declaration
-Q_DECLARE_INTERFACE(DatasetCreator::IDataPlugin, "com.datasetcreator.IDataPlugin/1.0")
+// Qt plugin interface declaration. The version changes with the layout of
+// IDataReader and IDataWriter, whose instances plugins create: 2.0 added
+// streaming subsets and metadata, cloning, abortWrite() and progress
+Q_DECLARE_INTERFACE(DatasetCreator::IDataPlugin, "com.datasetcreator.IDataPlugin/2.0")
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <QtGlobal>
+#include <functional>
+
+namespace DatasetCreator {
+
+/**
+ * @brief Progress report of a long-running save, load or export
+ *
+ * Called with the samples done so far, their total (0 if not known), and
+ * the bytes written (or read) so far. Returning false asks the operation to stop: it then
+ * fails and leaves no partial output behind.
+ */
+using ProgressCallback = std::function<bool(int current, int total, qint64 bytes)>;
+
+} // namespace DatasetCreator
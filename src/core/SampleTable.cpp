@@ -0,0 +1,154 @@
+#include "SampleTable.h"
+#include <algorithm>
+#include <iterator>
+
+namespace DatasetCreator {
+
+// SampleTable implementation
+SampleRow SampleTable::append(const DatasetSample& sample) {
+    if ((rowCount_ & ChunkMask) == 0) {
+        Chunk* chunk = new Chunk;
+        chunk->samples.reserve(ChunkSize);
+        chunk->live.reserve(ChunkSize);
+        chunks_.append(QSharedDataPointer<Chunk>(chunk));
+    }
+    
+    Chunk* chunk = chunks_.last().data();  // Unshares a chunk a copy still holds
+    chunk->samples.append(sample);
+    chunk->live.append(true);
+    return static_cast<SampleRow>(rowCount_++);
+}
+
+DatasetSample& SampleTable::mutableAt(SampleRow row) {
+    return chunks_[row >> ChunkBits]->samples[row & ChunkMask];
+}
+
+void SampleTable::remove(SampleRow row) {
+    if (!isLive(row)) return;
+    
+    Chunk* chunk = chunks_[row >> ChunkBits].data();
+    chunk->samples[row & ChunkMask] = DatasetSample();  // Release the payload now
+    chunk->live[row & ChunkMask] = false;
+    ++deadCount_;
+}
+
+void SampleTable::clear() {
+    chunks_.clear();
+    rowCount_ = 0;
+    deadCount_ = 0;
+}
+
+std::vector<SampleRow> SampleTable::compact() {
+    std::vector<SampleRow> remap(rowCount_, InvalidRow);
+    
+    // Built fresh: the old chunks may still be shared with copies
+    SampleTable compacted;
+    for (int row = 0; row < rowCount_; ++row) {
+        if (isLive(row)) {
+            remap[row] = compacted.append(at(row));
+        }
+    }
+    
+    *this = std::move(compacted);
+    return remap;
+}
+
+// SampleIdIndex implementation
+void SampleIdIndex::clear() {
+    for (auto& shard : shards_) {
+        shard.clear();
+    }
+}
+
+void SampleIdIndex::remap(const std::vector<SampleRow>& rows) {
+    for (auto& shard : shards_) {
+        for (auto it = shard.begin(); it != shard.end(); ++it) {
+            it.value() = rows[it.value()];
+        }
+    }
+}
+
+// RowSet implementation
+namespace RowSet {
+
+int indexOf(const QList<SampleRow>& rows, SampleRow row) {
+    auto it = std::lower_bound(rows.cbegin(), rows.cend(), row);
+    if (it == rows.cend() || *it != row) return -1;
+    return static_cast<int>(it - rows.cbegin());
+}
+
+bool contains(const QList<SampleRow>& rows, SampleRow row) {
+    return std::binary_search(rows.cbegin(), rows.cend(), row);
+}
+
+bool insert(QList<SampleRow>& rows, SampleRow row) {
+    // Rows are allocated in increasing order, so appending is the common case
+    if (rows.isEmpty() || rows.last() < row) {
+        rows.append(row);
+        return true;
+    }
+    
+    auto it = std::lower_bound(rows.begin(), rows.end(), row);
+    if (*it == row) {
+        return false;
+    }
+    rows.insert(it, row);
+    return true;
+}
+
+bool remove(QList<SampleRow>& rows, SampleRow row) {
+    int index = indexOf(rows, row);
+    if (index < 0) return false;
+    rows.removeAt(index);
+    return true;
+}
+
+void merge(QList<SampleRow>& rows, const QList<SampleRow>& sorted) {
+    if (sorted.isEmpty()) return;
+    if (rows.isEmpty() || rows.last() < sorted.first()) {
+        rows.append(sorted);
+        return;
+    }
+    
+    QList<SampleRow> merged;
+    merged.reserve(rows.size() + sorted.size());
+    std::set_union(rows.cbegin(), rows.cend(), sorted.cbegin(), sorted.cend(),
+                   std::back_inserter(merged));
+    rows.swap(merged);
+}
+
+QList<SampleRow> take(QList<SampleRow>& rows, const QList<int>& positions) {
+    // Mark first, then split in a single pass; positions may be unsorted or repeat
+    std::vector<bool> selected(rows.size(), false);
+    for (int position : positions) {
+        if (position >= 0 && position < rows.size()) {
+            selected[position] = true;
+        }
+    }
+    
+    QList<SampleRow> taken;
+    int kept = 0;
+    for (int i = 0; i < rows.size(); ++i) {
+        if (selected[i]) {
+            taken.append(rows[i]);
+        } else {
+            rows[kept++] = rows[i];
+        }
+    }
+    rows.resize(kept);
+    return taken;
+}
+
+} // namespace RowSet
+
+// SampleView implementation
+QList<DatasetSample> SampleView::toList() const {
+    QList<DatasetSample> list;
+    list.reserve(size());
+    for (const auto& sample : *this) {
+        list.append(sample);
+    }
+    return list;
+}
+
+} // namespace DatasetCreator
@@ -0,0 +1,147 @@
+#pragma once
+
+#include "DatasetSample.h"
+#include <QHash>
+#include <QList>
+#include <QSharedData>
+#include <array>
+#include <vector>
+
+namespace DatasetCreator {
+
+using SampleRow = quint32;
+
+/**
+ * @brief Central storage for the samples of a dataset
+ *
+ * Every sample is stored exactly once and addressed by its row. Rows are
+ * handed out in increasing order and never reused, so row order is
+ * insertion order. Removed rows release their payload and stay empty until
+ * compact() renumbers the table.
+ *
+ * Rows are stored in fixed-size chunks shared between copies of the table,
+ * so a copy costs one reference per chunk, and changing a row afterwards
+ * copies only the chunk that holds it. Copies may be read on other threads
+ * while the original changes.
+ */
+class SampleTable {
+public:
+    static constexpr SampleRow InvalidRow = 0xFFFFFFFFu;
+    
+    SampleRow append(const DatasetSample& sample);
+    void remove(SampleRow row);
+    void clear();
+    
+    bool isLive(SampleRow row) const {
+        return row < static_cast<SampleRow>(rowCount_) && chunks_[row >> ChunkBits]->live[row & ChunkMask];
+    }
+    const DatasetSample& at(SampleRow row) const { return chunks_[row >> ChunkBits]->samples[row & ChunkMask]; }
+    DatasetSample& mutableAt(SampleRow row);  // Unshares the row's chunk
+    
+    int rowCount() const { return rowCount_; }
+    int liveCount() const { return rowCount_ - deadCount_; }
+    int deadCount() const { return deadCount_; }
+    
+    /**
+     * @brief Drop removed rows and renumber the live ones
+     * @return Old row -> new row (InvalidRow for removed rows); the mapping
+     *         is monotonic, so sorted row lists stay sorted
+     */
+    std::vector<SampleRow> compact();
+
+private:
+    static constexpr int ChunkBits = 10;
+    static constexpr int ChunkSize = 1 << ChunkBits;
+    static constexpr SampleRow ChunkMask = ChunkSize - 1;
+    
+    struct Chunk : QSharedData {
+        QList<DatasetSample> samples;
+        QList<bool> live;
+    };
+    
+    QList<QSharedDataPointer<Chunk>> chunks_;
+    int rowCount_ = 0;
+    int deadCount_ = 0;
+};
+
+/**
+ * @brief Sample ID -> table row
+ *
+ * Split into shards that copies share, so copying is constant time and a
+ * change afterwards copies only the shard it touches.
+ */
+class SampleIdIndex {
+public:
+    bool contains(const QString& id) const { return shardOf(id).contains(id); }
+    SampleRow value(const QString& id) const { return shardOf(id).value(id, SampleTable::InvalidRow); }
+    void insert(const QString& id, SampleRow row) { shardOf(id).insert(id, row); }
+    void remove(const QString& id) { shardOf(id).remove(id); }
+    void clear();
+    void remap(const std::vector<SampleRow>& rows);  // Apply SampleTable::compact()
+
+private:
+    static constexpr std::size_t ShardCount = 64;
+    
+    QHash<QString, SampleRow>& shardOf(const QString& id) { return shards_[qHash(id) % ShardCount]; }
+    const QHash<QString, SampleRow>& shardOf(const QString& id) const { return shards_[qHash(id) % ShardCount]; }
+    
+    std::array<QHash<QString, SampleRow>, ShardCount> shards_;
+};
+
+/**
+ * @brief Sorted list of table rows - the membership of the root or a subset
+ */
+namespace RowSet {
+    int indexOf(const QList<SampleRow>& rows, SampleRow row);
+    bool contains(const QList<SampleRow>& rows, SampleRow row);
+    bool insert(QList<SampleRow>& rows, SampleRow row);
+    bool remove(QList<SampleRow>& rows, SampleRow row);
+    void merge(QList<SampleRow>& rows, const QList<SampleRow>& sorted);
+    QList<SampleRow> take(QList<SampleRow>& rows, const QList<int>& positions);
+}
+
+/**
+ * @brief Read-only view of the samples referenced by a row list
+ *
+ * Cheap to copy. A view is valid until the dataset or subset it came from
+ * is modified, like an iterator.
+ */
+class SampleView {
+public:
+    class const_iterator {
+    public:
+        const_iterator(const SampleView* view, int index) : view_(view), index_(index) {}
+        const DatasetSample& operator*() const { return (*view_)[index_]; }
+        const DatasetSample* operator->() const { return &(*view_)[index_]; }
+        const_iterator& operator++() { ++index_; return *this; }
+        bool operator==(const const_iterator& other) const { return index_ == other.index_; }
+        bool operator!=(const const_iterator& other) const { return index_ != other.index_; }
+    
+    private:
+        const SampleView* view_;
+        int index_;
+    };
+    
+    SampleView() = default;
+    SampleView(const SampleTable* table, const QList<SampleRow>* rows) : table_(table), rows_(rows) {}
+    
+    int size() const { return rows_ ? rows_->size() : 0; }
+    bool isEmpty() const { return size() == 0; }
+    
+    const DatasetSample& operator[](int index) const { return table_->at((*rows_)[index]); }
+    const DatasetSample& at(int index) const { return (*this)[index]; }
+    const DatasetSample& first() const { return (*this)[0]; }
+    const DatasetSample& last() const { return (*this)[size() - 1]; }
+    SampleRow rowAt(int index) const { return (*rows_)[index]; }
+    
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, size()); }
+    
+    QList<DatasetSample> toList() const;
+
+private:
+    const SampleTable* table_ = nullptr;
+    const QList<SampleRow>* rows_ = nullptr;
+};
+
+} // namespace DatasetCreator
@@ -0,0 +1,385 @@
+#include "Utf8.h"
+#include <QStringDecoder>
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <optional>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define DATASETCREATOR_UTF8_X86
+#include <immintrin.h>
+#define UTF8_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace DatasetCreator {
+
+Utf8::Scan Utf8::scan(QByteArrayView data) {
+    const uchar* const bytes = reinterpret_cast<const uchar*>(data.data());
+    const qsizetype size = data.size();
+    Scan result;
+
+    // ASCII prefix and carriage returns, a block at a time
+    qsizetype ascii = 0;
+#if defined(__SSE2__)
+    __m128i high = _mm_setzero_si128();
+    __m128i returns = _mm_setzero_si128();
+    for (qsizetype i = 0; size - i >= 16; i += 16) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + i));
+        high = _mm_or_si128(high, block);
+        returns = _mm_or_si128(returns, _mm_cmpeq_epi8(block, _mm_set1_epi8('\r')));
+        if (ascii == i && !_mm_movemask_epi8(block)) {
+            ascii = i + 16;
+        }
+    }
+    result.carriageReturn = _mm_movemask_epi8(returns) != 0;
+    bool nonAscii = _mm_movemask_epi8(high) != 0;
+    for (qsizetype i = size & ~qsizetype(15); i < size; ++i) {
+        nonAscii = nonAscii || bytes[i] >= 0x80;
+        result.carriageReturn = result.carriageReturn || bytes[i] == '\r';
+    }
+#else
+    bool nonAscii = false;
+    for (qsizetype i = 0; i < size; ++i) {
+        nonAscii = nonAscii || bytes[i] >= 0x80;
+        result.carriageReturn = result.carriageReturn || bytes[i] == '\r';
+    }
+#endif
+    result.ascii = !nonAscii;
+    if (result.ascii) {
+        return result;
+    }
+
+    result.valid = isa() == Isa::Ssse3 ? validateSsse3(bytes + ascii, size - ascii)
+                                       : validateScalar(bytes + ascii, size - ascii);
+    return result;
+}
+
+bool Utf8::validateScalar(const uchar* data, qsizetype size) {
+    qsizetype i = 0;
+    while (i < size) {
+        // Eight ASCII bytes at a time
+        if (size - i >= 8) {
+            quint64 word;
+            std::memcpy(&word, data + i, 8);
+            if (!(word & 0x8080808080808080ull)) {
+                i += 8;
+                continue;
+            }
+        }
+
+        const uchar lead = data[i];
+        if (lead < 0x80) {
+            ++i;
+            continue;
+        }
+
+        // Length and the range of the second byte, which rules out overlong
+        // forms, surrogates and code points above U+10FFFF
+        int length = 0;
+        uchar low = 0x80;
+        uchar high = 0xbf;
+        if (lead >= 0xc2 && lead <= 0xdf) {
+            length = 2;
+        } else if (lead >= 0xe0 && lead <= 0xef) {
+            length = 3;
+            if (lead == 0xe0) low = 0xa0;
+            if (lead == 0xed) high = 0x9f;
+        } else if (lead >= 0xf0 && lead <= 0xf4) {
+            length = 4;
+            if (lead == 0xf0) low = 0x90;
+            if (lead == 0xf4) high = 0x8f;
+        } else {
+            return false;
+        }
+
+        if (size - i < length || data[i + 1] < low || data[i + 1] > high) {
+            return false;
+        }
+        for (int k = 2; k < length; ++k) {
+            if ((data[i + k] & 0xc0) != 0x80) {
+                return false;
+            }
+        }
+        i += length;
+    }
+    return true;
+}
+
+#if defined(DATASETCREATOR_UTF8_X86)
+
+namespace {
+
+// Error classes of Keiser and Lemire, "Validating UTF-8 In Less Than One
+// Instruction Per Byte": three nibble lookups flag each pair of adjacent
+// bytes, and only valid pairs leave no bit set
+constexpr char TooShort = 1 << 0;
+constexpr char TooLong = 1 << 1;
+constexpr char Overlong3 = 1 << 2;
+constexpr char TooLarge = 1 << 3;
+constexpr char Surrogate = 1 << 4;
+constexpr char Overlong2 = 1 << 5;
+constexpr char TooLarge1000 = 1 << 6;
+constexpr char Overlong4 = 1 << 6;
+constexpr char TwoConts = char(1 << 7);
+constexpr char Carry = TooShort | TooLong | TwoConts;
+
+struct Ssse3State {
+    __m128i error = _mm_setzero_si128();
+    __m128i previous = _mm_setzero_si128();
+    __m128i incomplete = _mm_setzero_si128();  // Lead bytes at the end of previous that need more
+};
+
+UTF8_TARGET("ssse3")
+inline void checkBlock(Ssse3State& state, __m128i input) {
+    if (!_mm_movemask_epi8(input)) {
+        // ASCII: only a sequence left open by the previous block can fail
+        state.error = _mm_or_si128(state.error, state.incomplete);
+        state.previous = input;
+        state.incomplete = _mm_setzero_si128();
+        return;
+    }
+
+    const __m128i nibble = _mm_set1_epi8(0x0f);
+    const __m128i prev1 = _mm_alignr_epi8(input, state.previous, 15);
+    const __m128i byte1High = _mm_shuffle_epi8(
+        _mm_setr_epi8(TooLong, TooLong, TooLong, TooLong, TooLong, TooLong, TooLong, TooLong,
+                      TwoConts, TwoConts, TwoConts, TwoConts,
+                      TooShort | Overlong2,
+                      TooShort,
+                      TooShort | Overlong3 | Surrogate,
+                      TooShort | TooLarge | TooLarge1000 | Overlong4),
+        _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble));
+    const __m128i byte1Low = _mm_shuffle_epi8(
+        _mm_setr_epi8(Carry | Overlong3 | Overlong2 | Overlong4,
+                      Carry | Overlong2,
+                      Carry,
+                      Carry,
+                      Carry | TooLarge,
+                      Carry | TooLarge | TooLarge1000,
+                      Carry | TooLarge | TooLarge1000,
+                      Carry | TooLarge | TooLarge1000,
+                      Carry | TooLarge | TooLarge1000,
+                      Carry | TooLarge | TooLarge1000,
+                      Carry | TooLarge | TooLarge1000,
+                      Carry | TooLarge | TooLarge1000,
+                      Carry | TooLarge | TooLarge1000,
+                      Carry | TooLarge | TooLarge1000 | Surrogate,
+                      Carry | TooLarge | TooLarge1000,
+                      Carry | TooLarge | TooLarge1000),
+        _mm_and_si128(prev1, nibble));
+    const __m128i byte2High = _mm_shuffle_epi8(
+        _mm_setr_epi8(TooShort, TooShort, TooShort, TooShort, TooShort, TooShort, TooShort, TooShort,
+                      TooLong | Overlong2 | TwoConts | Overlong3 | TooLarge1000 | Overlong4,
+                      TooLong | Overlong2 | TwoConts | Overlong3 | TooLarge,
+                      TooLong | Overlong2 | TwoConts | Surrogate | TooLarge,
+                      TooLong | Overlong2 | TwoConts | Surrogate | TooLarge,
+                      TooShort, TooShort, TooShort, TooShort),
+        _mm_and_si128(_mm_srli_epi16(input, 4), nibble));
+    const __m128i special = _mm_and_si128(_mm_and_si128(byte1High, byte1Low), byte2High);
+
+    // Third and fourth bytes of a sequence must be continuations, which
+    // the pair check flags as TwoConts; clear exactly those
+    const __m128i prev2 = _mm_alignr_epi8(input, state.previous, 14);
+    const __m128i prev3 = _mm_alignr_epi8(input, state.previous, 13);
+    const __m128i third = _mm_subs_epu8(prev2, _mm_set1_epi8(char(0xe0 - 0x80)));
+    const __m128i fourth = _mm_subs_epu8(prev3, _mm_set1_epi8(char(0xf0 - 0x80)));
+    const __m128i must23 = _mm_and_si128(_mm_or_si128(third, fourth), _mm_set1_epi8(char(0x80)));
+    state.error = _mm_or_si128(state.error, _mm_xor_si128(must23, special));
+
+    // Leads in the last three bytes that run past the block
+    state.incomplete = _mm_subs_epu8(input, _mm_setr_epi8(char(0xff), char(0xff), char(0xff), char(0xff),
+                                                          char(0xff), char(0xff), char(0xff), char(0xff),
+                                                          char(0xff), char(0xff), char(0xff), char(0xff),
+                                                          char(0xff), char(0xf0 - 1), char(0xe0 - 1),
+                                                          char(0xc0 - 1)));
+    state.previous = input;
+}
+
+} // namespace
+
+UTF8_TARGET("ssse3")
+bool Utf8::validateSsse3(const uchar* data, qsizetype size) {
+    Ssse3State state;
+    qsizetype i = 0;
+    for (; size - i >= 16; i += 16) {
+        checkBlock(state, _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)));
+    }
+
+    // The tail padded with zeros, which also closes any open sequence
+    alignas(16) uchar tail[16] = {};
+    std::memcpy(tail, data + i, size - i);
+    checkBlock(state, _mm_load_si128(reinterpret_cast<const __m128i*>(tail)));
+    state.error = _mm_or_si128(state.error, state.incomplete);
+
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(state.error, _mm_setzero_si128())) == 0xffff;
+}
+
+Utf8::Isa Utf8::isa() {
+    static const Isa detected = [] {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("ssse3") ? Isa::Ssse3 : Isa::Scalar;
+    }();
+    return detected;
+}
+
+#undef UTF8_TARGET
+
+#else
+
+bool Utf8::validateSsse3(const uchar* data, qsizetype size) {
+    return validateScalar(data, size);
+}
+
+Utf8::Isa Utf8::isa() {
+    return Isa::Scalar;
+}
+
+#endif
+
+Utf8Text::Utf8Text(const QString& text) {
+    QByteArray utf8 = text.toUtf8();
+    const bool ascii = utf8.size() == text.size();  // Anything else takes more bytes than units
+    adopt(std::move(utf8), ascii);
+}
+
+Utf8Text Utf8Text::make(QByteArrayView utf8, bool ascii) {
+    Utf8Text text;
+    if (utf8.size() <= InlineCapacity) {
+        std::memcpy(text.inline_, utf8.data(), utf8.size());
+        text.size_ = qint8(utf8.size());
+        text.ascii_ = ascii;
+    } else {
+        text.adopt(utf8.toByteArray(), ascii);
+    }
+    return text;
+}
+
+void Utf8Text::adopt(QByteArray&& utf8, bool ascii) {
+    release();
+    ascii_ = ascii;
+    if (utf8.size() <= InlineCapacity) {
+        std::memcpy(inline_, utf8.constData(), utf8.size());
+        size_ = qint8(utf8.size());
+        return;
+    }
+    // Conversions reserve for the worst case; keep only what is used
+    utf8.squeeze();
+    new (&heap_) QByteArray(std::move(utf8));
+    size_ = -1;
+}
+
+Utf8Text& Utf8Text::operator=(const Utf8Text& other) {
+    if (this != &other) {
+        release();
+        assign(other);
+    }
+    return *this;
+}
+
+Utf8Text& Utf8Text::operator=(Utf8Text&& other) noexcept {
+    if (this != &other) {
+        release();
+        take(other);
+    }
+    return *this;
+}
+
+void Utf8Text::assign(const Utf8Text& other) {
+    if (other.size_ >= 0) {
+        std::memcpy(inline_, other.inline_, other.size_);
+    } else {
+        new (&heap_) QByteArray(other.heap_);
+    }
+    size_ = other.size_;
+    ascii_ = other.ascii_;
+}
+
+void Utf8Text::take(Utf8Text& other) noexcept {
+    if (other.size_ >= 0) {
+        std::memcpy(inline_, other.inline_, other.size_);
+    } else {
+        new (&heap_) QByteArray(std::move(other.heap_));
+    }
+    size_ = other.size_;
+    ascii_ = other.ascii_;
+    other.release();
+    other.size_ = 0;
+    other.ascii_ = true;
+}
+
+void Utf8Text::release() noexcept {
+    if (size_ < 0) {
+        heap_.~QByteArray();
+        size_ = 0;
+    }
+}
+
+Utf8Text Utf8Text::fromUtf8(QByteArrayView utf8, bool* valid) {
+    const Utf8::Scan scan = Utf8::scan(utf8);
+    if (valid) {
+        *valid = scan.valid;
+    }
+    return scan.valid ? make(utf8, scan.ascii) : Utf8Text(QString::fromUtf8(utf8));
+}
+
+Utf8Text Utf8Text::fromTextMode(QByteArrayView utf8, bool* valid) {
+    const Utf8::Scan scan = Utf8::scan(utf8);
+    if (valid) {
+        *valid = scan.valid;
+    }
+    if (!scan.carriageReturn) {
+        return scan.valid ? make(utf8, scan.ascii) : Utf8Text(QString::fromUtf8(utf8));
+    }
+    
+    QByteArray stripped(utf8.size(), Qt::Uninitialized);
+    char* const end = std::remove_copy(utf8.begin(), utf8.end(), stripped.data(), '\r');
+    stripped.truncate(end - stripped.constData());
+    if (!scan.valid) {
+        return Utf8Text(QString::fromUtf8(stripped));
+    }
+    Utf8Text text;
+    text.adopt(std::move(stripped), scan.ascii);
+    return text;
+}
+
+Utf8Text Utf8Text::fromTextFile(QByteArrayView contents, bool* valid) {
+    const std::optional<QStringConverter::Encoding> encoding = QStringConverter::encodingForData(contents);
+    if (!encoding || *encoding == QStringConverter::Utf8) {
+        constexpr QByteArrayView byteOrderMark = "\xef\xbb\xbf";
+        return fromTextMode(contents.startsWith(byteOrderMark) ? contents.sliced(byteOrderMark.size()) : contents,
+                            valid);
+    }
+    
+    QStringDecoder decoder(*encoding, QStringDecoder::Flag::Stateless);
+    QString text = decoder.decode(contents);
+    text.remove(u'\r');
+    if (valid) {
+        *valid = !decoder.hasError();
+    }
+    return Utf8Text(text);
+}
+
+QString Utf8Text::toString() const {
+    const QByteArrayView bytes = utf8();
+    return ascii_ ? QString::fromLatin1(bytes) : QString::fromUtf8(bytes);
+}
+
+QString Utf8Text::left(qsizetype n) const {
+    // Every UTF-16 unit takes at most three bytes
+    QByteArrayView bytes = utf8();
+    const qsizetype needed = ascii_ ? n : 3 * n;
+    if (bytes.size() > needed) {
+        qsizetype end = needed;
+        while (end > 0 && (uchar(bytes[end]) & 0xc0) == 0x80) {
+            --end;
+        }
+        bytes = bytes.first(end);
+    }
+    return (ascii_ ? QString::fromLatin1(bytes) : QString::fromUtf8(bytes)).left(n);
+}
+
+} // namespace DatasetCreator
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QString>
+
+namespace DatasetCreator {
+
+/**
+ * @brief UTF-8 validation for text payloads
+ *
+ * scan() checks a buffer in one pass, 16 bytes at a time with SSSE3 when
+ * the CPU has it (chosen at runtime), using the lookup-table method of
+ * Keiser and Lemire. Pure ASCII, the common case, is skipped a block at a
+ * time either way.
+ */
+class Utf8 {
+public:
+    struct Scan {
+        bool valid = true;
+        bool ascii = true;
+        bool carriageReturn = false;   // Holds a '\r'
+    };
+
+    static Scan scan(QByteArrayView data);
+
+private:
+    static bool validateScalar(const uchar* data, qsizetype size);
+    static bool validateSsse3(const uchar* data, qsizetype size);
+
+    enum class Isa { Scalar, Ssse3 };
+    static Isa isa();
+};
+
+/**
+ * @brief Text payload stored as UTF-8
+ *
+ * Takes half the memory of a QString for mostly ASCII text and is written
+ * to UTF-8 outputs as it is. Text of up to InlineCapacity bytes is kept in
+ * the object itself; longer text is an implicitly shared QByteArray. The
+ * bytes are always valid UTF-8. Convert with toString() only where a
+ * QString is needed, such as for display.
+ */
+class Utf8Text {
+public:
+    static constexpr qsizetype InlineCapacity = qsizetype(sizeof(QByteArray));
+    
+    Utf8Text() noexcept {}
+    Utf8Text(const QString& text);
+    Utf8Text(const Utf8Text& other) { assign(other); }
+    Utf8Text(Utf8Text&& other) noexcept { take(other); }
+    Utf8Text& operator=(const Utf8Text& other);
+    Utf8Text& operator=(Utf8Text&& other) noexcept;
+    ~Utf8Text() { release(); }
+    
+    // Invalid sequences are replaced with U+FFFD; valid tells whether there were none
+    static Utf8Text fromUtf8(QByteArrayView utf8, bool* valid = nullptr);
+    
+    // As fromUtf8(), dropping '\r' as text mode reading does
+    static Utf8Text fromTextMode(QByteArrayView utf8, bool* valid = nullptr);
+    
+    /**
+     * @brief Contents of a text file, decoded as QTextStream in text mode would
+     *
+     * A UTF-8 byte order mark is skipped; UTF-16 and UTF-32 with a byte
+     * order mark are converted. Anything else is read as UTF-8.
+     */
+    static Utf8Text fromTextFile(QByteArrayView contents, bool* valid = nullptr);
+    
+    QByteArrayView utf8() const { return size_ >= 0 ? QByteArrayView(inline_, size_) : QByteArrayView(heap_); }
+    QByteArray toByteArray() const { return size_ >= 0 ? QByteArray(inline_, size_) : heap_; }
+    QString toString() const;
+    QString left(qsizetype n) const;    // toString().left(n), converting only what it needs
+    
+    qsizetype size() const { return utf8().size(); }  // In bytes
+    bool isEmpty() const { return size() == 0; }
+    bool isAscii() const { return ascii_; }
+    
+    friend bool operator==(const Utf8Text& a, const Utf8Text& b) { return a.utf8() == b.utf8(); }
+    friend bool operator!=(const Utf8Text& a, const Utf8Text& b) { return !(a == b); }
+
+private:
+    static Utf8Text make(QByteArrayView utf8, bool ascii);
+    void adopt(QByteArray&& utf8, bool ascii);
+    
+    void assign(const Utf8Text& other);
+    void take(Utf8Text& other) noexcept;
+    void release() noexcept;
+    
+    union {
+        char inline_[InlineCapacity];
+        QByteArray heap_;
+    };
+    qint8 size_ = 0;        // Inline size, or -1 while heap_ is live
+    bool ascii_ = true;
+};
+
+} // namespace DatasetCreator
@@ -132,45 +132,7 @@ void DatasetView::populateTree() {
         // Flat structure: add samples directly
         const auto& samples = dataset_->samples();
         for (int i = 0; i < samples.size(); ++i) {
-            const auto& sample = samples[i];
-            
-            QList<QStandardItem*> row;
-            
-            // Name column - store sample ID and index
-            QStandardItem* nameItem = new QStandardItem(sample.metadata().id);
-            nameItem->setData(i, Qt::UserRole); // Store sample index
-            nameItem->setData(sample.metadata().id, Qt::UserRole + 2); // Store sample ID
-            nameItem->setData(false, Qt::UserRole + 1); // Not a subset
-            row.append(nameItem);
-            
-            // Type column
-            QString typeStr;
-            switch (sample.type()) {
-                case SampleType::Text: typeStr = "Text"; break;
-                case SampleType::Image: typeStr = "Image"; break;
-                case SampleType::Audio: typeStr = "Audio"; break;
-                case SampleType::Binary: typeStr = "Binary"; break;
-                case SampleType::Multimodal: typeStr = "Multimodal"; break;
-            }
-            row.append(new QStandardItem(typeStr));
-            
-            // Size column
-            QString sizeStr = QString::number(sample.dataSize()) + " bytes";
-            row.append(new QStandardItem(sizeStr));
-            
-            // Tags column
-            row.append(new QStandardItem(sample.metadata().tags.join(", ")));
-            
-            // Labels column (convert QVariantMap to string)
-            QString labelsStr;
-            QVariantMap labels = sample.metadata().labels;
-            for (auto it = labels.begin(); it != labels.end(); ++it) {
-                if (!labelsStr.isEmpty()) labelsStr += ", ";
-                labelsStr += it.key() + ":" + it.value().toString();
-            }
-            row.append(new QStandardItem(labelsStr));
-            
-            rootItem->appendRow(row);
+            rootItem->appendRow(createSampleRow(samples[i], i));
         }
     } else {
         // Hierarchical structure: add subsets with samples
@@ -192,41 +154,7 @@ void DatasetView::populateTree() {
             // Add samples to subset
             const auto& samples = subset.samples();
             for (int i = 0; i < samples.size(); ++i) {
-                const auto& sample = samples[i];
-                
-                QList<QStandardItem*> row;
-                
-                QStandardItem* nameItem = new QStandardItem(sample.metadata().id);
-                nameItem->setData(i, Qt::UserRole);
-                nameItem->setData(sample.metadata().id, Qt::UserRole + 2); // Store sample ID
-                nameItem->setData(false, Qt::UserRole + 1);
-                row.append(nameItem);
-                
-                QString typeStr;
-                switch (sample.type()) {
-                    case SampleType::Text: typeStr = "Text"; break;
-                    case SampleType::Image: typeStr = "Image"; break;
-                    case SampleType::Audio: typeStr = "Audio"; break;
-                    case SampleType::Binary: typeStr = "Binary"; break;
-                    case SampleType::Multimodal: typeStr = "Multimodal"; break;
-                }
-                row.append(new QStandardItem(typeStr));
-                
-                QString sizeStr = QString::number(sample.dataSize()) + " bytes";
-                row.append(new QStandardItem(sizeStr));
-                
-                row.append(new QStandardItem(sample.metadata().tags.join(", ")));
-                
-                // Labels column (convert QVariantMap to string)
-                QString labelsStr2;
-                QVariantMap labels2 = sample.metadata().labels;
-                for (auto it = labels2.begin(); it != labels2.end(); ++it) {
-                    if (!labelsStr2.isEmpty()) labelsStr2 += ", ";
-                    labelsStr2 += it.key() + ":" + it.value().toString();
-                }
-                row.append(new QStandardItem(labelsStr2));
-                
-                subsetItem->appendRow(row);
+                subsetItem->appendRow(createSampleRow(samples[i], i));
             }
             
             rootItem->appendRow(subsetRow);
@@ -239,14 +167,41 @@ void DatasetView::populateTree() {
 void DatasetView::addSample(const DatasetSample& sample) {
     if (!dataset_) return;
     
+    // The dataset may have given the sample a unique ID, so show its stored copy
+    const int index = dataset_->samples().size() - 1;
     QStandardItem* rootItem = model_->invisibleRootItem();
+    rootItem->appendRow(createSampleRow(dataset_->samples()[index], index));
+}
+
+void DatasetView::addSamples(const QList<DatasetSample>& samples) {
+    if (!dataset_ || samples.isEmpty()) return;
     
+    // Samples were already appended to the dataset, so they occupy its last indices
+    QStandardItem* rootItem = model_->invisibleRootItem();
+    const int firstRow = rootItem->rowCount();
+    const int firstIndex = dataset_->samples().size() - samples.size();
+    
+    // Insert the whole range at once so the view lays out one rowsInserted
+    treeView_->setUpdatesEnabled(false);
+    rootItem->insertRows(firstRow, samples.size());
+    for (int i = 0; i < samples.size(); ++i) {
+        const int index = firstIndex + i;
+        const QList<QStandardItem*> row = createSampleRow(dataset_->samples()[index], index);
+        for (int column = 0; column < row.size(); ++column) {
+            rootItem->setChild(firstRow + i, column, row[column]);
+        }
+    }
+    treeView_->setUpdatesEnabled(true);
+}
+
+QList<QStandardItem*> DatasetView::createSampleRow(const DatasetSample& sample, int index) const {
     QList<QStandardItem*> row;
     
-    // Name column
+    // Name column - store sample ID and index
     QStandardItem* nameItem = new QStandardItem(sample.metadata().id);
-    nameItem->setData(dataset_->samples().size() - 1, Qt::UserRole);
-    nameItem->setData(false, Qt::UserRole + 1);
+    nameItem->setData(index, Qt::UserRole); // Store sample index
+    nameItem->setData(sample.metadata().id, Qt::UserRole + 2); // Store sample ID
+    nameItem->setData(false, Qt::UserRole + 1); // Not a subset
     row.append(nameItem);
     
     // Type column
@@ -268,18 +223,18 @@ void DatasetView::addSample(const DatasetSample& sample) {
     row.append(new QStandardItem(sample.metadata().tags.join(", ")));
     
     // Labels column (convert QVariantMap to string)
-    QString labelsStr3;
-    QVariantMap labels3 = sample.metadata().labels;
-    for (auto it = labels3.begin(); it != labels3.end(); ++it) {
-        if (!labelsStr3.isEmpty()) labelsStr3 += ", ";
-        labelsStr3 += it.key() + ":" + it.value().toString();
+    QString labelsStr;
+    const QVariantMap& labels = sample.metadata().labels;
+    for (auto it = labels.begin(); it != labels.end(); ++it) {
+        if (!labelsStr.isEmpty()) labelsStr += ", ";
+        labelsStr += it.key() + ":" + it.value().toString();
     }
-    row.append(new QStandardItem(labelsStr3));
+    row.append(new QStandardItem(labelsStr));
     
-    rootItem->appendRow(row);
+    return row;
 }
 
-DatasetSample* DatasetView::getSelectedSample() {
+const DatasetSample* DatasetView::getSelectedSample() const {
     QModelIndex index = treeView_->currentIndex();
     if (!index.isValid() || !dataset_) return nullptr;
     
@@ -290,10 +245,7 @@ DatasetSample* DatasetView::getSelectedSample() {
     if (isSubset) return nullptr;
     
     int sampleIndex = item->data(Qt::UserRole).toInt();
-    if (sampleIndex < 0 || sampleIndex >= dataset_->samples().size()) return nullptr;
-    
-    // Return pointer to sample (const_cast needed since samples() returns const ref)
-    return const_cast<DatasetSample*>(&dataset_->samples()[sampleIndex]);
+    return dataset_->getSample(sampleIndex);
 }
 
 void DatasetView::onItemClicked(const QModelIndex& index) {
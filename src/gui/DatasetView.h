@@ -16,8 +16,9 @@ public:
     void setDataset(Dataset* dataset);
     void refresh();
     void addSample(const DatasetSample& sample);
+    void addSamples(const QList<DatasetSample>& samples);
     
-    DatasetSample* getSelectedSample();
+    const DatasetSample* getSelectedSample() const;
     int getSelectedSampleIndex() const;
     bool isSubsetSelected() const;
     QString getSelectedSubsetName() const;
@@ -51,6 +52,7 @@ private slots:
 private:
     void setupUI();
     void populateTree();
+    QList<QStandardItem*> createSampleRow(const DatasetSample& sample, int index) const;
     
     QTreeView* treeView_;
     DatasetTreeModel* model_;
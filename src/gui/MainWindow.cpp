@@ -7,6 +7,7 @@
 #include "AutoSplitDialog.h"
 #include "KFoldDialog.h"
 #include "plugins/PluginManager.h"
+#include "managers/BackgroundJob.h"
 #include "managers/ImportManager.h"
 #include "managers/ExportManager.h"
 #include "managers/MetadataManager.h"
@@ -21,8 +22,8 @@
 #include <QHBoxLayout>
 #include <QSplitter>
 #include <QPushButton>
+#include <QProgressDialog>
 #include <QStatusBar>
-#include <QSet>
 #include <QMap>
 #include <algorithm>
 #include <random>
@@ -51,6 +52,8 @@ MainWindow::MainWindow(QWidget* parent)
 }
 
 MainWindow::~MainWindow() {
+    delete importManager_;  // Waits for import workers still using the readers
+    delete exportManager_;  // Cancels exports still using the writers
     delete pluginManager_;
 }
 
@@ -107,6 +110,16 @@ void MainWindow::connectSignals() {
     // Import manager
     connect(importManager_, &ImportManager::sampleImported, 
             this, &MainWindow::onSampleImported);
+    connect(importManager_, &ImportManager::samplesImported,
+            this, &MainWindow::onSamplesImported);
+    connect(importManager_, &ImportManager::datasetImported,
+            this, &MainWindow::onDatasetImported);
+    connect(importManager_, &ImportManager::importProgress,
+            this, &MainWindow::onImportProgress);
+    
+    // Project manager
+    connect(projectManager_, &ProjectManager::loadProgress,
+            this, &MainWindow::onProjectLoadProgress);
     
     // Dataset view - display connections
     connect(datasetView_, &DatasetView::sampleSelected,
@@ -213,11 +226,23 @@ void MainWindow::onExportDataset() {
         if (fileName.endsWith(".json")) format = "json";
         else if (fileName.endsWith(".csv")) format = "csv";
         
-        bool success = exportManager_->exportDataset(currentDataset_, fileName, format);
-        if (success) {
-            QMessageBox::information(this, tr("Success"), 
-                                   tr("Dataset exported successfully!"));
-        }
+        // Exports a snapshot, so editing can go on while it runs
+        BackgroundJob* job = exportManager_->exportDatasetAsync(currentDataset_, fileName, format);
+        connect(job, &BackgroundJob::finished, this, &MainWindow::onExportJobFinished);
+        trackJob(job, false);
+    }
+}
+
+void MainWindow::onExportJobFinished(bool success, const QString& error) {
+    auto* job = qobject_cast<BackgroundJob*>(sender());
+    if (success) {
+        QMessageBox::information(this, tr("Success"), 
+                               tr("Dataset exported successfully!"));
+    } else if (job && job->isCancelled()) {
+        statusBar()->showMessage(tr("Export cancelled"));
+    } else {
+        QMessageBox::warning(this, tr("Export Error"),
+            tr("Failed to export dataset: %1").arg(error));
     }
 }
 
@@ -234,6 +259,52 @@ void MainWindow::onSampleImported(const DatasetSample& sample) {
     );
 }
 
+void MainWindow::onSamplesImported(const QList<DatasetSample>& samples) {
+    currentDataset_.addSamples(samples);
+    datasetView_->addSamples(samples);
+    statsWidget_->refresh();
+    markAsModified();
+    
+    statusBar()->showMessage(
+        tr("Imported %1 samples (Total: %2 samples)")
+            .arg(samples.size())
+            .arg(currentDataset_.totalSampleCount())
+    );
+}
+
+void MainWindow::onDatasetImported(const Dataset& dataset) {
+    // An export imported into an empty project brings back its metadata
+    const bool adoptMetadata = currentDataset_.isEmpty();
+    currentDataset_.merge(dataset);
+    if (adoptMetadata) {
+        currentDataset_.metadata() = dataset.metadata();
+    }
+    refreshAllViews();
+    markAsModified();
+    
+    statusBar()->showMessage(
+        tr("Imported %1 samples in %2 subsets (Total: %3 samples)")
+            .arg(dataset.totalSampleCount())
+            .arg(dataset.subsetCount())
+            .arg(currentDataset_.totalSampleCount())
+    );
+}
+
+void MainWindow::onImportProgress(int current, int total, double filesPerSecond, double megabytesPerSecond) {
+    statusBar()->showMessage(
+        tr("Importing %1/%2 (%3 files/s, %4 MB/s)")
+            .arg(current)
+            .arg(total)
+            .arg(filesPerSecond, 0, 'f', 1)
+            .arg(megabytesPerSecond, 0, 'f', 1)
+    );
+}
+
+void MainWindow::onProjectLoadProgress(int current, int total) {
+    // Forwarded from the load job, which the progress dialog also tracks
+    statusBar()->showMessage(tr("Loading project %1/%2 samples").arg(current).arg(total));
+}
+
 void MainWindow::onSampleSelectedWithIndex(const DatasetSample& sample, int index) {
     currentSampleIndex_ = index;
 }
@@ -337,22 +408,14 @@ void MainWindow::onBatchMoveToSubsetRequested(const QList<int>& sampleIndices) {
             return;
         }
         
-        // Move samples to subset (in reverse order to preserve indices)
-        QList<int> sortedIndices = sampleIndices;
-        std::sort(sortedIndices.begin(), sortedIndices.end(), std::greater<int>());
-        
-        for (int sampleIndex : sortedIndices) {
-            if (sampleIndex >= 0 && sampleIndex < currentDataset_.sampleCount()) {
-                currentDataset_.moveSampleToSubset(sampleIndex, subsetName);
-            }
-        }
+        int moved = currentDataset_.moveSamplesToSubset(sampleIndices, subsetName);
         
         // Refresh views
         markAsModified();
         refreshAllViews();
         
         statusBar()->showMessage(tr("Moved %1 samples to subset '%2'")
-            .arg(sampleIndices.size()).arg(subsetName));
+            .arg(moved).arg(subsetName));
     }
 }
 
@@ -361,47 +424,20 @@ void MainWindow::onSampleDraggedToSubset(const QString& sampleId, const QString&
         return;
     }
     
-    // Find the sample by ID in the flat samples list
-    int sampleIndex = -1;
-    for (int i = 0; i < currentDataset_.samples().size(); ++i) {
-        if (currentDataset_.samples()[i].metadata().id == sampleId) {
-            sampleIndex = i;
-            break;
-        }
-    }
-    
-    if (sampleIndex >= 0) {
-        // Move sample from root to subset
-        currentDataset_.moveSampleToSubset(sampleIndex, subsetName);
-        markAsModified();
-        refreshAllViews();
-        statusBar()->showMessage(tr("Moved sample to subset '%1'").arg(subsetName));
+    Dataset::SampleLocation location = currentDataset_.findSample(sampleId);
+    if (!location.isValid() || location.subsetName == subsetName) {
         return;
     }
     
-    // If not found in root, check if it's in a subset and needs to be moved
-    for (const auto& subset : currentDataset_.subsets()) {
-        for (int i = 0; i < subset.samples().size(); ++i) {
-            if (subset.samples()[i].metadata().id == sampleId) {
-                // Sample found in subset, move it to different subset
-                // First move to root, then to target subset
-                currentDataset_.moveSampleFromSubset(subset.name(), i);
-                
-                // Now find it in root and move to target
-                for (int j = 0; j < currentDataset_.samples().size(); ++j) {
-                    if (currentDataset_.samples()[j].metadata().id == sampleId) {
-                        currentDataset_.moveSampleToSubset(j, subsetName);
-                        break;
-                    }
-                }
-                
-                markAsModified();
-                refreshAllViews();
-                statusBar()->showMessage(tr("Moved sample from '%1' to '%2'")
-                    .arg(subset.name()).arg(subsetName));
-                return;
-            }
-        }
+    currentDataset_.moveSampleById(sampleId, subsetName);
+    markAsModified();
+    refreshAllViews();
+    
+    if (location.isRoot()) {
+        statusBar()->showMessage(tr("Moved sample to subset '%1'").arg(subsetName));
+    } else {
+        statusBar()->showMessage(tr("Moved sample from '%1' to '%2'")
+            .arg(location.subsetName).arg(subsetName));
     }
 }
 
@@ -410,20 +446,17 @@ void MainWindow::onSampleDraggedToRoot(const QString& sampleId) {
         return;
     }
     
-    // Find which subset contains this sample
-    for (const auto& subset : currentDataset_.subsets()) {
-        for (int i = 0; i < subset.samples().size(); ++i) {
-            if (subset.samples()[i].metadata().id == sampleId) {
-                // Move sample from subset back to root
-                currentDataset_.moveSampleFromSubset(subset.name(), i);
-                markAsModified();
-                refreshAllViews();
-                statusBar()->showMessage(tr("Moved sample from '%1' back to root")
-                    .arg(subset.name()));
-                return;
-            }
-        }
+    // Only samples that currently live in a subset can be moved back
+    Dataset::SampleLocation location = currentDataset_.findSample(sampleId);
+    if (!location.isValid() || location.isRoot()) {
+        return;
     }
+    
+    currentDataset_.moveSampleById(sampleId, QString());
+    markAsModified();
+    refreshAllViews();
+    statusBar()->showMessage(tr("Moved sample from '%1' back to root")
+        .arg(location.subsetName));
 }
 
 void MainWindow::onAutoSplit() {
@@ -434,15 +467,8 @@ void MainWindow::onAutoSplit() {
         return;
     }
     
-    // Collect all available label keys from dataset
-    QSet<QString> labelKeysSet;
-    for (const auto& sample : currentDataset_.samples()) {
-        for (const QString& key : sample.metadata().labels.keys()) {
-            labelKeysSet.insert(key);
-        }
-    }
-    QStringList availableLabels = labelKeysSet.values();
-    availableLabels.sort();
+    // All label keys in the dataset (kept up to date by Dataset, already sorted)
+    QStringList availableLabels = currentDataset_.labelCounts().keys();
     
     // Show auto-split dialog
     AutoSplitDialog dialog(currentDataset_.sampleCount(), availableLabels, this);
@@ -457,7 +483,7 @@ void MainWindow::onAutoSplit() {
     AutoSplitDialog::SplitConfig config = dialog.getConfig();
     
     // Collect all samples from root
-    QList<DatasetSample> samples = currentDataset_.samples();
+    const SampleView samples = currentDataset_.samples();
     if (samples.isEmpty()) {
         QMessageBox::warning(this, tr("No Samples"), 
             tr("Cannot perform auto-split: no samples in the root dataset."));
@@ -531,30 +557,22 @@ void MainWindow::onAutoSplit() {
         currentDataset_.addSubset(DatasetSubset(config.testName));
     }
     
-    // Move samples according to split (process in reverse order to preserve indices)
-    std::vector<std::pair<int, QString>> moves; // index, target subset
+    // Assign root indices to their target subsets and move them in one pass
+    QMap<QString, QList<int>> moves; // target subset -> indices
     
     int currentIndex = 0;
     for (int i = 0; i < trainingSize && currentIndex < static_cast<int>(indices.size()); ++i, ++currentIndex) {
-        moves.push_back(std::make_pair(indices[currentIndex], config.trainingName));
+        moves[config.trainingName].append(indices[currentIndex]);
     }
     for (int i = 0; i < validationSize && currentIndex < static_cast<int>(indices.size()); ++i, ++currentIndex) {
-        moves.push_back(std::make_pair(indices[currentIndex], config.validationName));
+        moves[config.validationName].append(indices[currentIndex]);
     }
     for (int i = 0; i < testSize && currentIndex < static_cast<int>(indices.size()); ++i, ++currentIndex) {
-        moves.push_back(std::make_pair(indices[currentIndex], config.testName));
+        moves[config.testName].append(indices[currentIndex]);
     }
     
-    // Sort by index in descending order to preserve indices during moves
-    std::sort(moves.begin(), moves.end(), 
-        [](const auto& a, const auto& b) { return a.first > b.first; });
-    
-    // Perform the moves
-    for (const auto& move : moves) {
-        if (!move.second.isEmpty()) {
-            currentDataset_.moveSampleToSubset(move.first, move.second);
-        }
-    }
+    // Samples assigned to an unnamed subset stay in the root
+    currentDataset_.moveSamplesToSubsets(moves);
     
     // Refresh views
     markAsModified();
@@ -580,15 +598,8 @@ void MainWindow::onKFoldSplit() {
         return;
     }
     
-    // Collect all available label keys from dataset
-    QSet<QString> labelKeysSet;
-    for (const auto& sample : currentDataset_.samples()) {
-        for (const QString& key : sample.metadata().labels.keys()) {
-            labelKeysSet.insert(key);
-        }
-    }
-    QStringList availableLabels = labelKeysSet.values();
-    availableLabels.sort();
+    // All label keys in the dataset (kept up to date by Dataset, already sorted)
+    QStringList availableLabels = currentDataset_.labelCounts().keys();
     
     // Show K-Fold dialog
     KFoldDialog dialog(currentDataset_.sampleCount(), availableLabels, this);
@@ -603,7 +614,7 @@ void MainWindow::onKFoldSplit() {
     KFoldDialog::KFoldConfig config = dialog.getConfig();
     
     // Collect all samples from root
-    QList<DatasetSample> samples = currentDataset_.samples();
+    const SampleView samples = currentDataset_.samples();
     if (samples.isEmpty()) {
         QMessageBox::warning(this, tr("No Samples"), 
             tr("Cannot perform K-Fold split: no samples in the root dataset."));
@@ -685,8 +696,8 @@ void MainWindow::onKFoldSplit() {
         }
     }
     
-    // Assign samples to folds (process in reverse order to preserve indices)
-    std::vector<std::pair<int, QString>> moves; // index, target subset
+    // Assign samples to folds and move them in one pass
+    QMap<QString, QList<int>> moves; // fold subset -> indices
     
     int currentIndex = 0;
     for (int fold = 0; fold < numFolds; ++fold) {
@@ -694,21 +705,15 @@ void MainWindow::onKFoldSplit() {
         QString foldName = QString("%1%2").arg(config.prefixName).arg(fold + 1);
         
         // Mark samples for this fold
+        QList<int>& foldIndices = moves[foldName];
         for (int i = 0; i < thisFoldSize; ++i) {
-            moves.push_back(std::make_pair(indices[currentIndex + i], foldName));
+            foldIndices.append(indices[currentIndex + i]);
         }
         
         currentIndex += thisFoldSize;
     }
     
-    // Sort by index in descending order to preserve indices during moves
-    std::sort(moves.begin(), moves.end(), 
-        [](const auto& a, const auto& b) { return a.first > b.first; });
-    
-    // Perform the moves
-    for (const auto& move : moves) {
-        currentDataset_.moveSampleToSubset(move.first, move.second);
-    }
+    currentDataset_.moveSamplesToSubsets(moves);
     
     // Refresh views
     markAsModified();
@@ -787,19 +792,12 @@ void MainWindow::onUndoSplit() {
             continue;
         }
         
-        // Find sample in root by ID
-        const auto& rootSamples = currentDataset_.samples();
-        for (int i = 0; i < rootSamples.size(); ++i) {
-            if (rootSamples[i].metadata().id == sampleId) {
-                // Create subset if it doesn't exist
-                if (!currentDataset_.subsetNames().contains(subsetName)) {
-                    currentDataset_.addSubset(DatasetSubset(subsetName));
-                }
-                // Move sample to original subset
-                currentDataset_.moveSampleToSubset(i, subsetName);
-                break;
-            }
+        // Create subset if it doesn't exist
+        if (!currentDataset_.getSubset(subsetName)) {
+            currentDataset_.addSubset(DatasetSubset(subsetName));
         }
+        // Move sample to original subset
+        currentDataset_.moveSampleById(sampleId, subsetName);
     }
     
     // Refresh views
@@ -888,17 +886,13 @@ void MainWindow::onDeleteSamplesFromToolbar() {
         QMessageBox::Yes | QMessageBox::No);
     
     if (reply == QMessageBox::Yes) {
-        // Sort in descending order to delete from end to start (avoids index shifting issues)
-        std::sort(selectedIndices.begin(), selectedIndices.end(), std::greater<int>());
-        
-        // Delete each sample
-        for (int index : selectedIndices) {
-            onDeleteSampleRequested(index);
-        }
+        int removed = currentDataset_.removeSamples(selectedIndices);
+        currentSampleIndex_ = -1;
         
         // Refresh views
+        markAsModified();
         refreshAllViews();
-        statusBar()->showMessage(tr("Deleted %1 sample(s)").arg(selectedIndices.size()));
+        statusBar()->showMessage(tr("Deleted %1 sample(s)").arg(removed));
     }
 }
 
@@ -909,6 +903,7 @@ void MainWindow::onNewProject() {
         return;  // User cancelled
     }
     
+    importManager_->cancel();
     currentDataset_ = Dataset("New Dataset");
     currentProjectPath_.clear();
     hasUnsavedChanges_ = false;
@@ -935,10 +930,20 @@ void MainWindow::onOpenProject() {
         return;
     }
     
-    Dataset loadedDataset;
-    if (projectManager_->loadProject(fileName, loadedDataset)) {
-        currentDataset_ = loadedDataset;
-        currentProjectPath_ = fileName;
+    // Loaded into a dataset of its own; the window stays blocked until done
+    loadingDataset_ = std::make_shared<Dataset>();
+    loadingProjectPath_ = fileName;
+    BackgroundJob* job = projectManager_->loadProjectAsync(fileName, loadingDataset_);
+    connect(job, &BackgroundJob::finished, this, &MainWindow::onLoadJobFinished);
+    trackJob(job, true);
+}
+
+void MainWindow::onLoadJobFinished(bool success, const QString& error) {
+    std::shared_ptr<Dataset> loadedDataset = std::move(loadingDataset_);
+    if (success) {
+        importManager_->cancel();
+        currentDataset_ = std::move(*loadedDataset);
+        currentProjectPath_ = loadingProjectPath_;
         hasUnsavedChanges_ = false;
         
         refreshAllViews();
@@ -946,10 +951,10 @@ void MainWindow::onOpenProject() {
         metadataEditor_->clear();
         
         updateWindowTitle();
-        statusBar()->showMessage(tr("Project loaded: %1").arg(fileName));
+        statusBar()->showMessage(tr("Project loaded: %1").arg(currentProjectPath_));
     } else {
         QMessageBox::warning(this, tr("Load Error"),
-            tr("Failed to load project: %1").arg(projectManager_->lastError()));
+            tr("Failed to load project: %1").arg(error));
     }
 }
 
@@ -959,40 +964,118 @@ void MainWindow::onSaveProject() {
         return;
     }
     
-    if (projectManager_->saveProject(currentDataset_, currentProjectPath_)) {
-        hasUnsavedChanges_ = false;
-        updateWindowTitle();
-        statusBar()->showMessage(tr("Project saved: %1").arg(currentProjectPath_));
-    } else {
-        QMessageBox::warning(this, tr("Save Error"),
-            tr("Failed to save project: %1").arg(projectManager_->lastError()));
-    }
+    startSaveProject(currentProjectPath_);
 }
 
 void MainWindow::onSaveProjectAs() {
+    QString fileName = askProjectSavePath();
+    if (!fileName.isEmpty()) {
+        startSaveProject(fileName);
+    }
+}
+
+QString MainWindow::askProjectSavePath() {
     QString fileName = QFileDialog::getSaveFileName(
         this, tr("Save Project As"), QString(),
         tr("Dataset Creator Project (*.dscp)")
     );
     
-    if (fileName.isEmpty()) {
-        return;
-    }
-    
     // Add extension if not present
-    if (!fileName.endsWith(".dscp", Qt::CaseInsensitive)) {
+    if (!fileName.isEmpty() && !fileName.endsWith(".dscp", Qt::CaseInsensitive)) {
         fileName += ".dscp";
     }
+    return fileName;
+}
+
+void MainWindow::startSaveProject(const QString& fileName) {
+    // Saved from a snapshot; changes made meanwhile mark the project
+    // modified again
+    savingProjectPath_ = fileName;
+    hasUnsavedChanges_ = false;
+    updateWindowTitle();
     
-    if (projectManager_->saveProject(currentDataset_, fileName)) {
-        currentProjectPath_ = fileName;
-        hasUnsavedChanges_ = false;
-        updateWindowTitle();
-        statusBar()->showMessage(tr("Project saved: %1").arg(fileName));
+    BackgroundJob* job = projectManager_->saveProjectAsync(currentDataset_, fileName);
+    connect(job, &BackgroundJob::finished, this, &MainWindow::onSaveJobFinished);
+    trackJob(job, false);
+}
+
+void MainWindow::onSaveJobFinished(bool success, const QString& error) {
+    auto* job = qobject_cast<BackgroundJob*>(sender());
+    if (success) {
+        currentProjectPath_ = savingProjectPath_;
+        statusBar()->showMessage(tr("Project saved: %1").arg(currentProjectPath_));
     } else {
+        hasUnsavedChanges_ = true;
+        if (job && job->isCancelled()) {
+            statusBar()->showMessage(tr("Save cancelled"));
+        } else {
+            QMessageBox::warning(this, tr("Save Error"),
+                tr("Failed to save project: %1").arg(error));
+        }
+    }
+    updateWindowTitle();
+}
+
+bool MainWindow::saveProjectNow() {
+    QString fileName = currentProjectPath_;
+    if (fileName.isEmpty()) {
+        fileName = askProjectSavePath();
+        if (fileName.isEmpty()) {
+            return false;
+        }
+    }
+    
+    if (!projectManager_->saveProject(currentDataset_, fileName)) {
         QMessageBox::warning(this, tr("Save Error"),
             tr("Failed to save project: %1").arg(projectManager_->lastError()));
+        return false;
+    }
+    currentProjectPath_ = fileName;
+    hasUnsavedChanges_ = false;
+    updateWindowTitle();
+    statusBar()->showMessage(tr("Project saved: %1").arg(fileName));
+    return true;
+}
+
+void MainWindow::trackJob(BackgroundJob* job, bool modal) {
+    auto* dialog = new QProgressDialog(job->description(), tr("Cancel"), 0, 0, this);
+    dialog->setWindowModality(modal ? Qt::WindowModal : Qt::NonModal);
+    dialog->setMinimumDuration(500);
+    dialog->setAutoClose(false);
+    dialog->setAutoReset(false);
+    jobDialogs_.insert(job, dialog);
+    
+    connect(dialog, &QProgressDialog::canceled, job, &BackgroundJob::cancel);
+    connect(job, &BackgroundJob::progress, this, &MainWindow::onJobProgress);
+    connect(job, &BackgroundJob::finished, this, &MainWindow::onJobFinished);
+}
+
+void MainWindow::onJobProgress(int current, int total, qint64 bytes, double bytesPerSecond, qint64 remainingMs) {
+    auto* job = qobject_cast<BackgroundJob*>(sender());
+    QProgressDialog* dialog = jobDialogs_.value(job);
+    if (!dialog) {
+        return;
+    }
+    
+    dialog->setMaximum(total);
+    dialog->setValue(current);
+    QString text = tr("%1\n%2 of %3 samples, %4 MB at %5 MB/s")
+        .arg(job->description())
+        .arg(current).arg(total)
+        .arg(bytes / (1024.0 * 1024.0), 0, 'f', 1)
+        .arg(bytesPerSecond / (1024.0 * 1024.0), 0, 'f', 1);
+    if (remainingMs >= 0 && current < total) {
+        text += tr(", about %1 s left").arg((remainingMs + 999) / 1000);
+    }
+    dialog->setLabelText(text);
+}
+
+void MainWindow::onJobFinished() {
+    auto* job = qobject_cast<BackgroundJob*>(sender());
+    if (QProgressDialog* dialog = jobDialogs_.take(job)) {
+        dialog->deleteLater();
     }
+    job->deleteLater();
 }
 
 void MainWindow::setUnsavedChanges(bool hasChanges) {
@@ -1028,8 +1111,7 @@ bool MainWindow::promptSaveChanges() {
         QMessageBox::Save | QMessageBox::Discard | QMessageBox::Cancel);
     
     if (reply == QMessageBox::Save) {
-        onSaveProject();
-        return !hasUnsavedChanges_;  // Return false if save failed
+        return saveProjectNow();  // Return false if save failed
     } else if (reply == QMessageBox::Discard) {
         return true;
     } else {
@@ -1,11 +1,16 @@
 #pragma once
+#include <QHash>
 #include <QMainWindow>
 #include <QStack>
+#include <memory>
 #include "core/Dataset.h"
 #include "SplitCommand.h"
 
+class QProgressDialog;
+
 namespace DatasetCreator {
 
+class BackgroundJob;
 class PluginManager;
 class ImportManager;
 class ExportManager;
@@ -21,7 +26,7 @@ class MainWindow : public QMainWindow {
 public:
     explicit MainWindow(QWidget* parent = nullptr);
     ~MainWindow();
-    
+
 private slots:
     void onNewProject();
     void onOpenProject();
@@ -33,6 +38,15 @@ private slots:
     void onKFoldSplit();
     void onUndoSplit();
     void onSampleImported(const DatasetSample& sample);
+    void onSamplesImported(const QList<DatasetSample>& samples);
+    void onDatasetImported(const Dataset& dataset);
+    void onImportProgress(int current, int total, double filesPerSecond, double megabytesPerSecond);
+    void onProjectLoadProgress(int current, int total);
+    void onJobProgress(int current, int total, qint64 bytes, double bytesPerSecond, qint64 remainingMs);
+    void onJobFinished();
+    void onLoadJobFinished(bool success, const QString& error);
+    void onSaveJobFinished(bool success, const QString& error);
+    void onExportJobFinished(bool success, const QString& error);
     void onSampleSelectedWithIndex(const DatasetSample& sample, int index);
     void onTagsChanged(const QStringList& tags);
     void onLabelsChanged(const QStringList& labels);
@@ -45,7 +59,7 @@ private slots:
     void onDeleteSubsetFromToolbar(const QString& subsetName);
     void onImportFilesFromToolbar();
     void onDeleteSamplesFromToolbar();
-    
+
 private:
     void setupUI();
     void createMenuBar();
@@ -54,6 +68,10 @@ private:
     void setUnsavedChanges(bool hasChanges);
     void updateWindowTitle();
     bool promptSaveChanges();  // Returns false if user cancels
+    QString askProjectSavePath();  // Empty if the user cancels
+    bool saveProjectNow();  // Synchronous, for when the dataset is about to be replaced
+    void startSaveProject(const QString& fileName);
+    void trackJob(BackgroundJob* job, bool modal);
     void refreshAllViews();
     void markAsModified();  // Convenience for setUnsavedChanges(true)
     
@@ -61,6 +79,12 @@ private:
     QString currentProjectPath_;
     bool hasUnsavedChanges_;
     
+    // Background jobs and the dialogs showing their progress
+    QHash<BackgroundJob*, QProgressDialog*> jobDialogs_;
+    std::shared_ptr<Dataset> loadingDataset_;
+    QString loadingProjectPath_;
+    QString savingProjectPath_;
+    
     PluginManager* pluginManager_;
     ImportManager* importManager_;
     ExportManager* exportManager_;
@@ -71,9 +71,8 @@ void SamplePreview::clear() {
 }
 
 void SamplePreview::showText(const DatasetSample& sample) {
-    QString text = sample.asText();
-    
-    // Limit preview to first 10000 characters
+    // Limit preview to first 10000 characters; only those are converted
+    QString text = sample.asUtf8Text().left(10001);
     if (text.length() > 10000) {
         text = text.left(10000) + "\n\n... (truncated)";
     }
@@ -83,7 +82,7 @@ void SamplePreview::showText(const DatasetSample& sample) {
 }
 
 void SamplePreview::showImage(const DatasetSample& sample) {
-    QImage image = sample.asImage();
+    const QImage image = sample.asImage();
     
     if (!image.isNull()) {
         QPixmap pixmap = QPixmap::fromImage(image);
@@ -127,7 +126,7 @@ void SamplePreview::showAudio(const DatasetSample& sample) {
 }
 
 void SamplePreview::showBinary(const DatasetSample& sample) {
-    QByteArray data = sample.asBinary();
+    const QByteArray data = sample.asBinary();
     
     QString hexDump = "Binary Data Preview\n\n";
     hexDump += "Size: " + QString::number(data.size()) + " bytes\n\n";
@@ -0,0 +1,71 @@
+#include "BackgroundJob.h"
+
+namespace DatasetCreator {
+
+BackgroundJob::BackgroundJob(const QString& description, QObject* parent)
+    : QObject(parent)
+    , description_(description)
+    , state_(std::make_shared<State>())
+{
+}
+
+BackgroundJob::~BackgroundJob() {
+    // Results the worker posts after this point are dropped with the object
+    cancel();
+    wait();
+}
+
+void BackgroundJob::start(QThreadPool* pool, Work work) {
+    if (started_) {
+        return;
+    }
+    started_ = true;
+    running_ = true;
+    state_->timer.start();
+    
+    pool->start([this, work]() {
+        QString error;
+        bool ok = work([this](int current, int total, qint64 bytes) { return report(current, total, bytes); },
+                       &error);
+        if (!ok && state_->cancelled) {
+            error = tr("Cancelled");
+        }
+        
+        QMetaObject::invokeMethod(this, [this, ok, error]() {
+            running_ = false;
+            succeeded_ = ok;
+            error_ = error;
+            emit finished(ok, error);
+        }, Qt::QueuedConnection);
+        state_->done.release();
+    });
+}
+
+void BackgroundJob::wait() {
+    if (started_) {
+        state_->done.acquire();
+        state_->done.release();
+    }
+}
+
+bool BackgroundJob::report(int current, int total, qint64 bytes) {
+    // Runs on the worker
+    if (state_->cancelled) {
+        return false;
+    }
+    
+    const qint64 elapsed = state_->timer.elapsed();
+    if (current < total && state_->lastReportMs >= 0 && elapsed - state_->lastReportMs < 100) {
+        return true;
+    }
+    state_->lastReportMs = elapsed;
+    
+    const double bytesPerSecond = bytes / (qMax<qint64>(1, elapsed) / 1000.0);
+    const qint64 remainingMs = current > 0 ? qint64(double(elapsed) * (total - current) / current) : -1;
+    QMetaObject::invokeMethod(this, [this, current, total, bytes, bytesPerSecond, remainingMs]() {
+        emit progress(current, total, bytes, bytesPerSecond, remainingMs);
+    }, Qt::QueuedConnection);
+    return true;
+}
+
+}
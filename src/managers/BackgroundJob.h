@@ -0,0 +1,68 @@
+#pragma once
+#include "core/Progress.h"
+#include <QElapsedTimer>
+#include <QObject>
+#include <QSemaphore>
+#include <QString>
+#include <QThreadPool>
+#include <atomic>
+#include <memory>
+
+namespace DatasetCreator {
+
+/**
+ * @brief A save, load or export running on a worker thread
+ *
+ * The work function is handed a ProgressCallback to call after each
+ * sample. The job turns those calls into progress() signals, at most ten
+ * per second, with throughput and an estimate of the time left. Once
+ * cancel() was called the callback returns false, so the work stops and
+ * discards its partial output. Signals arrive on the thread that owns the
+ * job; destroying a running job cancels it and waits for the work.
+ */
+class BackgroundJob : public QObject {
+    Q_OBJECT
+public:
+    using Work = std::function<bool(const ProgressCallback& progress, QString* error)>;
+    
+    explicit BackgroundJob(const QString& description, QObject* parent = nullptr);
+    ~BackgroundJob();
+    
+    /**
+     * @brief Run work on a pool; call once
+     */
+    void start(QThreadPool* pool, Work work);
+    
+    void cancel() { state_->cancelled = true; }
+    bool isCancelled() const { return state_->cancelled; }
+    bool isRunning() const { return running_; }    // Until finished() is emitted
+    void wait();                                    // Until the work has returned
+    
+    QString description() const { return description_; }
+    bool succeeded() const { return succeeded_; }
+    QString errorString() const { return error_; }
+
+signals:
+    void progress(int current, int total, qint64 bytes, double bytesPerSecond, qint64 remainingMs);
+    void finished(bool success, const QString& error);
+
+private:
+    // Shared with the worker, which may still run while the job is destroyed
+    struct State {
+        std::atomic<bool> cancelled{false};
+        QSemaphore done;
+        QElapsedTimer timer;
+        qint64 lastReportMs = -1;       // Worker thread only
+    };
+    
+    bool report(int current, int total, qint64 bytes);
+    
+    QString description_;
+    std::shared_ptr<State> state_;
+    bool started_ = false;
+    bool running_ = false;
+    bool succeeded_ = false;
+    QString error_;
+};
+
+}
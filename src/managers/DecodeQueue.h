@@ -0,0 +1,95 @@
+#pragma once
+#include <QSemaphore>
+#include <QThread>
+#include <QThreadPool>
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <vector>
+
+namespace DatasetCreator {
+
+/**
+ * @brief Decodes items on a thread pool and hands them back in order
+ *
+ * Items are decoded in windows of batchSize() items per thread. While one
+ * window is consumed on the calling thread, the next one is already being
+ * decoded, so at most two windows of decoded items exist at any time and
+ * memory stays bounded no matter how many items there are.
+ */
+template <typename T>
+class DecodeQueue {
+public:
+    using Decode = std::function<T(int index)>;            // Runs on a worker thread
+    using Consume = std::function<bool(int index, T& item)>;  // Calling thread; false stops
+    
+    explicit DecodeQueue(int batchSize = 32)
+        : batchSize_(qMax(1, batchSize)) {
+        pool_.setMaxThreadCount(QThread::idealThreadCount());
+    }
+    
+    int batchSize() const { return batchSize_; }
+    
+    /**
+     * @brief Decode items 0..count-1 and consume them in index order
+     * @return false if consume() stopped early
+     */
+    bool run(int count, const Decode& decode, const Consume& consume) {
+        const int window = batchSize_ * qMax(1, pool_.maxThreadCount());
+        std::array<std::vector<T>, 2> buffers;
+        std::array<QSemaphore, 2> done;
+        std::array<int, 2> batches = {0, 0};
+        
+        auto dispatch = [&](int slot, int first) {
+            std::vector<T>& items = buffers[slot];
+            items.clear();
+            items.resize(std::min(window, count - first));
+            batches[slot] = 0;
+            for (int start = 0; start < int(items.size()); start += batchSize_) {
+                const int end = std::min(int(items.size()), start + batchSize_);
+                QSemaphore* finished = &done[slot];
+                pool_.start([&items, &decode, finished, first, start, end]() {
+                    for (int i = start; i < end; ++i) {
+                        items[i] = decode(first + i);
+                    }
+                    finished->release();
+                });
+                ++batches[slot];
+            }
+        };
+        
+        int slot = 0;
+        int first = 0;
+        if (count > 0) {
+            dispatch(slot, first);
+        }
+        
+        while (first < count) {
+            const int next = first + int(buffers[slot].size());
+            if (next < count) {
+                dispatch(1 - slot, next);
+            }
+            
+            done[slot].acquire(batches[slot]);
+            for (int i = 0; i < int(buffers[slot].size()); ++i) {
+                if (!consume(first + i, buffers[slot][i])) {
+                    // Workers still reference the other window
+                    done[1 - slot].acquire(next < count ? batches[1 - slot] : 0);
+                    return false;
+                }
+            }
+            buffers[slot].clear();
+            
+            slot = 1 - slot;
+            first = next;
+        }
+        
+        return true;
+    }
+
+private:
+    int batchSize_;
+    QThreadPool pool_;
+};
+
+}
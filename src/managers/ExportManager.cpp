@@ -1,24 +1,412 @@
 #include "ExportManager.h"
 #include "plugins/PluginManager.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QMutex>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <QSet>
+#include <QThread>
+#include <atomic>
+#include <vector>
 
 namespace DatasetCreator {
 
 ExportManager::ExportManager(PluginManager* pluginManager, QObject* parent)
-    : QObject(parent), pluginManager_(pluginManager) {}
+    : QObject(parent), pluginManager_(pluginManager) {
+    exportPool_.setMaxThreadCount(1);
+}
 
-bool ExportManager::exportDataset(const Dataset& dataset, const QString& outputPath, const QString& format) {
+ExportManager::~ExportManager() {
+    // Running exports use writers of the plugin manager; stop them first
+    for (BackgroundJob* job : findChildren<BackgroundJob*>()) {
+        job->cancel();
+    }
+    exportPool_.waitForDone();
+}
+
+IDataWriter* ExportManager::prepareWriter(const QString& format, const QString& blobStorePath) const {
     IDataWriter* writer = pluginManager_->getWriterForFormat(format);
+    if (!writer) {
+        return nullptr;
+    }
+    
+    QVariantMap options = writer->currentOptions();
+    if (options.contains("blob_store")) {
+        options["blob_store"] = blobStorePath;
+        writer->setOptions(options);
+    }
+    return writer;
+}
+
+bool ExportManager::runWriter(IDataWriter* writer, const Dataset& dataset, const QString& outputPath,
+                              const ProgressCallback& progress) {
+    if (!writer->supportsStreaming()) {
+        writer->setProgressCallback(progress);
+        const bool ok = writer->write(outputPath, dataset);
+        writer->setProgressCallback(nullptr);
+        return ok;
+    }
+    
+    // Streamed one sample at a time, in constant memory; the writer does
+    // not know the total, so it is filled in here
+    int total = dataset.samples().size();
+    for (const auto& subset : dataset.subsets()) {
+        total += subset.samples().size();
+    }
+    if (progress) {
+        writer->setProgressCallback([progress, total](int current, int, qint64 bytes) {
+            return progress(current, total, bytes);
+        });
+    }
+    const bool ok = IDataWriter::streamDataset(*writer, outputPath, dataset);
+    writer->setProgressCallback(nullptr);
+    return ok;
+}
+
+bool ExportManager::exportDataset(const Dataset& dataset, const QString& outputPath, const QString& format) {
+    // A background export may be using the same writer
+    exportPool_.waitForDone();
+    
+    IDataWriter* writer = prepareWriter(format, blobStorePath_);
     if (!writer) {
         emit exportError("No writer available for format: " + format);
         return false;
     }
     
+    int lastPercent = -1;
+    auto progress = [this, &lastPercent](int current, int total, qint64) {
+        const int percent = total > 0 ? current * 100 / total : 100;
+        if (percent != lastPercent) {
+            lastPercent = percent;
+            emit exportProgress(percent);
+        }
+        return true;
+    };
+    
     emit exportProgress(0);
-    bool success = writer->write(outputPath, dataset);
+    bool success = runWriter(writer, dataset, outputPath, progress);
     emit exportProgress(100);
     emit exportCompleted(success);
     
     return success;
 }
 
+BackgroundJob* ExportManager::exportDatasetAsync(const Dataset& dataset, const QString& outputPath,
+                                                 const QString& format) {
+    auto* job = new BackgroundJob(tr("Exporting %1").arg(outputPath), this);
+    connect(job, &BackgroundJob::progress, this, [this](int current, int total) {
+        emit exportProgress(total > 0 ? current * 100 / total : 100);
+    });
+    connect(job, &BackgroundJob::finished, this, [this](bool success, const QString& error) {
+        if (!success) {
+            emit exportError(error);
+        }
+        emit exportCompleted(success);
+    });
+    
+    // The writer is set up on the worker, once the export before has
+    // finished with it; this manager waits for the pool before it goes away
+    std::shared_ptr<const Dataset> snapshot = dataset.snapshot();
+    const QString blobStorePath = blobStorePath_;
+    job->start(&exportPool_, [this, snapshot, outputPath, format, blobStorePath](const ProgressCallback& progress,
+                                                                               QString* error) {
+        IDataWriter* writer = prepareWriter(format, blobStorePath);
+        if (!writer) {
+            *error = "No writer available for format: " + format;
+            return false;
+        }
+        const bool ok = runWriter(writer, *snapshot, outputPath, progress);
+        if (!ok) {
+            *error = tr("Failed to write %1").arg(outputPath);
+        }
+        return ok;
+    });
+    return job;
+}
+
+
+bool ExportManager::exportSharded(const Dataset& dataset, const QString& outputPath, const QString& format,
+                                  const ShardOptions& options) {
+    exportPool_.waitForDone();
+    
+    // Shards report from their own threads
+    QMutex percentMutex;
+    int lastPercent = -1;
+    auto progress = [this, &percentMutex, &lastPercent](int current, int total, qint64) {
+        const int percent = total > 0 ? current * 100 / total : 100;
+        QMutexLocker locker(&percentMutex);
+        if (percent != lastPercent) {
+            lastPercent = percent;
+            emit exportProgress(percent);
+        }
+        return true;
+    };
+    
+    emit exportProgress(0);
+    QString error;
+    bool success = writeShards(dataset, outputPath, format, options, blobStorePath_, progress, &error);
+    if (!success) {
+        emit exportError(error);
+    }
+    emit exportProgress(100);
+    emit exportCompleted(success);
+    
+    return success;
+}
+
+BackgroundJob* ExportManager::exportShardedAsync(const Dataset& dataset, const QString& outputPath,
+                                                 const QString& format, const ShardOptions& options) {
+    auto* job = new BackgroundJob(tr("Exporting shards of %1").arg(outputPath), this);
+    connect(job, &BackgroundJob::progress, this, [this](int current, int total) {
+        emit exportProgress(total > 0 ? current * 100 / total : 100);
+    });
+    connect(job, &BackgroundJob::finished, this, [this](bool success, const QString& error) {
+        if (!success) {
+            emit exportError(error);
+        }
+        emit exportCompleted(success);
+    });
+    
+    std::shared_ptr<const Dataset> snapshot = dataset.snapshot();
+    const QString blobStorePath = blobStorePath_;
+    job->start(&exportPool_, [this, snapshot, outputPath, format, options, blobStorePath](
+                                 const ProgressCallback& progress, QString* error) {
+        return writeShards(*snapshot, outputPath, format, options, blobStorePath, progress, error);
+    });
+    return job;
+}
+
+bool ExportManager::streamShard(IDataWriter& writer, const QString& outputPath, const Dataset& dataset,
+                                const QList<ShardItem>& items) {
+    // Items are root samples first, then runs of one subset each; samples
+    // keep their IDs, and one in several lists is written in each of them
+    if (!writer.beginWrite(outputPath, dataset.metadata())) {
+        return false;
+    }
+    
+    const QList<DatasetSubset>& subsets = dataset.subsets();
+    qsizetype i = 0;
+    for (; i < items.size() && items[i].subset < 0; ++i) {
+        if (!writer.writeSample(*items[i].sample)) {
+            writer.abortWrite();
+            return false;
+        }
+    }
+    while (i < items.size()) {
+        // The shard's part of the subset keeps the dataset's rows, so a
+        // sample shared with an earlier subset is still recognized as such
+        const int s = items[i].subset;
+        qsizetype end = i;
+        while (end < items.size() && items[end].subset == s) {
+            ++end;
+        }
+        if (!writer.writeSubset(subsets[s].mid(items[i].index, int(end - i)))) {
+            writer.abortWrite();
+            return false;
+        }
+        i = end;
+    }
+    return writer.endWrite();
+}
+
+bool ExportManager::writeShards(const Dataset& dataset, const QString& outputPath, const QString& format,
+                                const ShardOptions& options, const QString& blobStorePath,
+                                const ProgressCallback& progress, QString* error) const {
+    auto fail = [error](const QString& message) {
+        if (error) *error = message;
+        return false;
+    };
+    
+    IDataWriter* prototype = prepareWriter(format, blobStorePath);
+    if (!prototype) {
+        return fail("No writer available for format: " + format);
+    }
+    if (!prototype->supportsStreaming()) {
+        return fail(tr("Sharded export needs a writer that supports streaming: %1").arg(format));
+    }
+    
+    using Item = ShardItem;
+    struct Shard {
+        QString group;
+        QString subset;             // With perSubset; empty for root samples
+        QList<Item> items;
+        QString path;
+    };
+    
+    // Samples in export order, split into groups (one, or one per subset)
+    const QFileInfo output(outputPath);
+    const QString baseName = output.completeBaseName();
+    const QString extension = output.suffix().isEmpty() ? prototype->fileExtension() : "." + output.suffix();
+    const QList<DatasetSubset>& subsets = dataset.subsets();
+    
+    // Group names become file name prefixes, so names that only differ by
+    // case or by characters replaced with '_' get a numbered suffix
+    QSet<QString> groupNames;
+    auto uniqueGroupName = [&groupNames](const QString& name) {
+        QString unique = name;
+        for (int n = 2; groupNames.contains(unique.toLower()); ++n) {
+            unique = QString("%1_%2").arg(name).arg(n);
+        }
+        groupNames.insert(unique.toLower());
+        return unique;
+    };
+    
+    QList<Shard> groups(1);
+    groups[0].group = uniqueGroupName(baseName);
+    const SampleView rootSamples = dataset.samples();
+    for (int i = 0; i < rootSamples.size(); ++i) {
+        groups[0].items.append({&rootSamples[i], -1, i});
+    }
+    for (int s = 0; s < subsets.size(); ++s) {
+        if (options.perSubset) {
+            Shard group;
+            group.group = uniqueGroupName(
+                QString(subsets[s].name()).replace(QRegularExpression("[^A-Za-z0-9._-]"), "_"));
+            group.subset = subsets[s].name();
+            groups.append(group);
+        }
+        const SampleView subsetSamples = subsets[s].samples();
+        for (int i = 0; i < subsetSamples.size(); ++i) {
+            groups.last().items.append({&subsetSamples[i], s, i});
+        }
+    }
+    
+    // Each group is cut into shardCount equal parts, or wherever the
+    // estimated size reaches targetBytes
+    QList<Shard> shards;
+    int totalItems = 0;
+    for (const Shard& group : groups) {
+        const QList<Item>& items = group.items;
+        if (items.isEmpty()) {
+            continue;
+        }
+        totalItems += items.size();
+        
+        const int first = shards.size();
+        if (options.targetBytes > 0) {
+            qint64 bytes = 0;
+            for (const Item& item : items) {
+                if (shards.size() == first || bytes >= options.targetBytes) {
+                    shards.append(Shard{group.group, group.subset, {}, QString()});
+                    bytes = 0;
+                }
+                shards.last().items.append(item);
+                bytes += item.sample->dataSize();
+            }
+        } else {
+            const qint64 count = qBound(1, options.shardCount, int(items.size()));
+            for (qint64 i = 0; i < count; ++i) {
+                const qint64 begin = i * items.size() / count;
+                const qint64 end = (i + 1) * items.size() / count;
+                shards.append(Shard{group.group, group.subset, items.mid(begin, end - begin), QString()});
+            }
+        }
+        
+        const int count = shards.size() - first;
+        for (int i = first; i < shards.size(); ++i) {
+            shards[i].path = output.dir().filePath(QString("%1-%2-of-%3%4")
+                .arg(group.group)
+                .arg(i - first, 5, 10, QChar('0'))
+                .arg(count, 5, 10, QChar('0'))
+                .arg(extension));
+        }
+    }
+    
+    auto removeShards = [&shards]() {
+        for (const Shard& shard : shards) {
+            QFile::remove(shard.path);
+        }
+    };
+    
+    // Every shard gets a writer of its own; writers that cannot be cloned
+    // write one shard after another
+    std::unique_ptr<IDataWriter> firstWriter = prototype->clone();
+    const bool parallel = firstWriter != nullptr;
+    QThreadPool pool;
+    pool.setMaxThreadCount(!parallel ? 1 : options.maxThreads > 0 ? options.maxThreads : QThread::idealThreadCount());
+    
+    QMutex mutex;                   // Guards the totals below and progress
+    std::atomic<bool> failed{false};
+    QString firstError;
+    int done = 0;
+    qint64 bytesDone = 0;
+    std::vector<int> shardDone(shards.size(), 0);
+    std::vector<qint64> shardBytes(shards.size(), 0);
+    
+    for (int i = 0; i < shards.size(); ++i) {
+        pool.start([&, i]() {
+            if (failed) {
+                return;
+            }
+            
+            const Shard& shard = shards[i];
+            const int shardItems = shard.items.size();
+            auto shardProgress = [&, i](int current, int, qint64 bytes) {
+                QMutexLocker locker(&mutex);
+                done += current - shardDone[i];
+                shardDone[i] = current;
+                bytesDone += bytes - shardBytes[i];
+                shardBytes[i] = bytes;
+                if (failed) {
+                    return false;
+                }
+                if (progress && !progress(done, totalItems, bytesDone)) {
+                    failed = true;
+                    return false;
+                }
+                return true;
+            };
+            
+            std::unique_ptr<IDataWriter> writer;
+            if (parallel) {
+                writer = i == 0 ? std::move(firstWriter) : prototype->clone();
+            }
+            IDataWriter* shardWriter = writer ? writer.get() : prototype;
+            shardWriter->setProgressCallback([&shardProgress, shardItems](int current, int, qint64 bytes) {
+                return shardProgress(current, shardItems, bytes);
+            });
+            const bool ok = streamShard(*shardWriter, shard.path, dataset, shard.items);
+            shardWriter->setProgressCallback(nullptr);
+            if (!ok) {
+                QMutexLocker locker(&mutex);
+                if (!failed.exchange(true)) {
+                    firstError = tr("Failed to write %1").arg(shard.path);
+                }
+            }
+        });
+    }
+    pool.waitForDone();
+    
+    if (failed) {
+        removeShards();
+        return fail(firstError.isEmpty() ? tr("Cancelled") : firstError);
+    }
+    
+    // Manifest listing the shards in order
+    QVariantList shardList;
+    for (const Shard& shard : shards) {
+        QVariantMap entry;
+        entry["path"] = QFileInfo(shard.path).fileName();
+        if (options.perSubset) entry["subset"] = shard.subset;
+        entry["samples"] = shard.items.size();
+        entry["bytes"] = QFileInfo(shard.path).size();
+        shardList.append(entry);
+    }
+    QVariantMap manifest;
+    manifest["format"] = prototype->formatName();
+    manifest["metadata"] = dataset.metadata().toVariantMap();
+    manifest["samples"] = totalItems;
+    manifest["shards"] = shardList;
+    
+    const QByteArray json = QJsonDocument::fromVariant(manifest).toJson(QJsonDocument::Indented);
+    QSaveFile file(output.dir().filePath(baseName + ".manifest.json"));
+    if (!file.open(QIODevice::WriteOnly) || file.write(json) != json.size() || !file.commit()) {
+        removeShards();
+        return fail(tr("Failed to write the shard manifest: %1").arg(file.errorString()));
+    }
+    return true;
+}
+
 }
@@ -1,24 +1,77 @@
 #pragma once
 #include "core/Dataset.h"
+#include "BackgroundJob.h"
 #include <QObject>
+#include <QThreadPool>
 
 namespace DatasetCreator {
 
+class IDataWriter;
 class PluginManager;
 
 class ExportManager : public QObject {
     Q_OBJECT
 public:
     explicit ExportManager(PluginManager* pluginManager, QObject* parent = nullptr);
+    ~ExportManager();
+    
+    // Writers that support streaming are fed one sample at a time, so
+    // memory use does not depend on the dataset size
     bool exportDataset(const Dataset& dataset, const QString& outputPath, const QString& format);
     
+    // Exports a snapshot of the dataset on a worker thread, one export at a
+    // time; the dataset stays editable meanwhile. Cancelling the job leaves
+    // no output file. The job is owned by this manager.
+    BackgroundJob* exportDatasetAsync(const Dataset& dataset, const QString& outputPath, const QString& format);
+    
+    struct ShardOptions {
+        int shardCount = 1;         // Shards per group
+        qint64 targetBytes = 0;     // If set, shard by estimated payload bytes instead
+        bool perSubset = false;     // Root samples and each subset get shards of their own
+        int maxThreads = 0;         // Shards written at once; 0: one per core
+    };
+    
+    // Writes the dataset as <name>-00000-of-00064<ext> files next to
+    // outputPath, on several threads, plus <name>.manifest.json listing
+    // them. <name> is the output's base name, or the subset name with
+    // perSubset; names that would clash get a numbered suffix. Samples are
+    // streamed to the writer with their IDs unchanged, so the format's
+    // writer must support streaming. Shards already written are removed if
+    // the export fails.
+    bool exportSharded(const Dataset& dataset, const QString& outputPath, const QString& format,
+                       const ShardOptions& options);
+    BackgroundJob* exportShardedAsync(const Dataset& dataset, const QString& outputPath, const QString& format,
+                                      const ShardOptions& options);
+    
+    // Writers that support it put payloads into this store directory and
+    // refer to them by hash (see BlobStore); empty embeds them
+    void setBlobStorePath(const QString& path) { blobStorePath_ = path; }
+    QString blobStorePath() const { return blobStorePath_; }
+    
 signals:
     void exportProgress(int percent);
     void exportCompleted(bool success);
     void exportError(const QString& error);
     
 private:
+    IDataWriter* prepareWriter(const QString& format, const QString& blobStorePath) const;
+    static bool runWriter(IDataWriter* writer, const Dataset& dataset, const QString& outputPath,
+                          const ProgressCallback& progress);
+    
+    struct ShardItem {
+        const DatasetSample* sample;
+        int subset;                 // Index into the dataset's subsets, -1: root
+        int index;                  // Position in the root or subset list
+    };
+    static bool streamShard(IDataWriter& writer, const QString& outputPath, const Dataset& dataset,
+                            const QList<ShardItem>& items);
+    bool writeShards(const Dataset& dataset, const QString& outputPath, const QString& format,
+                     const ShardOptions& options, const QString& blobStorePath,
+                     const ProgressCallback& progress, QString* error) const;
+    
     PluginManager* pluginManager_;
+    QString blobStorePath_;
+    QThreadPool exportPool_;   // Writers are not reentrant
 };
 
 }
@@ -1,10 +1,43 @@
 #include "ImportManager.h"
 #include "plugins/PluginManager.h"
+#include <QFileInfo>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSemaphore>
+#include <QThread>
+#include <atomic>
+#include <utility>
 
 namespace DatasetCreator {
 
+struct ImportManager::BatchJob {
+    QStringList files;
+    int chunkRows = 256;     // Streamed rows handed over per call
+    int chunkCredits = 4;    // Chunks a streaming file may have waiting for delivery
+    std::atomic<bool> cancelled{false};
+    QMutex serialReadMutex;  // Guards readers that are not reentrant
+};
+
 ImportManager::ImportManager(PluginManager* pluginManager, QObject* parent)
-    : QObject(parent), pluginManager_(pluginManager) {}
+    : QObject(parent), pluginManager_(pluginManager), orderedDelivery_(false), batchSize_(256)
+{
+    maxInFlight_ = qMax(4, pool_.maxThreadCount() * 4);
+
+    flushTimer_.setSingleShot(true);
+    flushTimer_.setInterval(100);
+    connect(&flushTimer_, &QTimer::timeout, this, &ImportManager::flushDelivered);
+}
+
+ImportManager::~ImportManager() {
+    if (job_) {
+        job_->cancelled = true;
+    }
+    pool_.waitForDone();
+}
+
+void ImportManager::setMaxThreads(int count) {
+    pool_.setMaxThreadCount(count > 0 ? count : QThread::idealThreadCount());
+}
 
 void ImportManager::importFile(const QString& filePath) {
     IDataReader* reader = pluginManager_->getReaderForFile(filePath);
@@ -12,19 +45,312 @@ void ImportManager::importFile(const QString& filePath) {
         emit importError("No reader available for file: " + filePath);
         return;
     }
-    
-    DatasetSample sample = reader->read(filePath);
-    emit sampleImported(sample);
+
+    if (reader->providesSubsets()) {
+        Dataset dataset;
+        if (!IDataReader::streamInto(*reader, filePath, dataset)) {
+            emit importError("Could not read file: " + filePath);
+            return;
+        }
+        dataset.metadata() = reader->datasetMetadata();
+        emit datasetImported(dataset);
+    } else if (reader->supportsStreaming() && reader->beginRead(filePath)) {
+        while (!reader->atEnd()) {
+            emit sampleImported(reader->readNext());
+        }
+        reader->endRead();
+    } else {
+        emit sampleImported(reader->read(filePath));
+    }
     emit importCompleted();
 }
 
 void ImportManager::importBatch(const QStringList& files) {
-    int total = files.size();
-    int current = 0;
-    
-    for (const QString& file : files) {
-        importFile(file);
-        emit importProgress(++current, total);
+    if (job_) {
+        emit importError(tr("An import is already running"));
+        return;
+    }
+
+    job_ = std::make_shared<BatchJob>();
+    job_->files = files;
+    job_->chunkRows = batchSize_;
+    nextToSubmit_ = 0;
+    nextToDeliver_ = 0;
+    inFlight_ = 0;
+    finished_ = 0;
+    bytesRead_ = 0;
+    pending_.clear();
+    streamed_.clear();
+    streamCredits_.clear();
+    datasets_.clear();
+    delivered_.clear();
+    timer_.start();
+
+    if (files.isEmpty()) {
+        finishBatch();
+        return;
+    }
+
+    submitPending();
+}
+
+void ImportManager::cancel() {
+    if (!job_) return;
+
+    job_->cancelled = true;
+    pending_.clear();
+    streamed_.clear();
+    streamCredits_.clear();
+    datasets_.clear();
+    // Receivers may reset their dataset straight after cancelling, so
+    // nothing read for this batch may reach them any more
+    flushTimer_.stop();
+    delivered_.clear();
+    if (inFlight_ == 0) {
+        finishBatch();
+    }
+}
+
+void ImportManager::submitPending() {
+    const int total = job_->files.size();
+
+    while (job_ && !job_->cancelled && nextToSubmit_ < total && inFlight_ < maxInFlight_) {
+        // In ordered mode the window also bounds the reorder buffer
+        if (orderedDelivery_ && nextToSubmit_ >= nextToDeliver_ + maxInFlight_) {
+            break;
+        }
+
+        std::shared_ptr<BatchJob> job = job_;
+        const int index = nextToSubmit_++;
+        const QString& filePath = job->files.at(index);
+        IDataReader* reader = pluginManager_->getReaderForFile(filePath);
+
+        if (!reader) {
+            emit importError("No reader available for file: " + filePath);
+            ++finished_;
+            deliver(index, {});
+            if (job != job_) return;
+            continue;
+        }
+
+        ++inFlight_;
+        pool_.start([this, job, index, reader]() {
+            readInWorker(job, index, reader);
+        });
+    }
+
+    if (job_ && !job_->cancelled && finished_ == total) {
+        finishBatch();
+    }
+}
+
+void ImportManager::readInWorker(std::shared_ptr<BatchJob> job, int index, IDataReader* reader) {
+    QList<DatasetSample> samples;
+    std::shared_ptr<Dataset> dataset;
+    qint64 bytes = 0;
+    bool ok = false;
+
+    if (!job->cancelled) {
+        const QString& filePath = job->files.at(index);
+        bytes = QFileInfo(filePath).size();
+
+        if (reader->providesSubsets()) {
+            dataset = readDatasetInWorker(job, index, reader);
+            ok = dataset != nullptr;
+        } else if (reader->supportsStreaming() && streamInWorker(job, index, reader)) {
+            // Rows were handed over while reading
+            ok = true;
+        } else {
+            // Readers return an empty sample for a file they cannot read
+            QMutexLocker locker(reader->isReentrant() ? nullptr : &job->serialReadMutex);
+            const DatasetSample sample = reader->read(filePath);
+            ok = !sample.isEmpty();
+            if (ok) {
+                samples.append(sample);
+            }
+        }
+    }
+
+    QMetaObject::invokeMethod(this, [this, job, index, samples, dataset, bytes, ok]() {
+        onFileRead(job, index, samples, dataset, bytes, ok);
+    }, Qt::QueuedConnection);
+}
+
+bool ImportManager::streamInWorker(const std::shared_ptr<BatchJob>& job, int index, IDataReader* reader) {
+    // A clone keeps the stream's state out of the shared reader
+    std::unique_ptr<IDataReader> stream = reader->clone();
+    if (!stream || !stream->beginRead(job->files.at(index))) {
+        return false;
+    }
+
+    // Wait while the file has chunkCredits chunks queued or buffered on the
+    // GUI thread; the credit comes back once the chunk has been handed over
+    auto credits = std::make_shared<QSemaphore>(job->chunkCredits);
+    auto post = [this, job, index, credits](QList<DatasetSample> rows) {
+        while (!credits->tryAcquire(1, 50)) {
+            if (job->cancelled) return;
+        }
+        std::shared_ptr<void> credit(nullptr, [credits](void*) { credits->release(); });
+        QMetaObject::invokeMethod(this, [this, job, index, rows, credit]() {
+            onRowsRead(job, index, rows, credit);
+        }, Qt::QueuedConnection);
+    };
+
+    QList<DatasetSample> rows;
+    while (!stream->atEnd() && !job->cancelled) {
+        rows.append(stream->readNext());
+        if (rows.size() >= job->chunkRows) {
+            post(std::exchange(rows, {}));
+        }
+    }
+    if (!rows.isEmpty() && !job->cancelled) {
+        post(rows);
+    }
+    stream->endRead();
+    return true;
+}
+
+std::shared_ptr<Dataset> ImportManager::readDatasetInWorker(const std::shared_ptr<BatchJob>& job, int index,
+                                                            IDataReader* reader) {
+    // Read whole: a sample shared by subsets may come up again anywhere in the file
+    std::unique_ptr<IDataReader> stream = reader->clone();
+    auto dataset = std::make_shared<Dataset>();
+    auto progress = [&job](int, int, qint64) { return !job->cancelled; };
+    if (!stream || !IDataReader::streamInto(*stream, job->files.at(index), *dataset, progress)) {
+        return nullptr;
+    }
+    dataset->metadata() = stream->datasetMetadata();
+    return dataset;
+}
+
+void ImportManager::onRowsRead(const std::shared_ptr<BatchJob>& job, int index,
+                               const QList<DatasetSample>& samples, const std::shared_ptr<void>& credit) {
+    if (job != job_ || job_->cancelled) return;
+
+    // In ordered mode only the file being delivered may pass the others;
+    // buffered rows keep their credit so the reader stays bounded
+    if (orderedDelivery_ && index != nextToDeliver_) {
+        streamed_[index].append(samples);
+        streamCredits_[index].append(credit);
+        return;
+    }
+    for (const DatasetSample& sample : samples) {
+        queueForDelivery(sample);
+        if (!job_ || job_->cancelled) return;
+    }
+}
+
+void ImportManager::onFileRead(const std::shared_ptr<BatchJob>& job, int index, const QList<DatasetSample>& samples,
+                               const std::shared_ptr<Dataset>& dataset, qint64 bytes, bool ok) {
+    if (job != job_) return;  // Result of an earlier, cancelled batch
+
+    --inFlight_;
+    ++finished_;
+    bytesRead_ += bytes;
+
+    if (job_->cancelled) {
+        if (inFlight_ == 0) {
+            finishBatch();
+        }
+        return;
+    }
+
+    if (!ok) {
+        emit importError("Could not read file: " + job_->files.at(index));
+        if (job != job_ || job_->cancelled) return;  // A receiver cancelled
+    }
+    deliver(index, samples, dataset);
+    if (job != job_) return;  // A receiver cancelled and the batch already finished
+
+    const double seconds = qMax<qint64>(1, timer_.elapsed()) / 1000.0;
+    emit importProgress(finished_, job_->files.size(),
+                        finished_ / seconds,
+                        bytesRead_ / (1024.0 * 1024.0) / seconds);
+
+    if (finished_ == job_->files.size()) {
+        finishBatch();
+    } else {
+        submitPending();
+    }
+}
+
+void ImportManager::deliver(int index, const QList<DatasetSample>& samples,
+                            const std::shared_ptr<Dataset>& dataset) {
+    auto queueAll = [this](const QList<DatasetSample>& ready) {
+        for (const DatasetSample& sample : ready) {
+            queueForDelivery(sample);
+            if (!job_ || job_->cancelled) return false;
+        }
+        return true;
+    };
+    // After the samples queued before it, which receivers may cancel on
+    auto handOver = [this](const std::shared_ptr<Dataset>& ready) {
+        if (!ready) return true;
+        flushDelivered();
+        if (!job_ || job_->cancelled) return false;
+        emit datasetImported(*ready);
+        return job_ && !job_->cancelled;
+    };
+
+    if (!orderedDelivery_) {
+        if (queueAll(samples)) {
+            handOver(dataset);
+        }
+        return;
+    }
+
+    pending_.insert(index, streamed_.take(index) + samples);
+    streamCredits_.remove(index);
+    if (dataset) {
+        datasets_.insert(index, dataset);
+    }
+
+    auto it = pending_.find(nextToDeliver_);
+    while (it != pending_.end()) {
+        const QList<DatasetSample> ready = it.value();
+        const std::shared_ptr<Dataset> readyDataset = datasets_.take(nextToDeliver_);
+        pending_.erase(it);
+        ++nextToDeliver_;
+        if (!queueAll(ready) || !handOver(readyDataset)) return;
+        // Rows the next file has streamed so far follow straight away
+        streamCredits_.remove(nextToDeliver_);
+        if (!queueAll(streamed_.take(nextToDeliver_))) return;
+        it = pending_.find(nextToDeliver_);
+    }
+}
+
+void ImportManager::queueForDelivery(const DatasetSample& sample) {
+    delivered_.append(sample);
+
+    if (delivered_.size() >= batchSize_) {
+        flushDelivered();
+    } else if (!flushTimer_.isActive()) {
+        flushTimer_.start();
+    }
+}
+
+void ImportManager::flushDelivered() {
+    flushTimer_.stop();
+    if (delivered_.isEmpty()) return;
+
+    QList<DatasetSample> batch;
+    batch.swap(delivered_);
+    emit samplesImported(batch);
+}
+
+void ImportManager::finishBatch() {
+    const bool cancelled = job_ && job_->cancelled;
+    job_.reset();
+    pending_.clear();
+    streamed_.clear();
+    streamCredits_.clear();
+    datasets_.clear();
+
+    if (cancelled) {
+        emit importCancelled();
+    } else {
+        flushDelivered();
+        emit importCompleted();
     }
 }
 
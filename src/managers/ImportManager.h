@@ -1,26 +1,111 @@
 #pragma once
 #include "core/Dataset.h"
 #include <QObject>
+#include <QThreadPool>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QHash>
+#include <memory>
 
 namespace DatasetCreator {
 
 class PluginManager;
+class IDataReader;
 
+/**
+ * @brief Imports files into DatasetSamples using the registered readers
+ *
+ * importFile() reads a single file synchronously. importBatch() runs the
+ * readers on a worker pool: at most maxInFlight() files are being decoded
+ * or waiting for delivery at any time, results are delivered on the
+ * thread that owns the manager, and the batch can be stopped with cancel().
+ * Batch results are coalesced into samplesImported() signals, flushed
+ * when batchSize() samples are queued or flushInterval() ms have passed.
+ * Files whose reader streams (one sample per row, say) are read through a
+ * clone of the reader and handed over batchSize() samples at a time; the
+ * reader waits while a few of its chunks are still queued or, in ordered
+ * mode, held back behind earlier files.
+ * Files whose reader provides subsets are read whole into a Dataset with
+ * IDataReader::streamInto(), so that samples shared by subsets stay
+ * shared, and handed over with datasetImported() in their turn.
+ */
 class ImportManager : public QObject {
     Q_OBJECT
 public:
     explicit ImportManager(PluginManager* pluginManager, QObject* parent = nullptr);
+    ~ImportManager();
+    
     void importFile(const QString& filePath);
     void importBatch(const QStringList& files);
     
+    /**
+     * @brief Stop the running batch
+     *
+     * Files already decoding and samples not yet flushed are discarded, so
+     * no samplesImported() for this batch follows the call.
+     */
+    void cancel();
+    bool isImporting() const { return job_ != nullptr; }
+    
+    // Pipeline configuration (applies to the next importBatch)
+    void setMaxThreads(int count);
+    int maxThreads() const { return pool_.maxThreadCount(); }
+    void setMaxInFlight(int count) { maxInFlight_ = qMax(1, count); }
+    int maxInFlight() const { return maxInFlight_; }
+    void setOrderedDelivery(bool ordered) { orderedDelivery_ = ordered; }
+    bool orderedDelivery() const { return orderedDelivery_; }
+    void setBatchSize(int count) { batchSize_ = qMax(1, count); }
+    int batchSize() const { return batchSize_; }
+    void setFlushInterval(int msec) { flushTimer_.setInterval(msec); }
+    int flushInterval() const { return flushTimer_.interval(); }
+
 signals:
-    void importProgress(int current, int total);
+    void importProgress(int current, int total, double filesPerSecond, double megabytesPerSecond);
     void sampleImported(const DatasetSample& sample);
+    void samplesImported(const QList<DatasetSample>& samples);
+    void datasetImported(const Dataset& dataset);   // One file's samples and subsets, with its metadata
     void importCompleted();
+    void importCancelled();
     void importError(const QString& error);
-    
+
 private:
+    struct BatchJob;
+    
+    void submitPending();
+    void readInWorker(std::shared_ptr<BatchJob> job, int index, IDataReader* reader);
+    bool streamInWorker(const std::shared_ptr<BatchJob>& job, int index, IDataReader* reader);
+    std::shared_ptr<Dataset> readDatasetInWorker(const std::shared_ptr<BatchJob>& job, int index,
+                                                 IDataReader* reader);
+    void onRowsRead(const std::shared_ptr<BatchJob>& job, int index, const QList<DatasetSample>& samples,
+                    const std::shared_ptr<void>& credit);
+    void onFileRead(const std::shared_ptr<BatchJob>& job, int index, const QList<DatasetSample>& samples,
+                    const std::shared_ptr<Dataset>& dataset, qint64 bytes, bool ok);
+    void deliver(int index, const QList<DatasetSample>& samples,
+                 const std::shared_ptr<Dataset>& dataset = nullptr);
+    void queueForDelivery(const DatasetSample& sample);
+    void flushDelivered();
+    void finishBatch();
+    
     PluginManager* pluginManager_;
+    QThreadPool pool_;
+    int maxInFlight_;
+    bool orderedDelivery_;
+    int batchSize_;
+    QTimer flushTimer_;
+    
+    // State of the running batch (GUI thread only)
+    std::shared_ptr<BatchJob> job_;
+    int nextToSubmit_ = 0;
+    int nextToDeliver_ = 0;
+    int inFlight_ = 0;
+    int finished_ = 0;
+    qint64 bytesRead_ = 0;
+    QHash<int, QList<DatasetSample>> pending_;    // Ordered mode reorder buffer of finished files
+    QHash<int, QList<DatasetSample>> streamed_;   // Ordered mode rows of files still streaming
+    QHash<int, QList<std::shared_ptr<void>>> streamCredits_;  // Released as streamed_ is handed over
+    QHash<int, std::shared_ptr<Dataset>> datasets_;  // Ordered mode files read with their subsets
+    QList<DatasetSample> delivered_;                     // Not yet flushed to receivers
+    QElapsedTimer timer_;
 };
 
 }
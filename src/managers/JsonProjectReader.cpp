@@ -0,0 +1,226 @@
+#include "JsonProjectReader.h"
+#include "DecodeQueue.h"
+#include <QFile>
+#include <QJsonDocument>
+
+namespace DatasetCreator {
+
+qint64 JsonProjectReader::skipWhitespace(const char* data, qint64 size, qint64 pos) {
+    while (pos < size && (data[pos] == ' ' || data[pos] == '\n' || data[pos] == '\r' || data[pos] == '\t')) {
+        ++pos;
+    }
+    return pos;
+}
+
+qint64 JsonProjectReader::skipString(const char* data, qint64 size, qint64 pos) {
+    // pos is at the opening quote
+    for (++pos; pos < size; ++pos) {
+        if (data[pos] == '\\') {
+            ++pos;
+        } else if (data[pos] == '"') {
+            return pos + 1;
+        }
+    }
+    return -1;
+}
+
+qint64 JsonProjectReader::skipValue(const char* data, qint64 size, qint64 pos) {
+    if (pos >= size) return -1;
+    
+    if (data[pos] == '"') {
+        return skipString(data, size, pos);
+    }
+    
+    if (data[pos] == '{' || data[pos] == '[') {
+        // Containers are matched by depth; brackets inside strings do not count
+        int depth = 0;
+        while (pos < size) {
+            const char c = data[pos];
+            if (c == '"') {
+                pos = skipString(data, size, pos);
+                if (pos < 0) return -1;
+                continue;
+            }
+            if (c == '{' || c == '[') {
+                ++depth;
+            } else if (c == '}' || c == ']') {
+                if (--depth == 0) return pos + 1;
+            }
+            ++pos;
+        }
+        return -1;
+    }
+    
+    // Number, true, false or null
+    const qint64 start = pos;
+    while (pos < size && data[pos] != ',' && data[pos] != '}' && data[pos] != ']' &&
+           data[pos] != ' ' && data[pos] != '\n' && data[pos] != '\r' && data[pos] != '\t') {
+        ++pos;
+    }
+    return pos > start ? pos : -1;
+}
+
+qint64 JsonProjectReader::scanObject(const char* data, qint64 size, qint64 pos, const MemberFn& member) {
+    pos = skipWhitespace(data, size, pos);
+    if (pos >= size || data[pos] != '{') return -1;
+    pos = skipWhitespace(data, size, pos + 1);
+    if (pos < size && data[pos] == '}') return pos + 1;
+    
+    while (pos < size) {
+        if (data[pos] != '"') return -1;
+        const qint64 keyEnd = skipString(data, size, pos);
+        if (keyEnd < 0) return -1;
+        const QByteArray key = QByteArray::fromRawData(data + pos + 1, keyEnd - pos - 2);
+        
+        pos = skipWhitespace(data, size, keyEnd);
+        if (pos >= size || data[pos] != ':') return -1;
+        pos = member(key, skipWhitespace(data, size, pos + 1));
+        if (pos < 0) return -1;
+        
+        pos = skipWhitespace(data, size, pos);
+        if (pos >= size) return -1;
+        if (data[pos] == '}') return pos + 1;
+        if (data[pos] != ',') return -1;
+        pos = skipWhitespace(data, size, pos + 1);
+    }
+    return -1;
+}
+
+qint64 JsonProjectReader::scanArray(const char* data, qint64 size, qint64 pos, const ElementFn& element) {
+    pos = skipWhitespace(data, size, pos);
+    if (pos >= size || data[pos] != '[') return -1;
+    pos = skipWhitespace(data, size, pos + 1);
+    if (pos < size && data[pos] == ']') return pos + 1;
+    
+    while (pos < size) {
+        pos = element(pos);
+        if (pos < 0) return -1;
+        
+        pos = skipWhitespace(data, size, pos);
+        if (pos >= size) return -1;
+        if (data[pos] == ']') return pos + 1;
+        if (data[pos] != ',') return -1;
+        pos = skipWhitespace(data, size, pos + 1);
+    }
+    return -1;
+}
+
+QJsonObject JsonProjectReader::parseObject(const char* data, const Span& span) {
+    // Parses in place; the bytes are not copied out of the mapping
+    const QByteArray bytes = QByteArray::fromRawData(data + span.offset, span.length);
+    return QJsonDocument::fromJson(bytes).object();
+}
+
+bool JsonProjectReader::read(const QString& filePath, Dataset& dataset,
+                             const ProgressCallback& progress, QString* error) {
+    auto fail = [&](const QString& message) {
+        if (error) *error = message;
+        return false;
+    };
+    
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return fail(tr("Failed to open file for reading: %1").arg(file.errorString()));
+    }
+    
+    // Map the file; fall back to reading it if mapping is not possible
+    const qint64 size = file.size();
+    QByteArray buffer;
+    const char* data = size > 0 ? reinterpret_cast<const char*>(file.map(0, size)) : nullptr;
+    if (!data) {
+        buffer = file.readAll();
+        data = buffer.constData();
+    }
+    
+    // Index pass: record the extent of every sample and metadata object
+    Span metadata;
+    QList<Span> subsetMetadata;
+    QList<Span> samples;
+    
+    auto scanSamples = [&](qint64 pos, int list) {
+        return scanArray(data, size, pos, [&](qint64 element) {
+            const qint64 end = skipValue(data, size, element);
+            if (end > 0) samples.append({element, end - element, list});
+            return end;
+        });
+    };
+    
+    auto scanSubset = [&](qint64 pos) {
+        const int list = subsetMetadata.size();
+        subsetMetadata.append(Span{0, 0, list});
+        return scanObject(data, size, pos, [&](const QByteArray& key, qint64 value) {
+            if (key == "samples") {
+                return scanSamples(value, list);
+            }
+            const qint64 end = skipValue(data, size, value);
+            if (key == "metadata" && end > 0) {
+                subsetMetadata[list] = Span{value, end - value, list};
+            }
+            return end;
+        });
+    };
+    
+    const qint64 end = scanObject(data, size, 0, [&](const QByteArray& key, qint64 value) -> qint64 {
+        if (key == "samples") {
+            return scanSamples(value, -1);
+        }
+        if (key == "subsets") {
+            return scanArray(data, size, value, scanSubset);
+        }
+        const qint64 valueEnd = skipValue(data, size, value);
+        if (key == "metadata" && valueEnd > 0) {
+            metadata = Span{value, valueEnd - value, -1};
+        }
+        return valueEnd;
+    });
+    if (end < 0) {
+        return fail(tr("Failed to parse JSON: malformed project file"));
+    }
+    
+    Dataset loaded;
+    QStringList subsetNames;
+    for (const Span& span : subsetMetadata) {
+        DatasetSubset subset;
+        subset.metadata() = SubsetMetadata::fromVariantMap(parseObject(data, span).toVariantMap());
+        subsetNames.append(subset.name());
+        if (!loaded.getSubset(subset.name())) {
+            loaded.addSubset(subset);
+        }
+    }
+    
+    // Decode pass: objects are parsed and decoded on worker threads
+    auto decode = [&](int i) {
+        Entry entry;
+        const QVariantMap map = parseObject(data, samples[i]).toVariantMap();
+        if (map.contains("ref")) {
+            entry.ref = map.value("ref").toString();
+        } else {
+            entry.sample = DatasetSample::fromVariantMap(map);
+        }
+        return entry;
+    };
+    
+    auto consume = [&](int i, Entry& entry) {
+        const int list = samples[i].list;
+        const QString subsetName = list < 0 ? QString() : subsetNames[list];
+        if (!entry.ref.isEmpty()) {
+            loaded.addSampleToSubset(entry.ref, subsetName);
+        } else {
+            loaded.addSample(entry.sample, subsetName);
+        }
+        return !progress || progress(i + 1, samples.size(), samples[i].offset + samples[i].length);
+    };
+    
+    DecodeQueue<Entry> queue;
+    if (!queue.run(samples.size(), decode, consume)) {
+        return fail(tr("Cancelled"));
+    }
+    
+    // Set last so loading does not bump the modification time
+    loaded.metadata() = DatasetMetadata::fromVariantMap(parseObject(data, metadata).toVariantMap());
+    
+    dataset = std::move(loaded);
+    return true;
+}
+
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include "core/Dataset.h"
+#include "core/Progress.h"
+#include <QCoreApplication>
+#include <QJsonObject>
+#include <QString>
+#include <functional>
+
+namespace DatasetCreator {
+
+/**
+ * @brief Streaming reader for version 1 (JSON) project files
+ *
+ * The file is mapped and scanned once to find where the dataset metadata,
+ * each subset's metadata and each sample object start and end; no DOM of
+ * the whole document is built. Sample objects are then parsed and decoded
+ * (base64, PNG, timestamps) on a thread pool and added to the dataset in
+ * file order, so only a bounded window of samples is in flight at a time.
+ */
+class JsonProjectReader {
+    Q_DECLARE_TR_FUNCTIONS(JsonProjectReader)
+public:
+    /**
+     * @brief Read a JSON project file
+     * @return false with error set if the file is not a valid JSON project
+     *         or progress cancelled the read
+     */
+    static bool read(const QString& filePath, Dataset& dataset,
+                     const ProgressCallback& progress, QString* error);
+
+private:
+    struct Span {
+        qint64 offset = 0;
+        qint64 length = 0;
+        int list = -1;      // -1 for root samples, else subset index
+    };
+    
+    struct Entry {
+        DatasetSample sample;
+        QString ref;        // Set for {"ref": id} entries of shared subset members
+    };
+    
+    using MemberFn = std::function<qint64(const QByteArray& key, qint64 pos)>;
+    using ElementFn = std::function<qint64(qint64 pos)>;
+    
+    // Scanner; each returns the position just past what it read, or -1
+    static qint64 skipWhitespace(const char* data, qint64 size, qint64 pos);
+    static qint64 skipString(const char* data, qint64 size, qint64 pos);
+    static qint64 skipValue(const char* data, qint64 size, qint64 pos);
+    static qint64 scanObject(const char* data, qint64 size, qint64 pos, const MemberFn& member);
+    static qint64 scanArray(const char* data, qint64 size, qint64 pos, const ElementFn& element);
+    
+    static QJsonObject parseObject(const char* data, const Span& span);
+};
+
+}
@@ -0,0 +1,746 @@
+#include "ProjectFormat.h"
+#include "DecodeQueue.h"
+#include <QBuffer>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QImageReader>
+#include <QLockFile>
+#include <QRandomGenerator>
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <vector>
+
+namespace DatasetCreator {
+
+bool ProjectFormat::isBinaryProject(const QString& filePath) {
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    return file.read(4) == QByteArray("DSCP", 4);
+}
+
+ProjectFormat::JournalBase ProjectFormat::journalBase(const QString& filePath) {
+    JournalBase base;
+    QFile file(filePath);
+    Header header;
+    if (file.open(QIODevice::ReadOnly) &&
+        file.read(reinterpret_cast<char*>(&header), sizeof(header)) == sizeof(header) &&
+        std::memcmp(header.magic, "DSCP", 4) == 0) {
+        base.id = header.journalId;
+        base.sequence = header.journalSequence;
+    }
+    return base;
+}
+
+bool ProjectFormat::writeBlob(QIODevice* device, const QByteArray& head, const char* data, qint64 size,
+                              quint64_le& offset, quint64_le& blobSize) {
+    // Keep every blob 8-byte aligned so mapped headers can be read in place
+    static const char padding[8] = {};
+    const qint64 misalignment = device->pos() % 8;
+    if (misalignment != 0 && device->write(padding, 8 - misalignment) != 8 - misalignment) {
+        return false;
+    }
+    
+    offset = device->pos();
+    blobSize = head.size() + size;
+    if (!head.isEmpty() && device->write(head) != head.size()) {
+        return false;
+    }
+    return size == 0 || device->write(data, size) == size;
+}
+
+bool ProjectFormat::writeStoredHash(const PayloadTarget& target, const QString& hash, SampleRecord& record) {
+    const QByteArray digest = QByteArray::fromHex(hash.toLatin1());
+    if (target.blobs) target.blobs->insert(hash);
+    record.flags |= StoredPayload;
+    return writeBlob(target.device, QByteArray(), digest.constData(), digest.size(),
+                     record.payloadOffset, record.payloadSize);
+}
+
+bool ProjectFormat::writePayloadBlob(const PayloadTarget& target, const QByteArray& head, const char* data,
+                                     qint64 size, SampleRecord& record) {
+    if (target.store && head.size() + size >= BlobStore::MinBlobSize) {
+        const QString hash = target.store->put(head, data, size);
+        if (!hash.isEmpty()) {
+            return writeStoredHash(target, hash, record);
+        }
+        // The store is not writable; keep the payload inline instead
+    }
+    return writeBlob(target.device, head, data, size, record.payloadOffset, record.payloadSize);
+}
+
+bool ProjectFormat::writePayload(const DatasetSample& sample, const PayloadTarget& target, SampleRecord& record) {
+    record.encoding = static_cast<quint8>(Encoding::None);
+    
+    switch (sample.type()) {
+        case SampleType::Text: {
+            // Text loaded from a blob of this store is still that blob;
+            // other text files may not be UTF-8 and are converted
+            const bool stored = target.store && sample.isFileBacked() &&
+                                !target.store->hashOfPath(sample.source().path).isEmpty();
+            const QString storedHash = stored ? target.store->putSource(sample.source()) : QString();
+            if (!storedHash.isEmpty()) {
+                record.encoding = static_cast<quint8>(Encoding::Utf8);
+                return writeStoredHash(target, storedHash, record);
+            }
+            
+            const Utf8Text text = sample.asUtf8Text();
+            const QByteArrayView utf8 = text.utf8();
+            record.encoding = static_cast<quint8>(Encoding::Utf8);
+            return writePayloadBlob(target, QByteArray(), utf8.data(), utf8.size(), record);
+        }
+        case SampleType::Image: {
+            // Images keep their original compressed bytes, which are copied
+            // as they are; only images without them are stored as pixels.
+            // A store hashes a source file once, and a sample already backed
+            // by one of its blobs is not read at all
+            if (target.store && sample.isLazy()) {
+                const QString hash = target.store->putSource(sample.source());
+                if (!hash.isEmpty()) {
+                    record.encoding = static_cast<quint8>(Encoding::EncodedImage);
+                    return writeStoredHash(target, hash, record);
+                }
+            }
+            
+            const QByteArray encoded = sample.encodedImage();
+            if (!encoded.isEmpty()) {
+                record.encoding = static_cast<quint8>(Encoding::EncodedImage);
+                return writePayloadBlob(target, QByteArray(), encoded.constData(), encoded.size(), record);
+            }
+            
+            const QImage image = sample.asImage();
+            if (image.isNull()) {
+                return true;
+            }
+            
+            ImageBlobHeader header;
+            header.width = image.width();
+            header.height = image.height();
+            header.bytesPerLine = image.bytesPerLine();
+            header.format = static_cast<qint32>(image.format());
+            record.encoding = static_cast<quint8>(Encoding::RawImage);
+            return writePayloadBlob(target, QByteArray(reinterpret_cast<const char*>(&header), sizeof(header)),
+                                    reinterpret_cast<const char*>(image.constBits()), image.sizeInBytes(),
+                                    record);
+        }
+        case SampleType::Audio: {
+            const AudioData audio = sample.asAudio();
+            AudioBlobHeader header;
+            header.sampleRate = audio.format.sampleRate();
+            header.channelCount = audio.format.channelCount();
+            header.sampleFormat = static_cast<qint32>(audio.format.sampleFormat());
+            header.reserved = 0;
+            header.durationMs = audio.durationMs;
+            record.encoding = static_cast<quint8>(Encoding::Pcm);
+            return writePayloadBlob(target, QByteArray(reinterpret_cast<const char*>(&header), sizeof(header)),
+                                    audio.samples.constData(), audio.samples.size(), record);
+        }
+        case SampleType::Binary: {
+            if (target.store && sample.isLazy()) {
+                const QString hash = target.store->putSource(sample.source());
+                if (!hash.isEmpty()) {
+                    record.encoding = static_cast<quint8>(Encoding::Bytes);
+                    return writeStoredHash(target, hash, record);
+                }
+            }
+            
+            const QByteArray data = sample.asBinary();
+            record.encoding = static_cast<quint8>(Encoding::Bytes);
+            return writePayloadBlob(target, QByteArray(), data.constData(), data.size(), record);
+        }
+        case SampleType::Multimodal: {
+            QByteArray blob;
+            QDataStream out(&blob, QIODevice::WriteOnly);
+            out.setVersion(QDataStream::Qt_6_0);
+            out << sample.asMultimodal().toVariantMap();
+            record.encoding = static_cast<quint8>(Encoding::Variant);
+            return writePayloadBlob(target, QByteArray(), blob.constData(), blob.size(), record);
+        }
+    }
+    return true;
+}
+
+bool ProjectFormat::write(const Dataset& dataset, QIODevice* device, const JournalBase& journal,
+                          BlobStore* store, QSet<QString>* blobs,
+                          const ProgressCallback& progress, QString* error) {
+    auto fail = [&](const QString& message) {
+        if (error) *error = message;
+        return false;
+    };
+    
+    // Distinct samples in table order; every membership list is sorted by row,
+    // so it stays sorted by record index too
+    QList<std::pair<SampleRow, const DatasetSample*>> rows;
+    rows.reserve(dataset.totalSampleCount());
+    const SampleView rootView = dataset.samples();
+    for (int i = 0; i < rootView.size(); ++i) {
+        rows.append({rootView.rowAt(i), &rootView[i]});
+    }
+    for (const auto& subset : dataset.subsets()) {
+        const SampleView view = subset.samples();
+        for (int i = 0; i < view.size(); ++i) {
+            rows.append({view.rowAt(i), &view[i]});
+        }
+    }
+    std::sort(rows.begin(), rows.end(),
+              [](const auto& a, const auto& b) { return a.first < b.first; });
+    rows.erase(std::unique(rows.begin(), rows.end(),
+                           [](const auto& a, const auto& b) { return a.first == b.first; }),
+               rows.end());
+    
+    QHash<SampleRow, quint32> recordOf;
+    recordOf.reserve(rows.size());
+    for (int i = 0; i < rows.size(); ++i) {
+        recordOf.insert(rows[i].first, i);
+    }
+    
+    // String table, deduplicated; offset 0 is the empty string
+    QByteArray strings(4, '\0');
+    QHash<QString, quint32> stringOffsets;
+    auto addString = [&](const QString& string) -> quint32 {
+        if (string.isEmpty()) return 0;
+        auto it = stringOffsets.constFind(string);
+        if (it != stringOffsets.constEnd()) return *it;
+        
+        const quint32 offset = strings.size();
+        const QByteArray utf8 = string.toUtf8();
+        const quint32_le length = utf8.size();
+        strings.append(reinterpret_cast<const char*>(&length), sizeof(length));
+        strings.append(utf8);
+        stringOffsets.insert(string, offset);
+        return offset;
+    };
+    
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    if (device->write(reinterpret_cast<const char*>(&header), sizeof(header)) != sizeof(header)) {
+        return fail(device->errorString());
+    }
+    
+    // Payloads and extras, streamed in record order
+    const PayloadTarget target{device, store, blobs};
+    QList<SampleRecord> records(rows.size());
+    for (int i = 0; i < rows.size(); ++i) {
+        const DatasetSample& sample = *rows[i].second;
+        const SampleMetadata& meta = sample.metadata();
+        SampleRecord& record = records[i];
+        std::memset(&record, 0, sizeof(record));
+        
+        record.type = static_cast<quint8>(sample.type());
+        record.idString = addString(meta.id);
+        record.sourceFileString = addString(meta.sourceFile);
+        record.timestamp = meta.timestamp.isValid() ? meta.timestamp.toMSecsSinceEpoch() : InvalidTimestamp;
+        
+        if (!writePayload(sample, target, record)) {
+            return fail(device->errorString());
+        }
+        if (record.encoding == static_cast<quint8>(Encoding::EncodedImage)) {
+            record.formatString = addString(QString::fromLatin1(sample.encodedImageFormat()));
+        }
+        
+        if (!meta.tags.isEmpty() || !meta.labels.isEmpty() ||
+            !meta.attributes.isEmpty() || !meta.annotations.isEmpty()) {
+            QByteArray extras;
+            QDataStream out(&extras, QIODevice::WriteOnly);
+            out.setVersion(QDataStream::Qt_6_0);
+            out << meta.tags << meta.labels << meta.attributes << meta.annotations;
+            if (!writeBlob(device, QByteArray(), extras.constData(), extras.size(),
+                           record.extrasOffset, record.extrasSize)) {
+                return fail(device->errorString());
+            }
+        }
+        
+        if (progress && !progress(i + 1, rows.size(), device->pos())) {
+            return fail(tr("Cancelled"));
+        }
+    }
+    
+    // Sample records
+    quint64_le unused;
+    if (!writeBlob(device, QByteArray(), reinterpret_cast<const char*>(records.constData()),
+                   qint64(records.size()) * sizeof(SampleRecord), header.recordsOffset, unused)) {
+        return fail(device->errorString());
+    }
+    
+    // Membership: root, then each subset
+    QByteArray membership;
+    auto appendRows = [&](const QList<SampleRow>& list) {
+        const quint32_le count = list.size();
+        membership.append(reinterpret_cast<const char*>(&count), sizeof(count));
+        for (SampleRow row : list) {
+            const quint32_le record = recordOf.value(row);
+            membership.append(reinterpret_cast<const char*>(&record), sizeof(record));
+        }
+    };
+    QList<SampleRow> rootRows;
+    rootRows.reserve(rootView.size());
+    for (int i = 0; i < rootView.size(); ++i) {
+        rootRows.append(rootView.rowAt(i));
+    }
+    appendRows(rootRows);
+    for (const auto& subset : dataset.subsets()) {
+        appendRows(subset.rows());
+    }
+    if (!writeBlob(device, QByteArray(), membership.constData(), membership.size(),
+                   header.membershipOffset, header.membershipSize)) {
+        return fail(device->errorString());
+    }
+    
+    if (!writeBlob(device, QByteArray(), strings.constData(), strings.size(),
+                   header.stringsOffset, header.stringsSize)) {
+        return fail(device->errorString());
+    }
+    
+    // Dataset and subset metadata
+    QByteArray metadata;
+    {
+        QDataStream out(&metadata, QIODevice::WriteOnly);
+        out.setVersion(QDataStream::Qt_6_0);
+        QVariantList subsetMetadata;
+        for (const auto& subset : dataset.subsets()) {
+            subsetMetadata.append(subset.metadata().toVariantMap());
+        }
+        out << dataset.metadata().toVariantMap() << subsetMetadata;
+    }
+    if (!writeBlob(device, QByteArray(), metadata.constData(), metadata.size(),
+                   header.metadataOffset, header.metadataSize)) {
+        return fail(device->errorString());
+    }
+    
+    std::memcpy(header.magic, "DSCP", 4);
+    header.version = Version;
+    header.sampleCount = rows.size();
+    header.subsetCount = dataset.subsetCount();
+    header.journalId = journal.id;
+    header.journalSequence = journal.sequence;
+    if (!device->seek(0) ||
+        device->write(reinterpret_cast<const char*>(&header), sizeof(header)) != sizeof(header)) {
+        return fail(device->errorString());
+    }
+    
+    return true;
+}
+
+void ProjectFormat::readPayload(const uchar* data, qint64 size, Encoding encoding, DatasetSample& sample) {
+    const char* bytes = reinterpret_cast<const char*>(data);
+    
+    switch (encoding) {
+        case Encoding::None:
+            break;
+        case Encoding::Utf8:
+            sample.setText(Utf8Text::fromUtf8(QByteArrayView(bytes, size)));
+            break;
+        case Encoding::Bytes:
+            sample.setBinary(QByteArray(bytes, size));
+            break;
+        case Encoding::RawImage: {
+            if (size < qint64(sizeof(ImageBlobHeader))) break;
+            ImageBlobHeader header;
+            std::memcpy(&header, data, sizeof(header));
+            
+            const int format = header.format;
+            if (format <= QImage::Format_Invalid || format >= QImage::NImageFormats ||
+                header.width <= 0 || header.height <= 0 ||
+                qint64(header.bytesPerLine) * header.height > size - qint64(sizeof(header))) {
+                break;
+            }
+            
+            // Wrap the mapped scanlines, then copy out before the file is unmapped
+            QImage view(data + sizeof(header), header.width, header.height, header.bytesPerLine,
+                        static_cast<QImage::Format>(format));
+            sample.setImage(view.copy());
+            break;
+        }
+        case Encoding::EncodedImage: {
+            // Kept encoded; decoded on first access
+            QByteArray encoded(bytes, size);
+            QBuffer buffer(&encoded);
+            buffer.open(QIODevice::ReadOnly);
+            QImageReader reader(&buffer);
+            sample.setEncodedImage(encoded, reader.format(), reader.size());
+            break;
+        }
+        case Encoding::Pcm: {
+            if (size < qint64(sizeof(AudioBlobHeader))) break;
+            AudioBlobHeader header;
+            std::memcpy(&header, data, sizeof(header));
+            
+            AudioData audio;
+            audio.format.setSampleRate(header.sampleRate);
+            audio.format.setChannelCount(header.channelCount);
+            audio.format.setSampleFormat(static_cast<QAudioFormat::SampleFormat>(qint32(header.sampleFormat)));
+            audio.durationMs = header.durationMs;
+            audio.samples = QByteArray(bytes + sizeof(header), size - sizeof(header));
+            sample.setAudio(audio);
+            break;
+        }
+        case Encoding::Variant: {
+            QDataStream in(QByteArray::fromRawData(bytes, size));
+            in.setVersion(QDataStream::Qt_6_0);
+            QVariantMap map;
+            in >> map;
+            sample.setMultimodal(MultimodalData::fromVariantMap(map));
+            break;
+        }
+    }
+}
+
+bool ProjectFormat::setLazyPayload(PayloadSource source, Encoding encoding, const QByteArray& format,
+                                   DatasetSample& sample) {
+    // Text, encoded images and bytes are read on access. Until then an
+    // image's size is estimated from its encoded bytes, and an unknown
+    // format is detected; pixels, PCM and multimodal maps have no lazy
+    // decoder yet
+    switch (encoding) {
+        case Encoding::Utf8:
+            sample.setSource(SampleType::Text, source);
+            return true;
+        case Encoding::EncodedImage:
+            source.format = format;
+            sample.setSource(SampleType::Image, source);
+            return true;
+        case Encoding::Bytes:
+            sample.setSource(SampleType::Binary, source);
+            return true;
+        default:
+            return false;
+    }
+}
+
+void ProjectFormat::readStoredPayload(const QString& blobPath, qint64 blobSize, Encoding encoding,
+                                      const QByteArray& format, DatasetSample& sample) {
+    // The blob is not opened unless the payload has to be decoded now
+    PayloadSource source;
+    source.path = blobPath;
+    source.decodedSize = blobSize;
+    if (setLazyPayload(source, encoding, format, sample)) {
+        return;
+    }
+    
+    QFile file(blobPath);
+    const uchar* data = file.open(QIODevice::ReadOnly) && file.size() > 0 ? file.map(0, file.size()) : nullptr;
+    if (data) {
+        readPayload(data, file.size(), encoding, sample);
+        file.unmap(const_cast<uchar*>(data));
+    }
+}
+
+namespace {
+
+// A hard link to a project snapshot and the lock that marks it in use
+struct SnapshotLink {
+    explicit SnapshotLink(const QString& linkPath) : path(linkPath), lock(linkPath + ".lock") {
+        lock.setStaleLockTime(0);  // Held as long as samples use the link
+    }
+    ~SnapshotLink() {
+        QFile::remove(path);
+        lock.unlock();
+    }
+    
+    QString path;
+    QLockFile lock;
+};
+
+}
+
+std::shared_ptr<const void> ProjectFormat::linkSnapshot(const QString& filePath, QString* linkPath) {
+    // Saves replace the project file rather than writing into it, so a hard
+    // link keeps this version's bytes under a name no save touches. It is
+    // removed with the last sample that refers to it; the lock, taken
+    // first, lets removeStaleLinks() tell a crashed session's links apart
+    const QFileInfo info(filePath);
+    auto link = std::make_shared<SnapshotLink>(info.dir().filePath(QString(".%1.%2.open").arg(
+        info.fileName(), QString::number(QRandomGenerator::global()->generate64(), 16))));
+    if (!link->lock.tryLock(0)) {
+        return nullptr;
+    }
+    
+    std::error_code linkError;
+    std::filesystem::create_hard_link(std::filesystem::path(info.absoluteFilePath().toStdU16String()),
+                                      std::filesystem::path(link->path.toStdU16String()), linkError);
+    if (linkError) {
+        return nullptr;
+    }
+    
+    *linkPath = link->path;
+    return link;
+}
+
+void ProjectFormat::removeStaleLinks(const QString& filePath) {
+    // A link whose lock can be taken belongs to no running session; QLockFile
+    // clears locks left by processes that are gone
+    const QFileInfo info(filePath);
+    const QStringList links = info.dir().entryList({QString(".%1.*.open").arg(info.fileName())},
+                                                   QDir::Files | QDir::Hidden);
+    for (const QString& name : links) {
+        const QString path = info.dir().filePath(name);
+        QLockFile lock(path + ".lock");
+        lock.setStaleLockTime(0);
+        if (lock.tryLock(0)) {
+            QFile::remove(path);
+            lock.unlock();
+        }
+    }
+}
+
+bool ProjectFormat::read(const QString& filePath, Dataset& dataset, const BlobStore* store,
+                         const ProgressCallback& progress, QString* error) {
+    auto fail = [&](const QString& message) {
+        if (error) *error = message;
+        return false;
+    };
+    
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return fail(tr("Failed to open file for reading: %1").arg(file.errorString()));
+    }
+    
+    const qint64 fileSize = file.size();
+    if (fileSize < qint64(sizeof(Header))) {
+        return fail(tr("Invalid project file: too small"));
+    }
+    
+    const uchar* base = file.map(0, fileSize);
+    if (!base) {
+        return fail(tr("Failed to map project file: %1").arg(file.errorString()));
+    }
+    
+    auto inBounds = [fileSize](quint64 offset, quint64 size) {
+        return offset <= quint64(fileSize) && size <= quint64(fileSize) - offset;
+    };
+    
+    Header header;
+    std::memcpy(&header, base, sizeof(header));
+    const quint32 sampleCount = header.sampleCount;
+    const quint32 subsetCount = header.subsetCount;
+    if (std::memcmp(header.magic, "DSCP", 4) != 0 || header.version != Version) {
+        return fail(tr("Unsupported project file version"));
+    }
+    if (header.recordsOffset % 8 != 0 || header.membershipOffset % 4 != 0 ||
+        !inBounds(header.recordsOffset, quint64(sampleCount) * sizeof(SampleRecord)) ||
+        !inBounds(header.membershipOffset, header.membershipSize) ||
+        !inBounds(header.stringsOffset, header.stringsSize) ||
+        !inBounds(header.metadataOffset, header.metadataSize)) {
+        return fail(tr("Invalid project file: section out of range"));
+    }
+    
+    const char* strings = reinterpret_cast<const char*>(base + header.stringsOffset);
+    const quint64 stringsSize = header.stringsSize;
+    auto readString = [&](quint32 offset) -> QString {
+        if (offset == 0 || quint64(offset) + 4 > stringsSize) return QString();
+        quint32_le length;
+        std::memcpy(&length, strings + offset, sizeof(length));
+        if (quint64(offset) + 4 + length > stringsSize) return QString();
+        return QString::fromUtf8(strings + offset + 4, length);
+    };
+    
+    // Dataset and subset metadata
+    QVariantMap datasetMetadata;
+    QVariantList subsetMetadata;
+    {
+        QDataStream in(QByteArray::fromRawData(reinterpret_cast<const char*>(base + header.metadataOffset),
+                                               header.metadataSize));
+        in.setVersion(QDataStream::Qt_6_0);
+        in >> datasetMetadata >> subsetMetadata;
+        if (in.status() != QDataStream::Ok || subsetMetadata.size() != qsizetype(subsetCount)) {
+            return fail(tr("Invalid project file: corrupt metadata"));
+        }
+    }
+    
+    // Membership: where each record goes first, and any further subsets
+    const quint32_le* membership = reinterpret_cast<const quint32_le*>(base + header.membershipOffset);
+    const quint64 membershipWords = header.membershipSize / sizeof(quint32_le);
+    quint64 cursor = 0;
+    std::vector<int> home(sampleCount, -2);  // -2: none, -1: root, else subset index
+    QHash<quint32, QList<int>> extraMemberships;
+    for (int list = -1; list < int(subsetCount); ++list) {
+        if (cursor >= membershipWords) {
+            return fail(tr("Invalid project file: corrupt membership"));
+        }
+        const quint32 count = membership[cursor++];
+        if (count > membershipWords - cursor) {
+            return fail(tr("Invalid project file: corrupt membership"));
+        }
+        for (quint32 i = 0; i < count; ++i) {
+            const quint32 record = membership[cursor++];
+            if (record >= sampleCount) {
+                return fail(tr("Invalid project file: corrupt membership"));
+            }
+            if (home[record] == -2) {
+                home[record] = list;
+            } else {
+                extraMemberships[record].append(list);
+            }
+        }
+    }
+    
+    Dataset loaded;
+    QStringList subsetNames;
+    for (const QVariant& meta : subsetMetadata) {
+        DatasetSubset subset;
+        subset.metadata() = SubsetMetadata::fromVariantMap(meta.toMap());
+        subsetNames.append(subset.name());
+        loaded.addSubset(subset);
+    }
+    
+    const SampleRecord* records = reinterpret_cast<const SampleRecord*>(base + header.recordsOffset);
+    QStringList blobPaths(sampleCount);
+    std::vector<qint64> blobSizes(sampleCount, 0);
+    bool hasInlinePayloads = false;
+    for (quint32 i = 0; i < sampleCount; ++i) {
+        const SampleRecord& record = records[i];
+        if (record.type > static_cast<quint8>(SampleType::Multimodal) ||
+            !inBounds(record.payloadOffset, record.payloadSize) ||
+            !inBounds(record.extrasOffset, record.extrasSize)) {
+            return fail(tr("Invalid project file: corrupt sample record %1").arg(i));
+        }
+        
+        if (record.flags & StoredPayload) {
+            const QString hash = QString::fromLatin1(
+                QByteArray(reinterpret_cast<const char*>(base + record.payloadOffset),
+                           record.payloadSize).toHex());
+            
+            // One stat per stored payload; the blob itself is not opened
+            const QFileInfo blob(store ? store->pathFor(hash) : QString());
+            if (!store || record.payloadSize != 32 || !blob.exists()) {
+                return fail(tr("Missing payload %1 of sample record %2 in the blob store").arg(hash).arg(i));
+            }
+            blobPaths[i] = blob.filePath();
+            blobSizes[i] = blob.size();
+        } else if (record.payloadSize > 0) {
+            hasInlinePayloads = true;
+        }
+    }
+    
+    // Inline payloads are read from the project file on access; only if it
+    // cannot be linked are they decoded now
+    QString linkPath;
+    removeStaleLinks(filePath);
+    const std::shared_ptr<const void> link = hasInlinePayloads ? linkSnapshot(filePath, &linkPath) : nullptr;
+    
+    // Payloads and metadata are decoded on worker threads straight from the
+    // mapping; samples are added to the dataset in record order
+    auto decode = [&](int i) {
+        const SampleRecord& record = records[i];
+        DatasetSample sample(static_cast<SampleType>(record.type));
+        const Encoding encoding = static_cast<Encoding>(record.encoding);
+        if (!blobPaths[i].isEmpty()) {
+            readStoredPayload(blobPaths[i], blobSizes[i], encoding,
+                              readString(record.formatString).toLatin1(), sample);
+        } else {
+            PayloadSource source;
+            source.path = linkPath;
+            source.offset = record.payloadOffset;
+            source.length = record.payloadSize;
+            source.decodedSize = record.payloadSize;
+            source.keepAlive = link;
+            if (!link || record.payloadSize == 0 ||
+                !setLazyPayload(source, encoding, readString(record.formatString).toLatin1(), sample)) {
+                readPayload(base + record.payloadOffset, record.payloadSize, encoding, sample);
+            }
+        }
+        
+        SampleMetadata& meta = sample.metadata();
+        meta.id = readString(record.idString);
+        meta.sourceFile = readString(record.sourceFileString);
+        meta.timestamp = record.timestamp == InvalidTimestamp
+            ? QDateTime() : QDateTime::fromMSecsSinceEpoch(record.timestamp);
+        if (record.extrasSize > 0) {
+            QDataStream in(QByteArray::fromRawData(reinterpret_cast<const char*>(base + record.extrasOffset),
+                                                   record.extrasSize));
+            in.setVersion(QDataStream::Qt_6_0);
+            in >> meta.tags >> meta.labels >> meta.attributes >> meta.annotations;
+        }
+        return sample;
+    };
+    
+    auto listName = [&subsetNames](int list) { return list < 0 ? QString() : subsetNames[list]; };
+    auto consume = [&](int i, DatasetSample& sample) {
+        // Memberships go with the record, so empty or clashing ids keep them
+        const auto extra = extraMemberships.constFind(i);
+        if (extra != extraMemberships.cend()) {
+            QStringList names{listName(home[i])};
+            for (int list : *extra) {
+                names.append(listName(list));
+            }
+            loaded.addSample(sample, names);
+        } else if (home[i] != -2) {
+            loaded.addSample(sample, listName(home[i]));
+        }
+        const SampleRecord& record = records[i];
+        return !progress || progress(i + 1, sampleCount, record.payloadOffset + record.payloadSize);
+    };
+    
+    DecodeQueue<DatasetSample> queue;
+    if (!queue.run(sampleCount, decode, consume)) {
+        return fail(tr("Cancelled"));
+    }
+    
+    // Set last so loading does not bump the modification time
+    loaded.metadata() = DatasetMetadata::fromVariantMap(datasetMetadata);
+    
+    file.unmap(const_cast<uchar*>(base));
+    dataset = std::move(loaded);
+    return true;
+}
+
+QByteArray ProjectFormat::encodeSample(const DatasetSample& sample) {
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly);
+    
+    SampleRecord record;
+    std::memset(&record, 0, sizeof(record));
+    record.type = static_cast<quint8>(sample.type());
+    buffer.write(reinterpret_cast<const char*>(&record), sizeof(record));
+    writePayload(sample, PayloadTarget{&buffer, nullptr, nullptr}, record);
+    
+    // Metadata travels as a map so the encoding needs no string table
+    QByteArray metadata;
+    QDataStream out(&metadata, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << sample.metadata().toVariantMap();
+    writeBlob(&buffer, QByteArray(), metadata.constData(), metadata.size(),
+              record.extrasOffset, record.extrasSize);
+    
+    buffer.seek(0);
+    buffer.write(reinterpret_cast<const char*>(&record), sizeof(record));
+    return data;
+}
+
+bool ProjectFormat::decodeSample(const QByteArray& data, DatasetSample& sample) {
+    const qint64 size = data.size();
+    if (size < qint64(sizeof(SampleRecord))) {
+        return false;
+    }
+    
+    SampleRecord record;
+    std::memcpy(&record, data.constData(), sizeof(record));
+    auto inBounds = [size](quint64 offset, quint64 length) {
+        return offset <= quint64(size) && length <= quint64(size) - offset;
+    };
+    if (record.type > static_cast<quint8>(SampleType::Multimodal) || (record.flags & StoredPayload) ||
+        !inBounds(record.payloadOffset, record.payloadSize) ||
+        !inBounds(record.extrasOffset, record.extrasSize)) {
+        return false;  // Self-contained encodings never refer to a store
+    }
+    
+    const uchar* base = reinterpret_cast<const uchar*>(data.constData());
+    sample = DatasetSample(static_cast<SampleType>(record.type));
+    readPayload(base + record.payloadOffset, record.payloadSize,
+                static_cast<Encoding>(record.encoding), sample);
+    
+    QDataStream in(QByteArray::fromRawData(data.constData() + record.extrasOffset, record.extrasSize));
+    in.setVersion(QDataStream::Qt_6_0);
+    QVariantMap metadata;
+    in >> metadata;
+    sample.metadata() = SampleMetadata::fromVariantMap(metadata);
+    return in.status() == QDataStream::Ok;
+}
+
+}
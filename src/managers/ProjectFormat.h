@@ -0,0 +1,190 @@
+#pragma once
+#include "core/BlobStore.h"
+#include "core/Dataset.h"
+#include "core/Progress.h"
+#include <QCoreApplication>
+#include <QIODevice>
+#include <QSet>
+#include <QString>
+#include <QtEndian>
+#include <functional>
+#include <limits>
+#include <memory>
+
+namespace DatasetCreator {
+
+/**
+ * @brief Binary project format (.dscp version 2)
+ *
+ * Layout, all integers little-endian:
+ *   Header           fixed size, at offset 0
+ *   Payload blobs    sample payloads and per-sample extras, 8-byte aligned
+ *   Sample records   one fixed-size SampleRecord per distinct sample
+ *   Membership       root rows, then the rows of each subset
+ *                    (each list: quint32 count followed by record indices)
+ *   String table     quint32 length + UTF-8 bytes; offset 0 is ""
+ *   Metadata         dataset and subset metadata (QDataStream)
+ *
+ * Everything is written in one sequential pass; only the header is patched
+ * at the end. Readers map the file and reach every section by offset.
+ *
+ * When written with a BlobStore, payloads of BlobStore::MinBlobSize bytes or
+ * more are put into the store instead; their record is flagged
+ * StoredPayload and the payload blob holds the 32-byte hash. The blob in
+ * the store has the same layout as an inline payload blob.
+ *
+ * Reading builds the sample index (records, strings, membership, extras)
+ * without touching payloads: text, bytes and encoded images stay in the
+ * project or blob file and are decoded on first access (see PayloadCache),
+ * so opening a project costs about as much as its metadata. Inline
+ * payloads are read through a hidden hard link to the project file
+ * (.<name>.<id>.open next to it, locked by the session using it), since a
+ * save replaces the file; where no link can be made they are decoded while
+ * reading. Opening and saving remove links no running session holds.
+ * Version 1 projects (JSON) are still read by ProjectManager.
+ */
+class ProjectFormat {
+    Q_DECLARE_TR_FUNCTIONS(ProjectFormat)
+public:
+    static constexpr quint32 Version = 2;
+    
+    enum class Encoding : quint8 {
+        None = 0,
+        Utf8,          // Text as UTF-8
+        Bytes,         // Binary data as is
+        RawImage,      // ImageBlobHeader + scanlines
+        EncodedImage,  // Compressed image file bytes (PNG, JPEG, ...)
+        Pcm,           // AudioBlobHeader + samples
+        Variant        // QDataStream of a QVariantMap (multimodal)
+    };
+    
+    enum RecordFlag : quint16 {
+        StoredPayload = 0x1    // Payload blob is the BlobStore hash of the payload
+    };
+    
+    struct Header {
+        char magic[4];                 // "DSCP"
+        quint32_le version;
+        quint32_le sampleCount;
+        quint32_le subsetCount;
+        quint64_le recordsOffset;
+        quint64_le membershipOffset;
+        quint64_le membershipSize;
+        quint64_le stringsOffset;
+        quint64_le stringsSize;
+        quint64_le metadataOffset;
+        quint64_le metadataSize;
+        quint64_le journalId;          // Change journal this snapshot belongs to
+        quint64_le journalSequence;    // Last journal entry already included
+        quint64_le reserved[2];
+    };
+    
+    struct SampleRecord {
+        quint8 type;                   // SampleType
+        quint8 encoding;               // Encoding
+        quint16_le flags;              // RecordFlag
+        quint32_le idString;           // String table offsets
+        quint32_le sourceFileString;
+        quint32_le formatString;       // Encoded image format, 0 if unknown
+        qint64_le timestamp;           // ms since epoch, InvalidTimestamp if unset
+        quint64_le payloadOffset;
+        quint64_le payloadSize;
+        quint64_le extrasOffset;       // Tags, labels, attributes, annotations
+        quint64_le extrasSize;
+    };
+    
+    struct ImageBlobHeader {
+        qint32_le width;
+        qint32_le height;
+        qint32_le bytesPerLine;
+        qint32_le format;              // QImage::Format
+    };
+    
+    struct AudioBlobHeader {
+        qint32_le sampleRate;
+        qint32_le channelCount;
+        qint32_le sampleFormat;        // QAudioFormat::SampleFormat
+        qint32_le reserved;
+        qint64_le durationMs;
+    };
+    
+    static constexpr qint64 InvalidTimestamp = std::numeric_limits<qint64>::min();
+    
+    /**
+     * @brief Which change journal a snapshot is the base of (see ProjectJournal)
+     */
+    struct JournalBase {
+        quint64 id = 0;          // 0: no journal
+        quint64 sequence = 0;
+    };
+    
+    /**
+     * @brief Check the magic bytes of a file
+     */
+    static bool isBinaryProject(const QString& filePath);
+    
+    /**
+     * @brief Journal fields of a binary project's header
+     */
+    static JournalBase journalBase(const QString& filePath);
+    
+    /**
+     * @brief Write a dataset to a sequential-write, seekable device
+     * @param store Where large payloads go, or nullptr to keep them inline
+     * @param blobs Receives the hashes of the stored payloads
+     * @return false with error set if writing failed or progress cancelled it
+     */
+    static bool write(const Dataset& dataset, QIODevice* device, const JournalBase& journal,
+                      BlobStore* store, QSet<QString>* blobs,
+                      const ProgressCallback& progress, QString* error);
+    
+    /**
+     * @brief Read a project file through a memory mapping
+     * @param store Store to resolve stored payloads from
+     * @return false with error set if the file is not a valid version 2 project,
+     *         a stored payload is missing, or progress cancelled the read
+     */
+    static bool read(const QString& filePath, Dataset& dataset, const BlobStore* store,
+                     const ProgressCallback& progress, QString* error);
+    
+    /**
+     * @brief Remove snapshot links of a project that no running session uses
+     *
+     * Links are left behind when a session ends without releasing them,
+     * e.g. in a crash; each keeps an old version of the project on disk.
+     */
+    static void removeStaleLinks(const QString& filePath);
+    
+    /**
+     * @brief Self-contained encoding of one sample (record, payload, metadata)
+     */
+    static QByteArray encodeSample(const DatasetSample& sample);
+    static bool decodeSample(const QByteArray& data, DatasetSample& sample);
+
+private:
+    struct PayloadTarget {
+        QIODevice* device;
+        BlobStore* store;              // nullptr: always inline
+        QSet<QString>* blobs;
+    };
+    
+    static bool writePayload(const DatasetSample& sample, const PayloadTarget& target, SampleRecord& record);
+    static bool writePayloadBlob(const PayloadTarget& target, const QByteArray& head, const char* data,
+                                 qint64 size, SampleRecord& record);
+    static bool writeStoredHash(const PayloadTarget& target, const QString& hash, SampleRecord& record);
+    static bool writeBlob(QIODevice* device, const QByteArray& head, const char* data, qint64 size,
+                          quint64_le& offset, quint64_le& blobSize);
+    static void readPayload(const uchar* data, qint64 size, Encoding encoding, DatasetSample& sample);
+    static bool setLazyPayload(PayloadSource source, Encoding encoding, const QByteArray& format,
+                               DatasetSample& sample);
+    static void readStoredPayload(const QString& blobPath, qint64 blobSize, Encoding encoding,
+                                  const QByteArray& format, DatasetSample& sample);
+    static std::shared_ptr<const void> linkSnapshot(const QString& filePath, QString* linkPath);
+};
+
+static_assert(sizeof(ProjectFormat::Header) == 104, "Header layout is part of the file format");
+static_assert(sizeof(ProjectFormat::SampleRecord) == 56, "SampleRecord layout is part of the file format");
+static_assert(sizeof(ProjectFormat::ImageBlobHeader) == 16, "ImageBlobHeader layout is part of the file format");
+static_assert(sizeof(ProjectFormat::AudioBlobHeader) == 24, "AudioBlobHeader layout is part of the file format");
+
+}
@@ -0,0 +1,223 @@
+#include "ProjectJournal.h"
+#include <QDataStream>
+#include <QFile>
+#include <QRandomGenerator>
+#include <QSaveFile>
+#include <cstring>
+
+namespace DatasetCreator {
+
+quint64 ProjectJournal::newJournalId() {
+    quint64 id = 0;
+    while (id == 0) {
+        id = QRandomGenerator::global()->generate64();
+    }
+    return id;
+}
+
+bool ProjectJournal::create(const QString& journalPath, quint64 journalId, QString* error) {
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, "DSCJ", 4);
+    header.version = Version;
+    header.journalId = journalId;
+    
+    QSaveFile file(journalPath);
+    if (!file.open(QIODevice::WriteOnly) ||
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header)) != sizeof(header) ||
+        !file.commit()) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+QByteArray ProjectJournal::encodeEntry(const JournalEntry& entry, const Dataset& dataset) {
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << static_cast<quint8>(entry.op) << entry.sequence << entry.sampleId
+        << qint32(entry.list) << entry.value;
+    
+    if (entry.op == JournalEntry::Op::Insert) {
+        // The sample as it is now; later entries bring it to its final state
+        const DatasetSample* sample = dataset.sampleById(entry.sampleId);
+        DatasetSample placeholder;
+        placeholder.metadata().id = entry.sampleId;
+        out << ProjectFormat::encodeSample(sample ? *sample : placeholder);
+    }
+    return data;
+}
+
+bool ProjectJournal::decodeEntry(const char* data, qint64 size, JournalEntry& entry, bool withSample) {
+    QDataStream in(QByteArray::fromRawData(data, size));
+    in.setVersion(QDataStream::Qt_6_0);
+    
+    quint8 op = 0;
+    qint32 list = -1;
+    in >> op >> entry.sequence;
+    if (!withSample) {
+        return in.status() == QDataStream::Ok;
+    }
+    
+    in >> entry.sampleId >> list >> entry.value;
+    entry.op = static_cast<JournalEntry::Op>(op);
+    entry.list = list;
+    if (entry.op == JournalEntry::Op::Insert) {
+        QByteArray sample;
+        in >> sample;
+        if (!ProjectFormat::decodeSample(sample, entry.sample)) {
+            return false;
+        }
+    }
+    return in.status() == QDataStream::Ok;
+}
+
+qint64 ProjectJournal::nextRecord(const QByteArray& log, qint64 pos, qint64* bodySize) {
+    // Returns the end of the record at pos, or -1 if it is torn or corrupt
+    if (pos + qint64(sizeof(RecordHeader)) > log.size()) {
+        return -1;
+    }
+    
+    RecordHeader header;
+    std::memcpy(&header, log.constData() + pos, sizeof(header));
+    const qint64 body = pos + sizeof(header);
+    if (body + qint64(header.size) > log.size() ||
+        qChecksum(QByteArrayView(log.constData() + body, header.size)) != header.checksum) {
+        return -1;
+    }
+    
+    *bodySize = header.size;
+    return body + header.size;
+}
+
+bool ProjectJournal::append(const QString& journalPath, DatasetJournal& journal,
+                            const Dataset& dataset, QString* error) {
+    QByteArray records;
+    for (const JournalEntry& entry : journal.entries()) {
+        const QByteArray body = encodeEntry(entry, dataset);
+        RecordHeader header;
+        header.size = body.size();
+        header.checksum = qChecksum(body);
+        records.append(reinterpret_cast<const char*>(&header), sizeof(header));
+        records.append(body);
+    }
+    
+    QFile file(journalPath);
+    if (!file.open(QIODevice::ReadWrite | QIODevice::ExistingOnly)) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+    
+    // The log of an earlier snapshot may still be in place while the
+    // snapshot for this journal is being written
+    Header header;
+    if (file.read(reinterpret_cast<char*>(&header), sizeof(header)) != sizeof(header) ||
+        std::memcmp(header.magic, "DSCJ", 4) != 0 || header.journalId != journal.journalId()) {
+        if (error) *error = tr("Journal belongs to another snapshot");
+        return false;
+    }
+    if (file.size() != journal.logSize()) {
+        if (error) *error = tr("Journal was changed outside this session");
+        return false;
+    }
+    
+    if (!file.seek(journal.logSize()) || file.write(records) != records.size() || !file.flush()) {
+        // Cut off whatever part made it, so the log stays well-formed
+        if (error) *error = file.errorString();
+        file.resize(journal.logSize());
+        return false;
+    }
+    
+    journal.setLogSize(journal.logSize() + records.size());
+    journal.clearEntries();
+    return true;
+}
+
+ProjectJournal::Replay ProjectJournal::replay(const QString& journalPath, const ProjectFormat::JournalBase& base,
+                                              Dataset& dataset, quint64* lastSequence, qint64* logSize,
+                                              QString* error) {
+    QFile file(journalPath);
+    if (base.id == 0 || !file.open(QIODevice::ReadWrite)) {
+        return Replay::NoLog;
+    }
+    
+    const QByteArray log = file.readAll();
+    Header header;
+    if (log.size() < qint64(sizeof(header))) {
+        return Replay::NoLog;
+    }
+    std::memcpy(&header, log.constData(), sizeof(header));
+    if (std::memcmp(header.magic, "DSCJ", 4) != 0 || header.version != Version ||
+        header.journalId != base.id) {
+        return Replay::NoLog;
+    }
+    
+    *lastSequence = base.sequence;
+    qint64 pos = sizeof(header);
+    qint64 bodySize = 0;
+    for (qint64 end; (end = nextRecord(log, pos, &bodySize)) >= 0; pos = end) {
+        JournalEntry entry;
+        if (!decodeEntry(log.constData() + end - bodySize, bodySize, entry, false)) {
+            if (error) *error = tr("Journal record at byte %1 cannot be read").arg(pos);
+            return Replay::Failed;
+        }
+        if (entry.sequence <= base.sequence) {
+            continue;  // Already part of the snapshot
+        }
+        if (!decodeEntry(log.constData() + end - bodySize, bodySize, entry, true) ||
+            !dataset.applyJournalEntry(entry)) {
+            if (error) *error = tr("Journal entry %1 does not apply to the project").arg(entry.sequence);
+            return Replay::Failed;
+        }
+        *lastSequence = entry.sequence;
+    }
+    
+    // Drop a torn tail so later appends are reachable
+    if (pos < log.size()) {
+        file.resize(pos);
+    }
+    *logSize = pos;
+    return Replay::Applied;
+}
+
+bool ProjectJournal::trim(const QString& journalPath, const ProjectFormat::JournalBase& base,
+                          qint64* logSize, QString* error) {
+    QFile file(journalPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+    
+    const QByteArray log = file.readAll();
+    file.close();
+    Header header;
+    if (log.size() < qint64(sizeof(header))) {
+        return false;
+    }
+    std::memcpy(&header, log.constData(), sizeof(header));
+    if (header.journalId != base.id) {
+        return false;
+    }
+    
+    QByteArray trimmed = log.left(sizeof(header));
+    qint64 pos = sizeof(header);
+    qint64 bodySize = 0;
+    for (qint64 end; (end = nextRecord(log, pos, &bodySize)) >= 0; pos = end) {
+        JournalEntry entry;
+        if (decodeEntry(log.constData() + end - bodySize, bodySize, entry, false) &&
+            entry.sequence > base.sequence) {
+            trimmed.append(log.constData() + pos, end - pos);
+        }
+    }
+    
+    QSaveFile out(journalPath);
+    if (!out.open(QIODevice::WriteOnly) || out.write(trimmed) != trimmed.size() || !out.commit()) {
+        if (error) *error = out.errorString();
+        return false;
+    }
+    *logSize = trimmed.size();
+    return true;
+}
+
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include "ProjectFormat.h"
+#include "core/Dataset.h"
+#include "core/DatasetJournal.h"
+#include <QCoreApplication>
+#include <QString>
+#include <QtEndian>
+
+namespace DatasetCreator {
+
+/**
+ * @brief Append-only change log next to a binary project (<project>.journal)
+ *
+ * Layout, all integers little-endian:
+ *   Header     magic "DSCJ", version, journal ID
+ *   Records    quint32 size, quint32 checksum, then the entry (QDataStream)
+ *
+ * A project snapshot names the journal it belongs to and the sequence
+ * number of the last entry it already contains (ProjectFormat::JournalBase).
+ * Loading replays the newer entries; a torn record at the end from an
+ * interrupted save is cut off. Because entries are filtered by sequence,
+ * a crash between writing a compacted snapshot and trimming the log
+ * leaves a consistent project either way.
+ */
+class ProjectJournal {
+    Q_DECLARE_TR_FUNCTIONS(ProjectJournal)
+public:
+    static constexpr quint32 Version = 1;
+    
+    struct Header {
+        char magic[4];                 // "DSCJ"
+        quint32_le version;
+        quint64_le journalId;
+        quint64_le reserved[2];
+    };
+    
+    struct RecordHeader {
+        quint32_le size;
+        quint32_le checksum;           // qChecksum of the entry bytes
+    };
+    
+    static QString pathFor(const QString& projectPath) { return projectPath + ".journal"; }
+    static quint64 newJournalId();
+    
+    /**
+     * @brief Start an empty log
+     */
+    static bool create(const QString& journalPath, quint64 journalId, QString* error);
+    
+    /**
+     * @brief Append the journal's pending entries and clear them
+     *
+     * Inserted samples are encoded from their current state in dataset.
+     * Fails without writing if the log is not the one the journal expects,
+     * by journal ID as well as by size.
+     */
+    static bool append(const QString& journalPath, DatasetJournal& journal,
+                       const Dataset& dataset, QString* error);
+    
+    enum class Replay {
+        Applied,       // Every newer entry was applied
+        NoLog,         // There is no log for this snapshot
+        Failed         // An intact entry could not be applied; the log is left alone
+    };
+    
+    /**
+     * @brief Apply the entries newer than base to a freshly loaded snapshot
+     *
+     * Only a torn or corrupt tail (a record whose size or checksum does not
+     * fit) is cut off. An entry that is intact but does not decode or apply
+     * fails the replay, so that no saved change is dropped silently.
+     */
+    static Replay replay(const QString& journalPath, const ProjectFormat::JournalBase& base,
+                         Dataset& dataset, quint64* lastSequence, qint64* logSize, QString* error);
+    
+    /**
+     * @brief Drop the entries a new snapshot already contains
+     */
+    static bool trim(const QString& journalPath, const ProjectFormat::JournalBase& base,
+                     qint64* logSize, QString* error);
+
+private:
+    static QByteArray encodeEntry(const JournalEntry& entry, const Dataset& dataset);
+    static bool decodeEntry(const char* data, qint64 size, JournalEntry& entry, bool withSample);
+    static qint64 nextRecord(const QByteArray& log, qint64 pos, qint64* bodySize);
+};
+
+static_assert(sizeof(ProjectJournal::Header) == 32, "Header layout is part of the file format");
+static_assert(sizeof(ProjectJournal::RecordHeader) == 8, "RecordHeader layout is part of the file format");
+
+}
@@ -1,107 +1,327 @@
 #include "ProjectManager.h"
+#include "ProjectFormat.h"
+#include "JsonProjectReader.h"
+#include "ProjectJournal.h"
 #include <QFile>
-#include <QJsonDocument>
-#include <QJsonObject>
-#include <QJsonArray>
 #include <QFileInfo>
-#include <QDir>
+#include <QSaveFile>
 
 namespace DatasetCreator {
 
 ProjectManager::ProjectManager(QObject* parent)
-    : QObject(parent) {
+    : QObject(parent)
+    , journaling_(true)
+    , compactionThreshold_(16 * 1024 * 1024)
+    , compacting_(false)
+    , blobStore_(nullptr)
+{
+    jobPool_.setMaxThreadCount(1);
 }
 
-bool ProjectManager::saveProject(const Dataset& dataset, const QString& filePath) {
+ProjectManager::~ProjectManager() {
+    // Saves in progress are finished rather than cancelled
+    jobPool_.waitForDone();
+}
+
+bool ProjectManager::saveProject(Dataset& dataset, const QString& filePath) {
     lastError_.clear();
     
-    // Convert dataset to QVariantMap
-    QVariantMap datasetMap = dataset.toVariantMap();
+    if (journaling_ && appendToJournal(dataset, filePath)) {
+        emit projectSaved(filePath);
+        return true;
+    }
     
-    // Convert to JSON
-    QJsonDocument doc = QJsonDocument::fromVariant(datasetMap);
-    if (doc.isNull()) {
-        lastError_ = tr("Failed to serialize dataset to JSON");
+    if (!saveSnapshot(dataset, filePath)) {
         emit error(lastError_);
         return false;
     }
     
-    // Save to file
-    QFile file(filePath);
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        lastError_ = tr("Failed to open file for writing: %1").arg(file.errorString());
-        emit error(lastError_);
+    emit projectSaved(filePath);
+    return true;
+}
+
+bool ProjectManager::appendToJournal(Dataset& dataset, const QString& filePath) {
+    // Only while the journal is complete and belongs to this file; large
+    // imports are cheaper to write as a snapshot than as journal entries
+    std::shared_ptr<DatasetJournal> journal = dataset.journal();
+    if (!journal || !journal->isValid() || journal->filePath() != filePath ||
+        journal->insertedBytes() > compactionThreshold_) {
+        return false;
+    }
+    
+    journal->record(JournalEntry::Op::SetMetadata, QString(), -1, dataset.metadata().toVariantMap());
+    QString appendError;
+    if (!ProjectJournal::append(ProjectJournal::pathFor(filePath), *journal, dataset, &appendError)) {
         return false;
     }
     
-    qint64 bytesWritten = file.write(doc.toJson(QJsonDocument::Indented));
-    file.close();
+    if (journal->logSize() > compactionThreshold_) {
+        startCompaction(dataset, filePath);
+    }
+    return true;
+}
+
+bool ProjectManager::saveSnapshot(Dataset& dataset, const QString& filePath) {
+    // A background save or compaction writes the same file
+    jobPool_.waitForDone();
+    
+    const ProjectFormat::JournalBase base{journaling_ ? ProjectJournal::newJournalId() : 0, 0};
     
-    if (bytesWritten == -1) {
-        lastError_ = tr("Failed to write to file: %1").arg(file.errorString());
-        emit error(lastError_);
+    auto progress = [this](int current, int total, qint64) {
+        if (current % 256 == 0 || current == total) {
+            emit saveProgress(current, total);
+        }
+        return true;
+    };
+    if (!writeSnapshot(dataset, filePath, base, blobStore_, progress, &lastError_)) {
         return false;
     }
     
-    emit projectSaved(filePath);
+    // A log left from an earlier snapshot no longer applies
+    const QString journalPath = ProjectJournal::pathFor(filePath);
+    if (base.id == 0 || !ProjectJournal::create(journalPath, base.id, nullptr)) {
+        QFile::remove(journalPath);
+        dataset.setJournal(nullptr);
+        return true;
+    }
+    
+    attachJournal(dataset, filePath, base);
     return true;
 }
 
-bool ProjectManager::loadProject(const QString& filePath, Dataset& dataset) {
-    lastError_.clear();
+bool ProjectManager::writeSnapshot(const Dataset& dataset, const QString& filePath,
+                                   const ProjectFormat::JournalBase& base, BlobStore* store,
+                                   const ProgressCallback& progress, QString* error) {
+    // Written to a temporary file and renamed over the target on commit,
+    // so a failed or cancelled save never leaves a truncated project behind
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        *error = tr("Failed to open file for writing: %1").arg(file.errorString());
+        return false;
+    }
     
-    // Check if file exists
-    QFileInfo fileInfo(filePath);
-    if (!fileInfo.exists()) {
-        lastError_ = tr("Project file does not exist: %1").arg(filePath);
-        emit error(lastError_);
+    QString writeError;
+    QSet<QString> blobs;
+    if (!ProjectFormat::write(dataset, &file, base, store, &blobs, progress, &writeError)) {
+        file.cancelWriting();
+        *error = tr("Failed to write to file: %1").arg(writeError);
         return false;
     }
     
-    // Load file
-    QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        lastError_ = tr("Failed to open file for reading: %1").arg(file.errorString());
-        emit error(lastError_);
+    if (!file.commit()) {
+        *error = tr("Failed to write to file: %1").arg(file.errorString());
         return false;
     }
+    ProjectFormat::removeStaleLinks(filePath);
     
-    QByteArray fileData = file.readAll();
-    file.close();
+    if (store) {
+        store->setReferences(filePath, blobs);
+    }
+    return true;
+}
+
+BackgroundJob* ProjectManager::saveProjectAsync(Dataset& dataset, const QString& filePath) {
+    lastError_.clear();
     
-    // Parse JSON
-    QJsonParseError parseError;
-    QJsonDocument doc = QJsonDocument::fromJson(fileData, &parseError);
+    auto* job = new BackgroundJob(tr("Saving %1").arg(QFileInfo(filePath).fileName()), this);
     
-    if (doc.isNull() || parseError.error != QJsonParseError::NoError) {
-        lastError_ = tr("Failed to parse JSON: %1").arg(parseError.errorString());
-        emit error(lastError_);
-        return false;
+    // Appending to the journal is quick; the job only reports it
+    if (journaling_ && appendToJournal(dataset, filePath)) {
+        connect(job, &BackgroundJob::finished, this, [this, filePath]() { emit projectSaved(filePath); });
+        job->start(&jobPool_, [](const ProgressCallback&, QString*) { return true; });
+        return job;
+    }
+    
+    // The new journal is attached before the snapshot is taken, so edits
+    // made while the snapshot is written are recorded on top of it. Jobs
+    // run one at a time, so a running compaction finishes first.
+    const ProjectFormat::JournalBase base{journaling_ ? ProjectJournal::newJournalId() : 0, 0};
+    std::shared_ptr<const Dataset> snapshot = dataset.snapshot();
+    std::shared_ptr<DatasetJournal> journal;
+    if (base.id != 0) {
+        attachJournal(dataset, filePath, base);
+        journal = dataset.journal();
+    } else {
+        dataset.setJournal(nullptr);
+    }
+    
+    connect(job, &BackgroundJob::finished, this, [this, filePath, journal](bool success, const QString& jobError) {
+        // Without the snapshot or its log, the recorded entries have
+        // nothing to apply to and the next save writes a snapshot
+        if (journal && (!success || !QFileInfo::exists(ProjectJournal::pathFor(filePath)))) {
+            journal->invalidate();
+        }
+        if (!success) {
+            lastError_ = jobError;
+            emit error(lastError_);
+            return;
+        }
+        emit projectSaved(filePath);
+    });
+    connect(job, &BackgroundJob::progress, this, &ProjectManager::saveProgress);
+    
+    BlobStore* store = blobStore_;
+    job->start(&jobPool_, [snapshot, filePath, base, store, journal](const ProgressCallback& progress, QString* error) {
+        if (!writeSnapshot(*snapshot, filePath, base, store, progress, error)) {
+            return false;
+        }
+        
+        // A log left from an earlier snapshot no longer applies
+        const QString journalPath = ProjectJournal::pathFor(filePath);
+        if (!journal || !ProjectJournal::create(journalPath, base.id, nullptr)) {
+            QFile::remove(journalPath);
+        }
+        return true;
+    });
+    return job;
+}
+
+void ProjectManager::attachJournal(Dataset& dataset, const QString& filePath,
+                                   const ProjectFormat::JournalBase& base) {
+    auto journal = std::make_shared<DatasetJournal>(filePath, base.id, base.sequence + 1);
+    journal->setLogSize(sizeof(ProjectJournal::Header));
+    dataset.setJournal(journal);
+}
+
+void ProjectManager::startCompaction(const Dataset& dataset, const QString& filePath) {
+    if (compacting_) {
+        return;
+    }
+    
+    std::shared_ptr<DatasetJournal> journal = dataset.journal();
+    const ProjectFormat::JournalBase base{journal->journalId(), journal->lastSequence()};
+    compacting_ = true;
+    compactingJournal_ = journal;
+    
+    // The snapshot shares its storage with the dataset, so it is cheap and
+    // stays consistent while the user keeps editing
+    std::shared_ptr<const Dataset> snapshot = dataset.snapshot();
+    BlobStore* store = blobStore_;
+    jobPool_.start([this, snapshot, base, filePath, store]() {
+        QString writeError;
+        const bool ok = writeSnapshot(*snapshot, filePath, base, store, nullptr, &writeError);
+        QMetaObject::invokeMethod(this, [this, filePath, base, ok, writeError]() {
+            finishCompaction(filePath, base, ok, writeError);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void ProjectManager::finishCompaction(const QString& filePath, const ProjectFormat::JournalBase& base,
+                                      bool ok, const QString& compactionError) {
+    compacting_ = false;
+    std::shared_ptr<DatasetJournal> journal = compactingJournal_.lock();
+    compactingJournal_.reset();
+    
+    if (!ok) {
+        // The snapshot and log on disk are unchanged and still consistent
+        emit error(tr("Failed to compact project: %1").arg(compactionError));
+        return;
+    }
+    
+    // Entries up to base.sequence are in the snapshot now; the log keeps the rest
+    qint64 logSize = 0;
+    if (ProjectJournal::trim(ProjectJournal::pathFor(filePath), base, &logSize, nullptr) &&
+        journal && journal->journalId() == base.id) {
+        journal->setLogSize(logSize);
+    }
+    emit projectCompacted(filePath);
+}
+
+void ProjectManager::collectGarbage() {
+    if (!blobStore_) {
+        return;
     }
     
-    if (!doc.isObject()) {
-        lastError_ = tr("Invalid project file format: root must be an object");
+    // On the job pool, so the scan is done before this manager (and a store
+    // that only lives as long) goes away, and never overlaps a save
+    BlobStore* store = blobStore_;
+    jobPool_.start([store]() { store->collectGarbage(); });
+}
+
+bool ProjectManager::loadProject(const QString& filePath, Dataset& dataset) {
+    lastError_.clear();
+    jobPool_.waitForDone();
+    
+    auto progress = [this](int current, int total, qint64) {
+        if (current % 256 == 0 || current == total) {
+            emit loadProgress(current, total);
+        }
+        return true;
+    };
+    if (!readProject(filePath, dataset, blobStore_, journaling_, progress, &lastError_)) {
         emit error(lastError_);
         return false;
     }
     
-    // Convert to QVariantMap
-    QVariantMap datasetMap = doc.object().toVariantMap();
+    emit projectLoaded(filePath);
+    return true;
+}
+
+BackgroundJob* ProjectManager::loadProjectAsync(const QString& filePath, std::shared_ptr<Dataset> dataset) {
+    lastError_.clear();
+    
+    auto* job = new BackgroundJob(tr("Opening %1").arg(QFileInfo(filePath).fileName()), this);
+    connect(job, &BackgroundJob::finished, this, [this, filePath](bool success, const QString& jobError) {
+        if (!success) {
+            lastError_ = jobError;
+            emit error(lastError_);
+            return;
+        }
+        emit projectLoaded(filePath);
+    });
+    connect(job, &BackgroundJob::progress, this, &ProjectManager::loadProgress);
     
-    // Deserialize dataset
-    try {
-        dataset = Dataset::fromVariantMap(datasetMap);
-    } catch (const std::exception& e) {
-        lastError_ = tr("Failed to deserialize dataset: %1").arg(e.what());
-        emit error(lastError_);
+    const BlobStore* store = blobStore_;
+    const bool journaling = journaling_;
+    job->start(&jobPool_, [filePath, dataset, store, journaling](const ProgressCallback& progress, QString* error) {
+        return readProject(filePath, *dataset, store, journaling, progress, error);
+    });
+    return job;
+}
+
+bool ProjectManager::readProject(const QString& filePath, Dataset& dataset, const BlobStore* store,
+                                 bool journaling, const ProgressCallback& progress, QString* error) {
+    // Check if file exists
+    QFileInfo fileInfo(filePath);
+    if (!fileInfo.exists()) {
+        *error = tr("Project file does not exist: %1").arg(filePath);
         return false;
-    } catch (...) {
-        lastError_ = tr("Failed to deserialize dataset: unknown error");
-        emit error(lastError_);
+    }
+    
+    // Binary projects, and JSON (version 1) projects from earlier releases
+    const bool binary = ProjectFormat::isBinaryProject(filePath);
+    const bool ok = binary
+        ? ProjectFormat::read(filePath, dataset, store, progress, error)
+        : JsonProjectReader::read(filePath, dataset, progress, error);
+    if (!ok) {
         return false;
     }
     
-    emit projectLoaded(filePath);
+    // Changes saved since the snapshot are replayed whether or not
+    // journaling is on; only then can the journal be continued
+    if (binary) {
+        ProjectFormat::JournalBase base = ProjectFormat::journalBase(filePath);
+        const QString journalPath = ProjectJournal::pathFor(filePath);
+        quint64 lastSequence = 0;
+        qint64 logSize = 0;
+        QString replayError;
+        switch (ProjectJournal::replay(journalPath, base, dataset, &lastSequence, &logSize, &replayError)) {
+            case ProjectJournal::Replay::Applied:
+                if (journaling) {
+                    attachJournal(dataset, filePath, {base.id, lastSequence});
+                    dataset.journal()->setLogSize(logSize);
+                }
+                break;
+            case ProjectJournal::Replay::NoLog:
+                if (journaling && base.id != 0 && ProjectJournal::create(journalPath, base.id, nullptr)) {
+                    attachJournal(dataset, filePath, base);
+                }
+                break;
+            case ProjectJournal::Replay::Failed:
+                *error = tr("Failed to apply saved changes: %1").arg(replayError);
+                return false;
+        }
+    }
     return true;
 }
 
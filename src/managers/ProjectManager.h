@@ -1,28 +1,58 @@
 #pragma once
 #include "core/Dataset.h"
+#include "BackgroundJob.h"
+#include "ProjectFormat.h"
 #include <QObject>
 #include <QString>
+#include <QThreadPool>
+#include <memory>
 
 namespace DatasetCreator {
 
 /**
  * @brief Manages project save/load operations
  * 
- * Handles serialization of Dataset to JSON files and deserialization back.
+ * Saves datasets in the binary project format (see ProjectFormat) and loads
+ * both binary and legacy JSON projects back. Loading decodes samples on a
+ * thread pool and reports loadProgress() as samples are added. Payloads in
+ * the blob store are not read while loading; samples refer to their blobs
+ * and decode them on first access, so a large project opens as fast as
+ * its sample index.
  * Project files have .dscp extension (DataSet Creator Project).
+ *
+ * With journaling on (the default), a full save attaches a DatasetJournal
+ * to the dataset, and later saves to the same file only append the recorded
+ * changes to <project>.journal (see ProjectJournal). Once the log grows past
+ * compactionThreshold() bytes, a snapshot of the dataset is written in the
+ * background and the log is trimmed to the entries made since.
+ *
+ * Payloads are kept inline, so a project file is self-contained. With a
+ * BlobStore set, large payloads are kept in the store instead and
+ * referenced by hash, so a snapshot only writes payloads the store does
+ * not have yet. Each snapshot records the project's references;
+ * unreferenced blobs are only removed when collectGarbage() is called.
+ *
+ * saveProjectAsync() and loadProjectAsync() run the same work as a
+ * BackgroundJob, one job at a time; synchronous calls wait for it first.
+ * The job's progress is also reported through saveProgress() and
+ * loadProgress().
  */
 class ProjectManager : public QObject {
     Q_OBJECT
 public:
     explicit ProjectManager(QObject* parent = nullptr);
+    ~ProjectManager();
     
     /**
      * @brief Save dataset to a project file
+     *
+     * Appends to the project's journal when the dataset carries one for
+     * this file; otherwise writes a full snapshot and attaches a new journal.
      * @param dataset The dataset to save
      * @param filePath Path to save the project file
      * @return true if save succeeded, false otherwise
      */
-    bool saveProject(const Dataset& dataset, const QString& filePath);
+    bool saveProject(Dataset& dataset, const QString& filePath);
     
     /**
      * @brief Load dataset from a project file
@@ -32,20 +62,83 @@ public:
      */
     bool loadProject(const QString& filePath, Dataset& dataset);
     
+    /**
+     * @brief Save in the background
+     *
+     * The snapshot shares the dataset's storage, so the dataset stays
+     * editable while it is written; edits made meanwhile go to the new
+     * journal. Cancelling keeps the previous project file. Emits
+     * projectSaved() or error() when the job finishes.
+     * @return The job, owned by this manager
+     */
+    BackgroundJob* saveProjectAsync(Dataset& dataset, const QString& filePath);
+    
+    /**
+     * @brief Load into dataset in the background
+     *
+     * The dataset must not be used until the job has finished. Emits
+     * projectLoaded() or error() when it does.
+     * @return The job, owned by this manager
+     */
+    BackgroundJob* loadProjectAsync(const QString& filePath, std::shared_ptr<Dataset> dataset);
+    
     /**
      * @brief Get the last error message
      */
     QString lastError() const { return lastError_; }
     
+    // Journaled saves
+    void setJournaling(bool enabled) { journaling_ = enabled; }
+    bool isJournaling() const { return journaling_; }
+    void setCompactionThreshold(qint64 bytes) { compactionThreshold_ = bytes; }
+    qint64 compactionThreshold() const { return compactionThreshold_; }
+    bool isCompacting() const { return compacting_; }
+    void waitForCompaction() { jobPool_.waitForDone(); }
+    
+    // Payload store, which must outlive this manager; nullptr keeps
+    // payloads inline in the project file
+    void setBlobStore(BlobStore* store) { blobStore_ = store; }
+    BlobStore* blobStore() const { return blobStore_; }
+    
+    /**
+     * @brief Remove the store's unreferenced blobs in the background
+     *
+     * Projects that were moved or deleted outside this application keep
+     * their blobs until BlobStore::removeReferences() is called for them.
+     */
+    void collectGarbage();
+
 signals:
     void saveProgress(int current, int total);
     void loadProgress(int current, int total);
     void projectSaved(const QString& filePath);
     void projectLoaded(const QString& filePath);
+    void projectCompacted(const QString& filePath);
     void error(const QString& error);
-    
+
 private:
+    bool appendToJournal(Dataset& dataset, const QString& filePath);
+    bool saveSnapshot(Dataset& dataset, const QString& filePath);
+    static bool writeSnapshot(const Dataset& dataset, const QString& filePath,
+                              const ProjectFormat::JournalBase& base, BlobStore* store,
+                              const ProgressCallback& progress, QString* error);
+    static bool readProject(const QString& filePath, Dataset& dataset, const BlobStore* store,
+                            bool journaling, const ProgressCallback& progress, QString* error);
+    static void attachJournal(Dataset& dataset, const QString& filePath, const ProjectFormat::JournalBase& base);
+    void startCompaction(const Dataset& dataset, const QString& filePath);
+    void finishCompaction(const QString& filePath, const ProjectFormat::JournalBase& base,
+                          bool ok, const QString& compactionError);
+    
     QString lastError_;
+    bool journaling_;
+    qint64 compactionThreshold_;
+    
+    // Background saves, loads, compaction and collection (one at a time)
+    QThreadPool jobPool_;
+    bool compacting_;
+    std::weak_ptr<DatasetJournal> compactingJournal_;
+    
+    BlobStore* blobStore_;
 };
 
 } // namespace DatasetCreator
@@ -3,6 +3,7 @@
 #include "readers/ImageReader.h"
 #include "readers/AudioReader.h"
 #include "readers/CSVReader.h"
+#include "readers/JSONLReader.h"
 #include "writers/JSONWriter.h"
 #include "writers/JSONLWriter.h"
 #include "writers/CSVWriter.h"
@@ -25,6 +26,7 @@ void PluginManager::loadBuiltInPlugins() {
     registerReader(std::make_unique<ImageReader>());
     registerReader(std::make_unique<AudioReader>());
     registerReader(std::make_unique<CSVReader>());
+    registerReader(std::make_unique<JSONLReader>());
     
     // Register built-in writers
     registerWriter(std::make_unique<JSONWriter>());
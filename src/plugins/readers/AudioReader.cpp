@@ -1,8 +1,263 @@
 #include "AudioReader.h"
-#include <QFileInfo>
+#include "core/Pcm.h"
+#include <QAudioBuffer>
+#include <QAudioDecoder>
+#include <QEventLoop>
+#include <QFile>
+#include <QUrl>
+#include <QtEndian>
+#include <algorithm>
+#include <cstring>
+#include <optional>
+#include <utility>
 
 namespace DatasetCreator {
 
+class AudioReader::Source {
+public:
+    virtual ~Source() = default;
+    virtual QAudioFormat format() const = 0;
+    virtual QByteArray read(qint64 maxFrames) = 0;   // Up to maxFrames, or all if negative; empty only at the end
+    virtual bool atEnd() const = 0;
+};
+
+namespace {
+
+constexpr qint64 minimumBlockFrames = 4096;
+
+enum WaveFormatTag : quint16 {
+    WavePcm = 0x0001,
+    WaveFloat = 0x0003,
+    WaveExtensible = 0xfffe
+};
+
+struct WavHeader {
+    QAudioFormat format;         // Of the samples read, which widens 24 bits and narrows 64
+    int bitsPerSample = 0;
+    int blockAlign = 0;
+    qsizetype dataOffset = 0;
+    qsizetype dataSize = 0;
+
+    qint64 frames() const { return dataSize / blockAlign; }
+};
+
+// The "fmt " and "data" chunks of a RIFF WAVE file with integer or float
+// samples; RF64 and compressed encodings are left to QAudioDecoder
+std::optional<WavHeader> parseWav(QByteArrayView data) {
+    if (data.size() < 12 || !data.startsWith("RIFF") || data.sliced(8, 4) != "WAVE") {
+        return std::nullopt;
+    }
+    const auto u16 = [&](qsizetype at) { return qFromLittleEndian<quint16>(data.data() + at); };
+    const auto u32 = [&](qsizetype at) { return qFromLittleEndian<quint32>(data.data() + at); };
+
+    WavHeader header;
+    quint16 tag = 0;
+    int channels = 0;
+    int rate = 0;
+    qsizetype at = 12;
+    while (at + 8 <= data.size()) {
+        const QByteArrayView id = data.sliced(at, 4);
+        const qint64 size = u32(at + 4);
+        const qsizetype body = at + 8;
+        if (id == "fmt " && size >= 16 && body + size <= data.size()) {
+            tag = u16(body);
+            channels = u16(body + 2);
+            rate = int(u32(body + 4));
+            header.blockAlign = u16(body + 12);
+            header.bitsPerSample = u16(body + 14);
+            if (tag == WaveExtensible && size >= 40) {
+                tag = u16(body + 24);    // First two bytes of the subformat GUID
+            }
+        } else if (id == "data") {
+            if (tag == 0) {
+                return std::nullopt;     // No format before the samples
+            }
+            header.dataOffset = body;
+            header.dataSize = qsizetype(std::min(size, qint64(data.size() - body)));   // Truncated files keep what is there
+            break;
+        }
+        at = body + size + (size & 1);
+    }
+
+    const int bits = header.bitsPerSample;
+    QAudioFormat::SampleFormat sampleFormat = QAudioFormat::Unknown;
+    if (tag == WavePcm) {
+        sampleFormat = bits == 8 ? QAudioFormat::UInt8
+            : bits == 16 ? QAudioFormat::Int16
+            : bits == 24 || bits == 32 ? QAudioFormat::Int32
+            : QAudioFormat::Unknown;
+    } else if (tag == WaveFloat && (bits == 32 || bits == 64)) {
+        sampleFormat = QAudioFormat::Float;
+    }
+    if (header.dataOffset == 0 || sampleFormat == QAudioFormat::Unknown || channels <= 0 || rate <= 0
+        || header.blockAlign != channels * bits / 8) {
+        return std::nullopt;
+    }
+
+    header.format.setSampleRate(rate);
+    header.format.setChannelCount(channels);
+    header.format.setSampleFormat(sampleFormat);
+    return header;
+}
+
+// The whole file, mapped if it can be, else read into buffer
+QByteArrayView contents(QFile& file, QByteArray& buffer) {
+    const qint64 size = file.size();
+    if (size > 0) {
+        if (const uchar* mapped = file.map(0, size)) {
+            return QByteArrayView(reinterpret_cast<const char*>(mapped), size);
+        }
+    }
+    buffer = file.readAll();
+    return buffer;
+}
+
+class WavSource : public AudioReader::Source {
+public:
+    bool open(const QString& filePath) {
+        file_.setFileName(filePath);
+        if (!file_.open(QIODevice::ReadOnly)) {
+            return false;
+        }
+        data_ = contents(file_, buffer_);
+        if (std::optional<WavHeader> header = parseWav(data_)) {
+            header_ = *header;
+            return true;
+        }
+        return false;
+    }
+
+    QAudioFormat format() const override { return header_.format; }
+    bool atEnd() const override { return frame_ >= header_.frames(); }
+
+    QByteArray read(qint64 maxFrames) override {
+        const qint64 left = header_.frames() - frame_;
+        const qint64 frames = maxFrames < 0 ? left : std::min(maxFrames, left);
+        const char* in = data_.data() + header_.dataOffset + frame_ * header_.blockAlign;
+        const qsizetype count = frames * header_.format.channelCount();
+        frame_ += frames;
+
+        if (header_.bitsPerSample == 24) {
+            // Into the top three bytes of an Int32
+            QByteArray pcm(count * 4, Qt::Uninitialized);
+            for (qsizetype i = 0; i < count; ++i) {
+                const quint32 sample = quint32(uchar(in[3 * i])) << 8 | quint32(uchar(in[3 * i + 1])) << 16
+                    | quint32(uchar(in[3 * i + 2])) << 24;
+                std::memcpy(pcm.data() + 4 * i, &sample, sizeof(sample));
+            }
+            return pcm;
+        }
+        if (header_.bitsPerSample == 64) {
+            QByteArray pcm(count * 4, Qt::Uninitialized);
+            for (qsizetype i = 0; i < count; ++i) {
+                double sample;
+                std::memcpy(&sample, in + 8 * i, sizeof(sample));
+                const float narrowed = float(sample);
+                std::memcpy(pcm.data() + 4 * i, &narrowed, sizeof(narrowed));
+            }
+            return pcm;
+        }
+        return QByteArray(in, frames * header_.blockAlign);
+    }
+
+private:
+    QFile file_;
+    QByteArray buffer_;          // Contents when the file cannot be mapped
+    QByteArrayView data_;
+    WavHeader header_;
+    qint64 frame_ = 0;
+};
+
+// QAudioDecoder driven by a local event loop. The decoder runs ahead of
+// the reads, so a long compressed file is held decoded in memory
+class DecoderSource : public AudioReader::Source {
+public:
+    ~DecoderSource() override { decoder_.stop(); }
+
+    bool open(const QString& filePath) {
+        QObject::connect(&decoder_, &QAudioDecoder::bufferReady, &decoder_, [this] {
+            while (decoder_.bufferAvailable()) {
+                const QAudioBuffer buffer = decoder_.read();
+                if (!format_.isValid()) {
+                    format_ = buffer.format();
+                }
+                // The backends keep one format per stream; anything else is dropped
+                if (buffer.format() == format_) {
+                    decoded_.append(buffer.constData<char>(), buffer.byteCount());
+                }
+            }
+            loop_.quit();
+        });
+        QObject::connect(&decoder_, &QAudioDecoder::finished, &decoder_, [this] {
+            finished_ = true;
+            loop_.quit();
+        });
+        QObject::connect(&decoder_, QOverload<QAudioDecoder::Error>::of(&QAudioDecoder::error), &decoder_,
+                         [this](QAudioDecoder::Error) {
+            finished_ = true;
+            loop_.quit();
+        });
+
+        decoder_.setSource(QUrl::fromLocalFile(filePath));
+        decoder_.start();
+        while (!format_.isValid() && !finished_) {
+            loop_.exec();
+        }
+        return format_.isValid();
+    }
+
+    QAudioFormat format() const override { return format_; }
+    bool atEnd() const override { return finished_ && head_ == decoded_.size(); }
+
+    QByteArray read(qint64 maxFrames) override {
+        const qsizetype frameBytes = format_.bytesPerFrame();
+        while (!finished_ && (maxFrames < 0 || decoded_.size() - head_ < maxFrames * frameBytes)) {
+            loop_.exec();
+        }
+        qsizetype size = (decoded_.size() - head_) / frameBytes * frameBytes;
+        if (maxFrames >= 0) {
+            size = std::min(size, qsizetype(maxFrames * frameBytes));
+        }
+        const QByteArray pcm = decoded_.mid(head_, size);
+        head_ += size;
+        if (head_ > decoded_.size() / 2) {
+            decoded_.remove(0, head_);
+            head_ = 0;
+        }
+
+        // Wait for more, so that atEnd() is true once nothing is left
+        while (!finished_ && head_ == decoded_.size()) {
+            loop_.exec();
+        }
+        if (finished_ && decoded_.size() - head_ < frameBytes) {
+            head_ = decoded_.size();     // A partial frame
+        }
+        return pcm;
+    }
+
+private:
+    QAudioDecoder decoder_;
+    QEventLoop loop_;
+    QAudioFormat format_;
+    QByteArray decoded_;
+    qsizetype head_ = 0;
+    bool finished_ = false;
+};
+
+void describe(DatasetSample& sample, const QFileInfo& info, const QDateTime& timestamp) {
+    sample.metadata().id = info.fileName();
+    sample.metadata().sourceFile = info.filePath();
+    sample.metadata().timestamp = timestamp;
+    sample.metadata().attributes["file_size"] = info.size();
+    sample.metadata().attributes["file_extension"] = info.suffix();
+}
+
+} // namespace
+
+AudioReader::AudioReader() = default;
+
+AudioReader::~AudioReader() = default;
+
 bool AudioReader::canRead(const QString& filePath) const {
     QFileInfo info(filePath);
     QString ext = "." + info.suffix().toLower();
@@ -10,11 +265,18 @@ bool AudioReader::canRead(const QString& filePath) const {
 }
 
 DatasetSample AudioReader::read(const QString& filePath) {
+    AudioReader reader;
+    reader.options_ = options_;
+    reader.options_.remove("chunk_ms");
+    if (reader.beginRead(filePath)) {
+        DatasetSample sample = reader.readNext();
+        reader.endRead();
+        return sample;
+    }
+
+    // Not decodable: the sample still records the file
     DatasetSample sample(SampleType::Audio);
-    sample.metadata().id = QFileInfo(filePath).fileName();
-    sample.metadata().sourceFile = filePath;
-    sample.metadata().timestamp = QDateTime::currentDateTime();
-    // TODO: Implement audio decoding with QAudioDecoder
+    describe(sample, QFileInfo(filePath), QDateTime::currentDateTime());
     return sample;
 }
 
@@ -28,8 +290,142 @@ QList<DatasetSample> AudioReader::readBatch(const QStringList& files) {
 
 QVariantMap AudioReader::extractMetadata(const QString& filePath) {
     QVariantMap meta;
-    meta["file_name"] = QFileInfo(filePath).fileName();
+    QFileInfo info(filePath);
+    meta["file_name"] = info.fileName();
+    meta["file_size"] = info.size();
+    meta["extension"] = info.suffix();
+
+    QFile file(filePath);
+    QByteArray buffer;
+    if (file.open(QIODevice::ReadOnly)) {
+        if (std::optional<WavHeader> header = parseWav(contents(file, buffer))) {
+            meta["sample_rate"] = header->format.sampleRate();
+            meta["channels"] = header->format.channelCount();
+            meta["bits_per_sample"] = header->bitsPerSample;
+            meta["duration_ms"] = header->frames() * 1000 / header->format.sampleRate();
+        }
+    }
     return meta;
 }
 
+QAudioFormat AudioReader::targetFormat(const QAudioFormat& source) const {
+    QAudioFormat format = source;
+    if (const int rate = option("sample_rate").toInt(); rate > 0) {
+        format.setSampleRate(rate);
+    }
+    if (const int channels = option("channels").toInt(); channels > 0) {
+        format.setChannelCount(channels);
+    }
+    const QString sampleFormat = option("sample_format").toString();
+    if (sampleFormat == "uint8") {
+        format.setSampleFormat(QAudioFormat::UInt8);
+    } else if (sampleFormat == "int16") {
+        format.setSampleFormat(QAudioFormat::Int16);
+    } else if (sampleFormat == "int32") {
+        format.setSampleFormat(QAudioFormat::Int32);
+    } else if (sampleFormat == "float") {
+        format.setSampleFormat(QAudioFormat::Float);
+    }
+    return format;
+}
+
+bool AudioReader::beginRead(const QString& filePath) {
+    endRead();
+
+    auto wav = std::make_unique<WavSource>();
+    if (wav->open(filePath)) {
+        source_ = std::move(wav);
+    } else {
+        auto decoder = std::make_unique<DecoderSource>();
+        if (!decoder->open(filePath)) {
+            return false;
+        }
+        source_ = std::move(decoder);
+    }
+
+    const QAudioFormat from = source_->format();
+    format_ = targetFormat(from);
+    converter_ = std::make_unique<PcmConverter>(from, format_);
+    info_ = QFileInfo(filePath);
+    timestamp_ = QDateTime::currentDateTime();
+
+    const qint64 chunkMs = option("chunk_ms").toLongLong();
+    chunkFrames_ = chunkMs > 0 ? std::max<qint64>(1, chunkMs * format_.sampleRate() / 1000) : 0;
+    blockFrames_ = chunkMs > 0 ? std::max(minimumBlockFrames, chunkMs * from.sampleRate() / 1000) : -1;
+    framesOut_ = 0;
+    pending_.clear();
+    chunk_ = 0;
+    drained_ = false;
+    done_ = false;
+    return true;
+}
+
+DatasetSample AudioReader::readNext() {
+    DatasetSample sample(SampleType::Audio);
+    if (done_) {
+        return sample;
+    }
+
+    const qsizetype frameBytes = format_.bytesPerFrame();
+    const qsizetype wanted = chunkFrames_ * frameBytes;
+    const auto fill = [&] {
+        while (!drained_ && (chunkFrames_ == 0 || pending_.size() < wanted)) {
+            if (source_->atEnd()) {
+                pending_ += converter_->flush();
+                drained_ = true;
+            } else {
+                pending_ += converter_->convert(source_->read(blockFrames_));
+            }
+        }
+    };
+    fill();
+
+    AudioData audio;
+    audio.format = format_;
+    if (chunkFrames_ == 0 || pending_.size() <= wanted) {
+        audio.samples = std::exchange(pending_, QByteArray());
+    } else {
+        audio.samples = pending_.first(wanted);
+        pending_.remove(0, wanted);
+    }
+    const qint64 frames = audio.samples.size() / frameBytes;
+    audio.durationMs = frames * 1000 / format_.sampleRate();
+    sample.setAudio(audio);
+
+    describe(sample, info_, timestamp_);
+    if (chunkFrames_ > 0) {
+        sample.metadata().id = QString("%1:%2").arg(info_.fileName()).arg(++chunk_);
+        sample.metadata().attributes["offset_ms"] = framesOut_ * 1000 / format_.sampleRate();
+    }
+    framesOut_ += frames;
+
+    // Look ahead so that a chunk ending with the file is the last
+    if (pending_.isEmpty()) {
+        fill();
+    }
+    done_ = drained_ && pending_.isEmpty();
+    return sample;
+}
+
+bool AudioReader::endRead() {
+    const bool wasOpen = source_ != nullptr;
+    converter_.reset();
+    source_.reset();     // Unmaps the file or stops the decoder
+    pending_.clear();
+    drained_ = true;
+    done_ = true;
+    return wasOpen;
+}
+
+void AudioReader::setOption(const QString& key, const QVariant& value) {
+    options_.insert(key, value);
+}
+
+QVariant AudioReader::option(const QString& key) const {
+    if (key == "sample_rate" || key == "channels" || key == "chunk_ms") {
+        return options_.value(key, 0);
+    }
+    return options_.value(key);
+}
+
 }
@@ -1,17 +1,87 @@
 #pragma once
+
 #include "core/PluginInterface.h"
+#include <QAudioFormat>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QVariantMap>
+#include <memory>
 
 namespace DatasetCreator {
+
+class PcmConverter;
+
+/**
+ * @brief Reads audio files as PCM
+ *
+ * WAV files are parsed from a memory mapping and their samples copied out
+ * as they are; other formats are decoded with QAudioDecoder. The samples
+ * can be converted to another rate, channel count or sample format on the
+ * way (see PcmConverter), and long files streamed in chunks of a fixed
+ * duration. Decoding blocks the calling thread, which need not be the GUI
+ * thread; a streamed read must stay on the thread that began it.
+ */
 class AudioReader : public IDataReader {
 public:
+    AudioReader();
+    ~AudioReader() override;
+
     QString name() const override { return "AudioReader"; }
-    QString version() const override { return "1.0.0"; }
+    QString version() const override { return "1.1.0"; }
     QStringList supportedExtensions() const override { return {".mp3", ".wav", ".ogg", ".flac"}; }
     QStringList supportedMimeTypes() const override { return {"audio/mpeg", "audio/wav", "audio/ogg"}; }
     bool canRead(QIODevice* device) const override { Q_UNUSED(device); return false; }
     bool canRead(const QString& filePath) const override;
     DatasetSample read(const QString& filePath) override;
     QList<DatasetSample> readBatch(const QStringList& files) override;
+    bool isReentrant() const override { return true; }
+
+    // "file_name", "file_size", "extension" and, for WAV files,
+    // "sample_rate", "channels", "bits_per_sample" and "duration_ms"
     QVariantMap extractMetadata(const QString& filePath) override;
+
+    // Without "chunk_ms", one sample holding the whole file, as read()
+    // returns it. With it, one sample per chunk; ids are "<file name>:<chunk>",
+    // counting from 1, and the attribute "offset_ms" gives where it starts
+    bool supportsStreaming() const override { return true; }
+    bool beginRead(const QString& filePath) override;
+    DatasetSample readNext() override;
+    bool atEnd() const override { return done_; }
+    bool endRead() override;
+
+    // "sample_rate", "channels": of the samples (default 0, as in the file);
+    // "sample_format": "uint8", "int16", "int32" or "float" (default empty,
+    // as decoded); "chunk_ms": duration of each streamed sample (default 0,
+    // the whole file)
+    void setOption(const QString& key, const QVariant& value) override;
+    QVariant option(const QString& key) const override;
+
+    std::unique_ptr<IDataReader> clone() const override {
+        auto reader = std::make_unique<AudioReader>();
+        reader->options_ = options_;
+        return reader;
+    }
+
+    class Source;   // Decoded PCM in whole frames
+
+private:
+    QAudioFormat targetFormat(const QAudioFormat& source) const;
+
+    QVariantMap options_;
+
+    // Streamed read in progress
+    std::unique_ptr<Source> source_;
+    std::unique_ptr<PcmConverter> converter_;
+    QAudioFormat format_;        // Of the samples
+    QFileInfo info_;
+    QDateTime timestamp_;
+    qint64 chunkFrames_ = 0;     // Per sample, 0 for the whole file
+    qint64 blockFrames_ = -1;    // Read from the source at a time, -1 for all
+    qint64 framesOut_ = 0;
+    QByteArray pending_;         // Converted, not yet returned
+    int chunk_ = 0;
+    bool drained_ = true;        // Source read and converter flushed
+    bool done_ = true;
 };
+
 }
@@ -1,10 +1,232 @@
 #include "CSVReader.h"
 #include <QFile>
-#include <QTextStream>
 #include <QFileInfo>
+#include <bit>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 namespace DatasetCreator {
 
+namespace {
+
+constexpr qint64 defaultChunkSize = 4 * 1024 * 1024;
+
+// Offset just past the last line break outside quotes in [data, data + size),
+// or 0 if there is none. inQuotes carries the quote state in and out; rows
+// is increased by the number of line breaks up to the returned offset.
+qsizetype findLastRowEnd(const char* data, qsizetype size, bool& inQuotes, qint64& rows) {
+    qsizetype last = 0;
+    qsizetype i = 0;
+#if defined(__SSE2__)
+    for (; size - i >= 16; i += 16) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        const unsigned quotes = unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_set1_epi8('"'))));
+        const unsigned newlines = unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_set1_epi8('\n'))));
+
+        // Prefix XOR: bit k is set when an odd number of quotes precede byte k
+        unsigned inside = quotes;
+        inside ^= inside << 1;
+        inside ^= inside << 2;
+        inside ^= inside << 4;
+        inside ^= inside << 8;
+        if (inQuotes) inside = ~inside;
+
+        const unsigned breaks = newlines & ~inside & 0xffff;
+        if (breaks) {
+            rows += std::popcount(breaks);
+            last = i + std::bit_width(breaks);
+        }
+        inQuotes ^= (std::popcount(quotes) & 1) != 0;
+    }
+#endif
+    for (; i < size; ++i) {
+        if (data[i] == '"') {
+            inQuotes = !inQuotes;
+        } else if (data[i] == '\n' && !inQuotes) {
+            ++rows;
+            last = i + 1;
+        }
+    }
+    return last;
+}
+
+// Next delimiter, quote or line break at or after p
+const char* findSpecial(const char* p, const char* end, char delimiter) {
+#if defined(__SSE2__)
+    const __m128i delimiters = _mm_set1_epi8(delimiter);
+    while (end - p >= 16) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const __m128i special = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(block, delimiters), _mm_cmpeq_epi8(block, _mm_set1_epi8('"'))),
+            _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(block, _mm_set1_epi8('\r'))));
+        const unsigned mask = unsigned(_mm_movemask_epi8(special));
+        if (mask) {
+            return p + std::countr_zero(mask);
+        }
+        p += 16;
+    }
+#endif
+    while (p != end && *p != delimiter && *p != '"' && *p != '\n' && *p != '\r') {
+        ++p;
+    }
+    return p;
+}
+
+// Split the row at p into fields, unescaping quoted text in place so every
+// field is a view into the buffer; returns the position after the row's
+// line break (\n or \r\n), or end. Quotes toggle quoting wherever they
+// appear, matching findLastRowEnd(); "" inside quotes is a literal quote.
+char* splitRow(char* p, char* const end, char delimiter, QList<QByteArrayView>& fields) {
+    fields.clear();
+    char* fieldStart = p;
+    char* out = p;
+    bool quoted = false;
+
+    while (p != end) {
+        char* stop = quoted ? static_cast<char*>(std::memchr(p, '"', end - p))
+                            : const_cast<char*>(findSpecial(p, end, delimiter));
+        if (!stop) stop = end;
+        if (out != p) std::memmove(out, p, stop - p);
+        out += stop - p;
+        p = stop;
+        if (p == end) break;
+
+        const char c = *p++;
+        if (quoted) {
+            if (p != end && *p == '"') {
+                *out++ = '"';
+                ++p;
+            } else {
+                quoted = false;
+            }
+        } else if (c == delimiter) {
+            fields.append(QByteArrayView(fieldStart, out - fieldStart));
+            fieldStart = out = p;
+        } else if (c == '"') {
+            quoted = true;
+        } else if (c == '\n') {
+            break;
+        } else if (p == end || *p == '\n') {
+            // \r\n, or a \r ending the file
+            if (p != end) ++p;
+            break;
+        } else {
+            *out++ = '\r';
+        }
+    }
+
+    fields.append(QByteArrayView(fieldStart, out - fieldStart));
+    return p;
+}
+
+// Length of the first row, or -1 if it does not end in data
+qsizetype firstRowLength(const QByteArray& data) {
+    bool quoted = false;
+    for (qsizetype i = 0; i < data.size(); ++i) {
+        if (data[i] == '"') {
+            quoted = !quoted;
+        } else if (data[i] == '\n' && !quoted) {
+            return i + 1;
+        }
+    }
+    return -1;
+}
+
+// Column given by header name or zero-based index, or -1
+int resolveColumn(const QVariant& value, const QStringList& names) {
+    if (!value.isValid()) return -1;
+    if (value.typeId() == QMetaType::Int || value.typeId() == QMetaType::LongLong) {
+        return value.toInt();
+    }
+    const QString name = value.toString();
+    const int index = names.indexOf(name);
+    if (index >= 0) return index;
+    bool ok = false;
+    const int number = name.toInt(&ok);
+    return ok && number >= 0 ? number : -1;
+}
+
+QVariantList columnList(const QVariant& value) {
+    return value.typeId() == QMetaType::QVariantList || value.typeId() == QMetaType::QStringList
+        ? value.toList() : QVariantList{value};
+}
+
+} // namespace
+
+struct CSVReader::Layout {
+    char delimiter = ',';
+    QStringList names;          // Header, if any
+    int textColumn = 0;
+    int idColumn = -1;
+    QList<int> labelColumns;
+    QList<int> attributeColumns;
+    bool otherAttributes = true;    // Every column not used otherwise
+    QString fileName;
+    QString sourceFile;
+    QDateTime timestamp;
+
+    QString columnName(int column) const {
+        return column < names.size() ? names.at(column) : QString("column_%1").arg(column);
+    }
+
+    bool isUsed(int column) const {
+        return column == textColumn || column == idColumn || labelColumns.contains(column);
+    }
+
+    DatasetSample makeSample(const QList<QByteArrayView>& fields, qint64 row) const {
+        DatasetSample sample(SampleType::Text);
+        SampleMetadata& meta = sample.metadata();
+
+        if (textColumn < fields.size()) {
+            sample.setText(Utf8Text::fromUtf8(fields.at(textColumn)));
+        }
+        meta.id = idColumn >= 0 && idColumn < fields.size()
+            ? QString::fromUtf8(fields.at(idColumn))
+            : fileName + ':' + QString::number(row);
+        for (int column : labelColumns) {
+            if (column < fields.size()) {
+                meta.labels.insert(columnName(column), QString::fromUtf8(fields.at(column)));
+            }
+        }
+        if (otherAttributes) {
+            for (int column = 0; column < fields.size(); ++column) {
+                if (!isUsed(column)) {
+                    meta.attributes.insert(columnName(column), QString::fromUtf8(fields.at(column)));
+                }
+            }
+        } else {
+            for (int column : attributeColumns) {
+                if (column < fields.size()) {
+                    meta.attributes.insert(columnName(column), QString::fromUtf8(fields.at(column)));
+                }
+            }
+        }
+        meta.sourceFile = sourceFile;
+        meta.timestamp = timestamp;
+        return sample;
+    }
+
+    QList<DatasetSample> parse(QByteArray chunk, qint64 firstRow) const {
+        QList<DatasetSample> samples;
+        QList<QByteArrayView> fields;
+        char* p = chunk.data();
+        char* const end = p + chunk.size();
+        qint64 row = firstRow;
+        while (p != end) {
+            p = splitRow(p, end, delimiter, fields);
+            const qint64 number = row++;
+            if (fields.size() == 1 && fields.first().isEmpty()) {
+                continue;  // Blank line
+            }
+            samples.append(makeSample(fields, number));
+        }
+        return samples;
+    }
+};
+
 bool CSVReader::canRead(const QString& filePath) const {
     QFileInfo info(filePath);
     QString ext = "." + info.suffix().toLower();
@@ -14,9 +236,8 @@ bool CSVReader::canRead(const QString& filePath) const {
 DatasetSample CSVReader::read(const QString& filePath) {
     DatasetSample sample(SampleType::Text);
     QFile file(filePath);
-    if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        QTextStream in(&file);
-        sample.setText(in.readAll());
+    if (file.open(QIODevice::ReadOnly)) {
+        sample.setText(Utf8Text::fromTextFile(file.readAll()));
     }
     sample.metadata().id = QFileInfo(filePath).fileName();
     sample.metadata().sourceFile = filePath;
@@ -38,4 +259,121 @@ QVariantMap CSVReader::extractMetadata(const QString& filePath) {
     return meta;
 }
 
+bool CSVReader::beginRead(const QString& filePath) {
+    endRead();
+
+    file_ = std::make_unique<QFile>(filePath);
+    if (!file_->open(QIODevice::ReadOnly)) {
+        file_.reset();
+        return false;
+    }
+    if (file_->peek(3) == "\xEF\xBB\xBF") {
+        file_->read(3);  // UTF-8 byte order mark
+    }
+
+    auto layout = std::make_shared<Layout>();
+    const QString delimiter = options_.value("delimiter").toString();
+    if (!delimiter.isEmpty()) {
+        layout->delimiter = delimiter.at(0).toLatin1();
+    } else if (QFileInfo(filePath).suffix().compare("tsv", Qt::CaseInsensitive) == 0) {
+        layout->delimiter = '\t';
+    }
+    layout->fileName = QFileInfo(filePath).fileName();
+    layout->sourceFile = filePath;
+    layout->timestamp = QDateTime::currentDateTime();
+    QByteArray pending;
+    if (option("has_header").toBool()) {
+        layout->names = readHeader(layout->delimiter, pending);
+    }
+
+    const QStringList& names = layout->names;
+    layout->textColumn = options_.contains("text_column")
+        ? resolveColumn(options_.value("text_column"), names)
+        : qMax(0, names.indexOf("text"));
+    layout->idColumn = resolveColumn(options_.value("id_column"), names);
+    if (options_.contains("label_columns")) {
+        for (const QVariant& column : columnList(options_.value("label_columns"))) {
+            const int index = resolveColumn(column, names);
+            if (index >= 0) layout->labelColumns.append(index);
+        }
+    } else if (names.contains("label")) {
+        layout->labelColumns.append(names.indexOf("label"));
+    }
+    if (options_.contains("attribute_columns")) {
+        layout->otherAttributes = false;
+        for (const QVariant& column : columnList(options_.value("attribute_columns"))) {
+            const int index = resolveColumn(column, names);
+            if (index >= 0) layout->attributeColumns.append(index);
+        }
+    }
+    if (layout->textColumn < 0) {
+        endRead();
+        return false;
+    }
+
+    // Quote state carries over while no row end is found; a cut always
+    // falls outside quotes, and the bytes after it are scanned again
+    auto split = [inQuotes = false](const char* data, qsizetype size, qint64& rows) mutable {
+        const qsizetype cut = findLastRowEnd(data, size, inQuotes, rows);
+        if (cut > 0) inQuotes = false;
+        return cut;
+    };
+    auto parse = [layout = std::shared_ptr<const Layout>(layout)](QByteArray chunk, qint64 firstRow) {
+        return layout->parse(std::move(chunk), firstRow);
+    };
+    rows_.start(file_.get(), std::move(pending), option("chunk_size").toLongLong(), 1, split, parse);
+    return true;
+}
+
+QStringList CSVReader::readHeader(char delimiter, QByteArray& pending) {
+    qsizetype length = -1;
+    while ((length = firstRowLength(pending)) < 0) {
+        const QByteArray data = file_->read(64 * 1024);
+        if (data.isEmpty()) {
+            length = pending.size();
+            break;
+        }
+        pending.append(data);
+    }
+
+    QList<QByteArrayView> fields;
+    splitRow(pending.data(), pending.data() + length, delimiter, fields);
+
+    QStringList names;
+    for (const QByteArrayView& field : fields) {
+        names.append(QString::fromUtf8(field));
+    }
+    pending.remove(0, length);
+    return names;
+}
+
+DatasetSample CSVReader::readNext() {
+    return rows_.next();
+}
+
+bool CSVReader::atEnd() const {
+    return rows_.atEnd();
+}
+
+bool CSVReader::endRead() {
+    rows_.clear();
+    const bool wasOpen = file_ != nullptr;
+    file_.reset();
+    return wasOpen;
+}
+
+void CSVReader::setOption(const QString& key, const QVariant& value) {
+    options_.insert(key, value);
+}
+
+QVariant CSVReader::option(const QString& key) const {
+    if (key == "has_header") {
+        return options_.value(key, true);
+    }
+    if (key == "chunk_size") {
+        return options_.value(key, defaultChunkSize);
+    }
+    return options_.value(key);
+}
+
 }
@@ -1,17 +1,67 @@
 #pragma once
+#include "ChunkQueue.h"
 #include "core/PluginInterface.h"
+#include <QFile>
+#include <QVariantMap>
+#include <memory>
 
 namespace DatasetCreator {
+
+/**
+ * @brief Reads CSV and TSV files
+ *
+ * read() returns the whole file as one text sample. The streaming calls
+ * return one text sample per row instead: RFC 4180 quoting is honoured,
+ * columns are mapped to the text, the labels and the attributes by the
+ * options below, and the file is read in chunks that are split into
+ * fields on the global thread pool. At most a few chunks are held at once,
+ * so memory does not grow with the file.
+ */
 class CSVReader : public IDataReader {
 public:
     QString name() const override { return "CSVReader"; }
-    QString version() const override { return "1.0.0"; }
+    QString version() const override { return "1.1.0"; }
     QStringList supportedExtensions() const override { return {".csv", ".tsv"}; }
     QStringList supportedMimeTypes() const override { return {"text/csv"}; }
     bool canRead(QIODevice* device) const override { Q_UNUSED(device); return true; }
     bool canRead(const QString& filePath) const override;
     DatasetSample read(const QString& filePath) override;
     QList<DatasetSample> readBatch(const QStringList& files) override;
+    bool isReentrant() const override { return true; }
     QVariantMap extractMetadata(const QString& filePath) override;
+
+    // One sample per row; ids are "<file name>:<row>", counting data rows from 1
+    bool supportsStreaming() const override { return true; }
+    bool beginRead(const QString& filePath) override;
+    DatasetSample readNext() override;
+    bool atEnd() const override;
+    bool endRead() override;
+
+    // Columns are given by header name or zero-based index:
+    // "delimiter" (default "," or tab for .tsv), "has_header" (default true),
+    // "text_column" (default "text" if present, else the first column),
+    // "id_column" (default none), "label_columns" (default "label" if present),
+    // "attribute_columns" (default every other column),
+    // "chunk_size" (bytes per parallel chunk, default 4 MiB)
+    void setOption(const QString& key, const QVariant& value) override;
+    QVariant option(const QString& key) const override;
+
+    std::unique_ptr<IDataReader> clone() const override {
+        auto reader = std::make_unique<CSVReader>();
+        reader->options_ = options_;
+        return reader;
+    }
+
+private:
+    struct Layout;
+
+    QStringList readHeader(char delimiter, QByteArray& pending);     // Column names from the first row
+
+    QVariantMap options_;
+
+    // Streamed read in progress
+    std::unique_ptr<QFile> file_;
+    ChunkQueue<DatasetSample> rows_;
 };
+
 }
@@ -0,0 +1,155 @@
+#pragma once
+#include <QByteArray>
+#include <QIODevice>
+#include <QList>
+#include <QThread>
+#include <QThreadPool>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+
+namespace DatasetCreator {
+
+/**
+ * @brief Parses a file in record-aligned chunks on the global thread pool
+ *
+ * The device is read chunkSize bytes at a time and cut after the last
+ * whole record; the records before the cut are parsed on a worker thread.
+ * About one chunk per core is in flight and items are handed out in file
+ * order, so memory is bounded by that window, not by the file. A record
+ * longer than a chunk makes its chunk grow until the record fits.
+ */
+template <typename T>
+class ChunkQueue {
+public:
+    // Offset just past the last whole record in data, or 0 if there is
+    // none; adds the number of records before it to records
+    using Split = std::function<qsizetype(const char* data, qsizetype size, qint64& records)>;
+    // Items of a chunk whose first record has the given number (worker thread)
+    using Parse = std::function<QList<T>(QByteArray chunk, qint64 firstRecord)>;
+
+    ChunkQueue() = default;
+    ChunkQueue(const ChunkQueue&) = delete;
+    ChunkQueue& operator=(const ChunkQueue&) = delete;
+    ~ChunkQueue() { clear(); }
+
+    /**
+     * @brief Start on the rest of device, after bytes the caller already read
+     */
+    void start(QIODevice* device, QByteArray pending, qint64 chunkSize, qint64 firstRecord,
+               Split split, Parse parse) {
+        clear();
+        device_ = device;
+        carry_ = std::move(pending);
+        chunkSize_ = qMax<qint64>(1024, chunkSize);
+        nextRecord_ = firstRecord;
+        split_ = std::move(split);
+        parse_ = std::move(parse);
+        fill();
+        advance();
+    }
+
+    bool atEnd() const { return next_ >= items_.size(); }
+
+    T next() {
+        if (atEnd()) {
+            return T();
+        }
+        T item = std::move(items_[next_++]);
+        advance();
+        return item;
+    }
+
+    void clear() {
+        // Chunks not yet started are skipped; running ones own their data
+        for (const auto& chunk : window_) {
+            chunk->claimed = true;
+        }
+        window_.clear();
+        items_.clear();
+        next_ = 0;
+        carry_.clear();
+        scanned_ = 0;
+        device_ = nullptr;
+    }
+
+private:
+    // Parsed by whichever of the pool and the consumer gets to it first
+    struct Chunk {
+        std::atomic<bool> claimed{false};
+        std::packaged_task<QList<T>()> parse;
+        std::future<QList<T>> items;
+
+        void run() {
+            if (!claimed.exchange(true)) parse();
+        }
+    };
+
+    void fill() {
+        const qsizetype maxChunks = qMax(2, QThread::idealThreadCount());
+
+        while (device_ && qsizetype(window_.size()) < maxChunks) {
+            const QByteArray data = device_->read(chunkSize_);
+            qsizetype end = carry_.size();
+            qint64 records = 0;
+            if (data.isEmpty()) {
+                device_ = nullptr;
+                if (carry_.isEmpty()) break;
+            } else {
+                carry_.append(data);
+                const qsizetype cut = split_(carry_.constData() + scanned_, carry_.size() - scanned_, records);
+                if (cut == 0) {
+                    scanned_ = carry_.size();
+                    continue;
+                }
+                end = scanned_ + cut;
+            }
+
+            QByteArray chunk = std::move(carry_);
+            carry_ = chunk.mid(end);
+            chunk.truncate(end);
+            scanned_ = 0;
+
+            auto task = std::make_shared<Chunk>();
+            task->parse = std::packaged_task<QList<T>()>(
+                [parse = parse_, chunk = std::move(chunk), first = nextRecord_]() mutable {
+                    return parse(std::move(chunk), first);
+                });
+            task->items = task->parse.get_future();
+            window_.push_back(task);
+            nextRecord_ += records;
+            QThreadPool::globalInstance()->start([task]() { task->run(); });
+        }
+    }
+
+    void advance() {
+        while (next_ >= items_.size()) {
+            items_.clear();
+            next_ = 0;
+            if (window_.empty()) {
+                return;
+            }
+
+            std::shared_ptr<Chunk> chunk = window_.front();
+            window_.pop_front();
+            fill();
+            chunk->run();  // Parse here if no pool thread has started it
+            items_ = chunk->items.get();
+        }
+    }
+
+    QIODevice* device_ = nullptr;   // Null once the end is reached
+    qint64 chunkSize_ = 0;
+    Split split_;
+    Parse parse_;
+    QByteArray carry_;          // Bytes not yet handed to a chunk
+    qsizetype scanned_ = 0;     // Bytes of carry_ known to hold no record end
+    qint64 nextRecord_ = 0;     // Number of the first record in carry_
+    std::deque<std::shared_ptr<Chunk>> window_;     // Chunks being parsed, in file order
+    QList<T> items_;            // Parsed chunk being handed out
+    qsizetype next_ = 0;
+};
+
+}
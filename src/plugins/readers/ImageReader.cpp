@@ -31,13 +31,26 @@ bool ImageReader::canRead(const QString& filePath) const {
 DatasetSample ImageReader::read(const QString& filePath) {
     DatasetSample sample(SampleType::Image);
     QImageReader reader(filePath);
-    QImage image = reader.read();
-    sample.setImage(image);
+    QSize size = reader.size();
+    
+    // Formats that cannot report their size without decoding are read eagerly
+    if (lazyDecode_ && size.isValid()) {
+        PayloadSource source;
+        source.path = filePath;
+        source.format = reader.format();
+        source.decodedSize = qint64(size.width()) * size.height() * 4;
+        sample.setSource(SampleType::Image, source);
+    } else {
+        QImage image = reader.read();
+        sample.setImage(image);
+        size = image.size();
+    }
+    
     sample.metadata().id = QFileInfo(filePath).fileName();
     sample.metadata().sourceFile = filePath;
     sample.metadata().timestamp = QDateTime::currentDateTime();
-    sample.metadata().attributes["width"] = image.width();
-    sample.metadata().attributes["height"] = image.height();
+    sample.metadata().attributes["width"] = size.width();
+    sample.metadata().attributes["height"] = size.height();
     sample.metadata().attributes["format"] = reader.format();
     return sample;
 }
@@ -50,6 +63,19 @@ QList<DatasetSample> ImageReader::readBatch(const QStringList& files) {
     return samples;
 }
 
+void ImageReader::setOption(const QString& key, const QVariant& value) {
+    if (key == "lazy_decode") {
+        lazyDecode_ = value.toBool();
+    }
+}
+
+QVariant ImageReader::option(const QString& key) const {
+    if (key == "lazy_decode") {
+        return lazyDecode_;
+    }
+    return QVariant();
+}
+
 QVariantMap ImageReader::extractMetadata(const QString& filePath) {
     QVariantMap meta;
     QImageReader reader(filePath);
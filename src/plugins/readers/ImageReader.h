@@ -12,6 +12,14 @@ public:
     bool canRead(const QString& filePath) const override;
     DatasetSample read(const QString& filePath) override;
     QList<DatasetSample> readBatch(const QStringList& files) override;
+    bool isReentrant() const override { return true; }
     QVariantMap extractMetadata(const QString& filePath) override;
+    
+    // "lazy_decode" (default true): read only the header and decode pixels on access
+    void setOption(const QString& key, const QVariant& value) override;
+    QVariant option(const QString& key) const override;
+
+private:
+    bool lazyDecode_ = true;
 };
 }
@@ -0,0 +1,175 @@
+#include "JSONLReader.h"
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+
+namespace DatasetCreator {
+
+namespace {
+
+constexpr qint64 defaultChunkSize = 4 * 1024 * 1024;
+
+// JSON strings cannot hold a raw line break, so every '\n' ends a record
+qsizetype findLastLineEnd(const char* data, qsizetype size, qint64& lines) {
+    const std::string_view text(data, size);
+    const std::size_t last = text.rfind('\n');
+    if (last == std::string_view::npos) {
+        return 0;
+    }
+    lines += std::count(text.begin(), text.begin() + last + 1, '\n');
+    return qsizetype(last) + 1;
+}
+
+} // namespace
+
+bool JSONLReader::canRead(QIODevice* device) const {
+    return device && device->peek(1) == "{";
+}
+
+bool JSONLReader::canRead(const QString& filePath) const {
+    QFileInfo info(filePath);
+    QString ext = "." + info.suffix().toLower();
+    return supportedExtensions().contains(ext);
+}
+
+DatasetSample JSONLReader::read(const QString& filePath) {
+    JSONLReader reader;
+    reader.options_ = options_;
+    DatasetSample sample;
+    if (reader.beginRead(filePath)) {
+        sample = reader.readNext();
+        reader.endRead();
+    }
+    return sample;
+}
+
+QList<DatasetSample> JSONLReader::readBatch(const QStringList& files) {
+    QList<DatasetSample> samples;
+    for (const QString& file : files) {
+        samples.append(read(file));
+    }
+    return samples;
+}
+
+QVariantMap JSONLReader::extractMetadata(const QString& filePath) {
+    QVariantMap meta;
+    meta["file_name"] = QFileInfo(filePath).fileName();
+
+    QFile file(filePath);
+    QByteArray pending;
+    DatasetMetadata metadata;
+    if (file.open(QIODevice::ReadOnly) && readMetaLine(file, pending, &metadata)) {
+        meta["dataset"] = metadata.toVariantMap();
+    }
+    return meta;
+}
+
+bool JSONLReader::readMetaLine(QIODevice& device, QByteArray& pending, DatasetMetadata* metadata) {
+    // The first line, which is kept in pending unless it is the header
+    pending = device.readLine();
+    const QJsonObject object = QJsonDocument::fromJson(pending).object();
+    if (!object.contains("_meta")) {
+        return false;
+    }
+    *metadata = DatasetMetadata::fromVariantMap(object.value("_meta").toObject().toVariantMap());
+    pending.clear();
+    return true;
+}
+
+QList<JSONLReader::Record> JSONLReader::parseLines(const QByteArray& chunk, const BlobStore* store,
+                                                   std::atomic<qint64>& malformed) {
+    QList<Record> records;
+    const char* p = chunk.constData();
+    const char* const end = p + chunk.size();
+    while (p != end) {
+        const char* newline = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        const char* const lineEnd = newline ? newline : end;
+        const QByteArray line = QByteArray::fromRawData(p, lineEnd - p);
+        p = newline ? newline + 1 : end;
+
+        // Blank lines and a repeated header are skipped; malformed lines too,
+        // but they are counted
+        if (line.trimmed().isEmpty()) {
+            continue;
+        }
+        QJsonParseError error;
+        const QJsonDocument document = QJsonDocument::fromJson(line, &error);
+        if (error.error != QJsonParseError::NoError || !document.isObject()) {
+            ++malformed;
+            continue;
+        }
+        QVariantMap map = document.object().toVariantMap();
+        if (map.contains("_meta")) {
+            continue;
+        }
+
+        Record record;
+        record.subset = map.take("_subset").toString();
+        record.sample = DatasetSample::fromVariantMap(map, store);
+        records.append(std::move(record));
+    }
+    return records;
+}
+
+bool JSONLReader::beginRead(const QString& filePath) {
+    endRead();
+
+    file_ = std::make_unique<QFile>(filePath);
+    if (!file_->open(QIODevice::ReadOnly)) {
+        file_.reset();
+        return false;
+    }
+
+    const QString storePath = options_.value("blob_store").toString();
+    if (!storePath.isEmpty()) {
+        store_ = std::make_shared<const BlobStore>(storePath);
+    }
+
+    QByteArray pending;
+    metadata_ = DatasetMetadata();
+    readMetaLine(*file_, pending, &metadata_);
+
+    malformed_ = std::make_shared<std::atomic<qint64>>(0);
+    auto parse = [store = store_, malformed = malformed_](QByteArray chunk, qint64 firstLine) {
+        Q_UNUSED(firstLine);
+        return parseLines(chunk, store.get(), *malformed);
+    };
+    records_.start(file_.get(), std::move(pending), option("chunk_size").toLongLong(), 1,
+                   findLastLineEnd, parse);
+    return true;
+}
+
+DatasetSample JSONLReader::readNext() {
+    Record record = records_.next();
+    subset_ = record.subset;
+    return record.sample;
+}
+
+bool JSONLReader::atEnd() const {
+    return records_.atEnd();
+}
+
+bool JSONLReader::endRead() {
+    records_.clear();
+    store_.reset();
+    subset_.clear();
+    const bool wasOpen = file_ != nullptr;
+    file_.reset();
+    return wasOpen && malformedLines() == 0;
+}
+
+void JSONLReader::setOption(const QString& key, const QVariant& value) {
+    options_.insert(key, value);
+}
+
+QVariant JSONLReader::option(const QString& key) const {
+    if (key == "chunk_size") {
+        return options_.value(key, defaultChunkSize);
+    }
+    return options_.value(key);
+}
+
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include "ChunkQueue.h"
+#include "core/BlobStore.h"
+#include "core/PluginInterface.h"
+#include <QFile>
+#include <atomic>
+#include <memory>
+
+namespace DatasetCreator {
+
+/**
+ * @brief Reads JSON Lines files written by JSONLWriter
+ *
+ * Streaming returns the samples in file order and subsetName() tells
+ * which subset each came from ("_subset"); the "_meta" line gives
+ * datasetMetadata(). The file is cut into line-aligned chunks that are
+ * parsed on the global thread pool, a few chunks at a time. read()
+ * returns the first sample only; use the streaming calls, or
+ * IDataReader::streamInto() to rebuild a whole dataset.
+ *
+ * Lines that are not a JSON object are skipped and counted; endRead()
+ * then returns false, so streamInto() fails the read.
+ */
+class JSONLReader : public IDataReader {
+public:
+    QString name() const override { return "JSONLReader"; }
+    QString version() const override { return "1.0.0"; }
+    QStringList supportedExtensions() const override { return {".jsonl"}; }
+    QStringList supportedMimeTypes() const override { return {"application/jsonl"}; }
+    bool canRead(QIODevice* device) const override;
+    bool canRead(const QString& filePath) const override;
+    DatasetSample read(const QString& filePath) override;
+    QList<DatasetSample> readBatch(const QStringList& files) override;
+    bool isReentrant() const override { return true; }
+
+    // "file_name" and, if the file has a "_meta" line, "dataset" with its contents
+    QVariantMap extractMetadata(const QString& filePath) override;
+
+    bool supportsStreaming() const override { return true; }
+    bool beginRead(const QString& filePath) override;
+    DatasetSample readNext() override;
+    bool atEnd() const override;
+    bool endRead() override;
+    QString subsetName() const override { return subset_; }
+    bool providesSubsets() const override { return true; }
+
+    // From the "_meta" line of the file being streamed
+    DatasetMetadata datasetMetadata() const override { return metadata_; }
+
+    // Lines of the streamed file skipped so far as malformed
+    qint64 malformedLines() const { return malformed_ ? malformed_->load() : 0; }
+
+    // "blob_store": directory of the BlobStore the file's {"blob": hash}
+    // payloads were exported to (empty: such payloads stay empty);
+    // "chunk_size": bytes per parallel chunk, default 4 MiB
+    void setOption(const QString& key, const QVariant& value) override;
+    QVariant option(const QString& key) const override;
+
+    std::unique_ptr<IDataReader> clone() const override {
+        auto reader = std::make_unique<JSONLReader>();
+        reader->options_ = options_;
+        return reader;
+    }
+
+private:
+    struct Record {
+        DatasetSample sample;
+        QString subset;
+    };
+
+    static bool readMetaLine(QIODevice& device, QByteArray& pending, DatasetMetadata* metadata);
+    static QList<Record> parseLines(const QByteArray& chunk, const BlobStore* store,
+                                    std::atomic<qint64>& malformed);
+
+    QVariantMap options_;
+
+    // Streamed read in progress
+    std::unique_ptr<QFile> file_;
+    std::shared_ptr<const BlobStore> store_;
+    DatasetMetadata metadata_;
+    QString subset_;
+    std::shared_ptr<std::atomic<qint64>> malformed_;  // Counted by the parsing chunks
+    ChunkQueue<Record> records_;
+};
+
+}
@@ -1,11 +1,50 @@
 #include "TextReader.h"
-#include <QFile>
-#include <QTextStream>
-#include <QFileInfo>
+#include "core/Utf8.h"
 #include <QMimeDatabase>
+#include <QStringConverter>
+#include <cstring>
+#include <optional>
+#include <string_view>
 
 namespace DatasetCreator {
 
+namespace {
+
+constexpr qsizetype defaultSplitSize = 1024 * 1024;
+constexpr qint64 defaultSplitLines = 1000;
+constexpr QByteArrayView utf8ByteOrderMark = "\xef\xbb\xbf";
+
+// The whole file, mapped if it can be, else read into buffer
+QByteArrayView contents(QFile& file, QByteArray& buffer) {
+    const qint64 size = file.size();
+    if (size > 0) {
+        if (const uchar* mapped = file.map(0, size)) {
+            return QByteArrayView(reinterpret_cast<const char*>(mapped), size);
+        }
+    }
+    buffer = file.readAll();
+    return buffer;
+}
+
+// A UTF-16 or UTF-32 byte order mark
+bool isWideUnicode(QByteArrayView bytes) {
+    const std::optional<QStringConverter::Encoding> encoding = QStringConverter::encodingForData(bytes);
+    return encoding && *encoding != QStringConverter::Utf8;
+}
+
+void describe(DatasetSample& sample, const QFileInfo& info, const QDateTime& timestamp, bool valid) {
+    if (!valid) {
+        sample.metadata().attributes["invalid_utf8"] = true;
+    }
+    sample.metadata().id = info.fileName();
+    sample.metadata().sourceFile = info.filePath();
+    sample.metadata().timestamp = timestamp;
+    sample.metadata().attributes["file_size"] = info.size();
+    sample.metadata().attributes["file_extension"] = info.suffix();
+}
+
+} // namespace
+
 QStringList TextReader::supportedExtensions() const {
     return {".txt", ".text", ".md", ".markdown", ".cpp", ".h", ".hpp", ".c",
             ".py", ".js", ".java", ".cs", ".go", ".rs", ".html", ".css",
@@ -46,21 +85,15 @@ DatasetSample TextReader::read(const QString& filePath) {
     DatasetSample sample(SampleType::Text);
     
     QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    if (!file.open(QIODevice::ReadOnly)) {
         return sample;
     }
     
-    QTextStream in(&file);
-    QString content = in.readAll();
-    sample.setText(content);
-    
-    // Set metadata
-    sample.metadata().id = QFileInfo(filePath).fileName();
-    sample.metadata().sourceFile = filePath;
-    sample.metadata().timestamp = QDateTime::currentDateTime();
-    sample.metadata().attributes["file_size"] = file.size();
-    sample.metadata().attributes["file_extension"] = QFileInfo(filePath).suffix();
+    QByteArray buffer;
+    bool valid = true;
+    sample.setText(Utf8Text::fromTextFile(contents(file, buffer), &valid));
     
+    describe(sample, QFileInfo(filePath), QDateTime::currentDateTime(), valid);
     return sample;
 }
 
@@ -82,4 +115,149 @@ QVariantMap TextReader::extractMetadata(const QString& filePath) {
     return meta;
 }
 
+bool TextReader::beginRead(const QString& filePath) {
+    endRead();
+    
+    file_ = std::make_unique<QFile>(filePath);
+    if (!file_->open(QIODevice::ReadOnly)) {
+        file_.reset();
+        return false;
+    }
+    data_ = contents(*file_, buffer_);
+    info_ = QFileInfo(filePath);
+    timestamp_ = QDateTime::currentDateTime();
+    wide_ = isWideUnicode(data_);
+    offset_ = data_.startsWith(utf8ByteOrderMark) ? utf8ByteOrderMark.size() : 0;
+    
+    const QString split = option("split").toString();
+    splitSize_ = option("split_size").toLongLong();
+    splitLines_ = option("split_lines").toLongLong();
+    delimiter_ = option("split_delimiter").toString().toUtf8();
+    split_ = Split::None;
+    if (split == "size" && splitSize_ > 0) {
+        split_ = Split::Size;
+    } else if (split == "lines" && splitLines_ > 0) {
+        split_ = Split::Lines;
+    } else if (split == "delimiter" && !delimiter_.isEmpty()) {
+        split_ = Split::Delimiter;
+        while (data_.sliced(offset_).startsWith(delimiter_)) {
+            offset_ += delimiter_.size();
+        }
+    }
+    
+    piece_ = 0;
+    done_ = false;
+    return true;
+}
+
+DatasetSample TextReader::readNext() {
+    DatasetSample sample(SampleType::Text);
+    if (done_) {
+        return sample;
+    }
+    
+    bool valid = true;
+    if (wide_) {
+        sample.setText(Utf8Text::fromTextFile(data_, &valid));
+        describe(sample, info_, timestamp_, valid);
+        done_ = true;
+        return sample;
+    }
+    
+    qsizetype next = 0;
+    const qsizetype end = pieceEnd(offset_, next);
+    sample.setText(Utf8Text::fromTextMode(data_.sliced(offset_, end - offset_), &valid));
+    describe(sample, info_, timestamp_, valid);
+    if (split_ != Split::None) {
+        sample.metadata().id = QString("%1:%2").arg(info_.fileName()).arg(++piece_);
+        sample.metadata().attributes["byte_offset"] = qint64(offset_);
+    }
+    
+    offset_ = next;
+    done_ = offset_ >= data_.size();
+    return sample;
+}
+
+bool TextReader::endRead() {
+    const bool wasOpen = file_ != nullptr;
+    data_ = QByteArrayView();
+    buffer_.clear();
+    file_.reset();     // Unmaps the file
+    done_ = true;
+    return wasOpen;
+}
+
+qsizetype TextReader::pieceEnd(qsizetype from, qsizetype& next) const {
+    const char* const data = data_.data();
+    const qsizetype size = data_.size();
+    next = size;
+    
+    switch (split_) {
+    case Split::None:
+        return size;
+        
+    case Split::Size: {
+        if (size - from <= splitSize_) {
+            return size;
+        }
+        const std::string_view window(data + from, splitSize_);
+        const std::size_t lineEnd = window.rfind('\n');
+        qsizetype end = from + splitSize_;
+        if (lineEnd != std::string_view::npos) {
+            end = from + qsizetype(lineEnd) + 1;
+        } else {
+            // Do not start the next piece on a continuation byte
+            while (end > from + 1 && (uchar(data[end]) & 0xc0) == 0x80) {
+                --end;
+            }
+        }
+        next = end;
+        return end;
+    }
+    
+    case Split::Lines: {
+        qsizetype end = from;
+        for (qint64 line = 0; line < splitLines_ && end < size; ++line) {
+            const void* newline = std::memchr(data + end, '\n', size - end);
+            end = newline ? static_cast<const char*>(newline) - data + 1 : size;
+        }
+        next = end;
+        return end;
+    }
+    
+    case Split::Delimiter: {
+        const std::string_view text(data, size);
+        const std::string_view delimiter(delimiter_.constData(), delimiter_.size());
+        const std::size_t found = text.find(delimiter, from);
+        if (found == std::string_view::npos) {
+            return size;
+        }
+        // A run of delimiters makes no empty pieces
+        next = qsizetype(found + delimiter.size());
+        while (text.substr(next).starts_with(delimiter)) {
+            next += delimiter.size();
+        }
+        return qsizetype(found);
+    }
+    }
+    return size;
+}
+
+void TextReader::setOption(const QString& key, const QVariant& value) {
+    options_.insert(key, value);
+}
+
+QVariant TextReader::option(const QString& key) const {
+    if (key == "split_size") {
+        return options_.value(key, qint64(defaultSplitSize));
+    }
+    if (key == "split_lines") {
+        return options_.value(key, defaultSplitLines);
+    }
+    if (key == "split_delimiter") {
+        return options_.value(key, QString("\n\n"));
+    }
+    return options_.value(key);
+}
+
 } // namespace DatasetCreator
@@ -1,13 +1,29 @@
 #pragma once
 
 #include "core/PluginInterface.h"
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QVariantMap>
+#include <memory>
 
 namespace DatasetCreator {
 
+/**
+ * @brief Reads plain text files
+ *
+ * The file is memory-mapped and checked as UTF-8 in one vectorized pass,
+ * then kept as UTF-8: valid text is copied once from the mapping into the
+ * sample. Decoding follows Utf8Text::fromTextFile(), as text mode did:
+ * carriage returns are dropped, a UTF-8 byte order mark is skipped, and
+ * UTF-16 or UTF-32 with a byte order mark is converted. Samples holding
+ * invalid text get the attribute "invalid_utf8" and U+FFFD in place of
+ * the bad bytes.
+ */
 class TextReader : public IDataReader {
 public:
     QString name() const override { return "TextReader"; }
-    QString version() const override { return "1.0.0"; }
+    QString version() const override { return "1.1.0"; }
     QStringList supportedExtensions() const override;
     QStringList supportedMimeTypes() const override;
     
@@ -16,8 +32,54 @@ public:
     
     DatasetSample read(const QString& filePath) override;
     QList<DatasetSample> readBatch(const QStringList& files) override;
+    bool isReentrant() const override { return true; }
     
     QVariantMap extractMetadata(const QString& filePath) override;
+
+    // Without "split", one sample holding the file, as read() returns it.
+    // With it, one sample per piece; ids are "<file name>:<piece>", counting
+    // from 1, and the attribute "byte_offset" gives where the piece starts
+    bool supportsStreaming() const override { return true; }
+    bool beginRead(const QString& filePath) override;
+    DatasetSample readNext() override;
+    bool atEnd() const override { return done_; }
+    bool endRead() override;
+
+    // "split": "size", "lines" or "delimiter" (default none);
+    // "split_size": bytes per piece, cut after the last line break that fits
+    // or else between characters (default 1 MiB);
+    // "split_lines": lines per piece (default 1000);
+    // "split_delimiter": text between pieces, which is dropped (default "\n\n")
+    void setOption(const QString& key, const QVariant& value) override;
+    QVariant option(const QString& key) const override;
+
+    std::unique_ptr<IDataReader> clone() const override {
+        auto reader = std::make_unique<TextReader>();
+        reader->options_ = options_;
+        return reader;
+    }
+
+private:
+    enum class Split { None, Size, Lines, Delimiter };
+
+    qsizetype pieceEnd(qsizetype from, qsizetype& next) const;   // Piece at from; next is where the one after starts
+
+    QVariantMap options_;
+
+    // Streamed read in progress
+    std::unique_ptr<QFile> file_;
+    QByteArray buffer_;          // Contents when the file cannot be mapped
+    QByteArrayView data_;        // Mapped file or buffer_
+    QFileInfo info_;
+    QDateTime timestamp_;
+    Split split_ = Split::None;
+    qsizetype splitSize_ = 0;
+    qint64 splitLines_ = 0;
+    QByteArray delimiter_;
+    qsizetype offset_ = 0;
+    int piece_ = 0;
+    bool wide_ = false;          // UTF-16 or UTF-32, read whole
+    bool done_ = true;
 };
 
 } // namespace DatasetCreator
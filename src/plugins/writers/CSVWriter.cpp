@@ -1,31 +1,73 @@
 #include "CSVWriter.h"
-#include <QFile>
-#include <QTextStream>
 
 namespace DatasetCreator {
 
 bool CSVWriter::write(const QString& outputPath, const Dataset& dataset) {
-    QFile file(outputPath);
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+    total_ = dataset.samples().size();
+    const bool ok = streamDataset(*this, outputPath, dataset);
+    total_ = 0;
+    return ok;
+}
+
+bool CSVWriter::beginWrite(const QString& outputPath, const DatasetMetadata& metadata) {
+    Q_UNUSED(metadata);
+    
+    file_ = std::make_unique<QSaveFile>(outputPath);
+    if (!file_->open(QIODevice::WriteOnly | QIODevice::Text)) {
+        file_.reset();
         return false;
     }
-    
-    QTextStream out(&file);
+    written_ = 0;
     
     // Write header
-    out << "id,type,data,tags,labels,source_file\n";
-    
-    // Write samples
-    for (const auto& sample : dataset.samples()) {
-        out << sample.metadata().id << ",";
-        out << static_cast<int>(sample.type()) << ",";
-        out << "\"" << sample.asText().replace("\"", "\"\"") << "\",";
-        out << sample.metadata().tags.join(";") << ",";
-        out << ",";  // labels (would need more complex serialization)
-        out << sample.metadata().sourceFile << "\n";
+    const QByteArray header = "id,type,data,tags,labels,source_file\n";
+    if (file_->write(header) != header.size()) {
+        abortWrite();
+        return false;
     }
-    
     return true;
 }
 
+bool CSVWriter::writeSample(const DatasetSample& sample) {
+    if (!file_) {
+        return false;
+    }
+    
+    // Text is UTF-8 already and is quoted without converting it
+    QByteArray row = sample.metadata().id.toUtf8();
+    row += ',';
+    row += QByteArray::number(static_cast<int>(sample.type())) + ',';
+    row += '"' + sample.asUtf8Text().toByteArray().replace('"', "\"\"") + "\",";
+    row += sample.metadata().tags.join(";").toUtf8() + ',';
+    row += ',';  // labels (would need more complex serialization)
+    row += sample.metadata().sourceFile.toUtf8() + '\n';
+    
+    if (file_->write(row) != row.size()) {
+        return false;
+    }
+    return !progress_ || progress_(++written_, total_, file_->pos());
+}
+
+bool CSVWriter::writeSubset(const DatasetSubset& subset) {
+    // Subset samples are not exported, as before streaming
+    Q_UNUSED(subset);
+    return file_ != nullptr;
+}
+
+bool CSVWriter::endWrite() {
+    if (!file_) {
+        return false;
+    }
+    const bool ok = file_->commit();
+    file_.reset();
+    return ok;
+}
+
+void CSVWriter::abortWrite() {
+    if (file_) {
+        file_->cancelWriting();
+        file_.reset();
+    }
+}
+
 }
@@ -1,5 +1,7 @@
 #pragma once
 #include "core/PluginInterface.h"
+#include <QSaveFile>
+#include <memory>
 
 namespace DatasetCreator {
 class CSVWriter : public IDataWriter {
@@ -10,5 +12,24 @@ public:
     QString formatName() const override { return "CSV"; }
     QString description() const override { return "Comma-Separated Values format"; }
     bool write(const QString& outputPath, const Dataset& dataset) override;
+    
+    // One row per root sample; the format has no subset column
+    bool supportsStreaming() const override { return true; }
+    bool beginWrite(const QString& outputPath, const DatasetMetadata& metadata) override;
+    bool writeSample(const DatasetSample& sample) override;
+    bool writeSubset(const DatasetSubset& subset) override;
+    bool endWrite() override;
+    void abortWrite() override;
+    
+    void setProgressCallback(const ProgressCallback& callback) override { progress_ = callback; }
+    std::unique_ptr<IDataWriter> clone() const override { return std::make_unique<CSVWriter>(); }
+
+private:
+    ProgressCallback progress_;
+    
+    // Streamed write in progress
+    std::unique_ptr<QSaveFile> file_;
+    int written_ = 0;
+    int total_ = 0;     // Known only inside write()
 };
 }
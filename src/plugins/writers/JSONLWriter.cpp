@@ -1,41 +1,122 @@
 #include "JSONLWriter.h"
-#include <QFile>
-#include <QJsonDocument>
-#include <QTextStream>
+#include <QDir>
 
 namespace DatasetCreator {
 
 bool JSONLWriter::write(const QString& outputPath, const Dataset& dataset) {
-    QFile file(outputPath);
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+    total_ = dataset.samples().size();
+    for (const auto& subset : dataset.subsets()) {
+        total_ += subset.samples().size();
+    }
+    const bool ok = streamDataset(*this, outputPath, dataset);
+    total_ = 0;
+    return ok;
+}
+
+bool JSONLWriter::beginWrite(const QString& outputPath, const DatasetMetadata& metadata) {
+    // Renamed over the output on commit, so a cancelled or failed export
+    // leaves no partial file
+    file_ = std::make_unique<QSaveFile>(outputPath);
+    if (!file_->open(QIODevice::WriteOnly | QIODevice::Text)) {
+        file_.reset();
         return false;
     }
-    
-    QTextStream out(&file);
+    outputPath_ = outputPath;
+    blobs_.clear();
+    written_ = 0;
     
     // Write metadata as first line
-    QVariantMap metaLine;
-    metaLine["_meta"] = dataset.metadata().toVariantMap();
-    QJsonDocument metaDoc = QJsonDocument::fromVariant(metaLine);
-    out << metaDoc.toJson(QJsonDocument::Compact) << "\n";
-    
-    // Write samples
-    for (const auto& sample : dataset.samples()) {
-        QJsonDocument sampleDoc = QJsonDocument::fromVariant(sample.toVariantMap());
-        out << sampleDoc.toJson(QJsonDocument::Compact) << "\n";
+    json_.clear();
+    json_.beginObject();
+    json_.key("_meta");
+    json_.value(metadata.toVariantMap());
+    json_.endObject();
+    if (!writeBuffer()) {
+        abortWrite();
+        return false;
+    }
+    return true;
+}
+
+bool JSONLWriter::writeBuffer() {
+    const QByteArray& line = json_.buffer();
+    return file_->write(line) == line.size() && file_->putChar('\n');
+}
+
+bool JSONLWriter::writeLine(const DatasetSample& sample, const QString& subsetName) {
+    if (!file_) {
+        return false;
     }
     
-    // Write subsets
-    for (const auto& subset : dataset.subsets()) {
-        for (const auto& sample : subset.samples()) {
-            QVariantMap sampleMap = sample.toVariantMap();
-            sampleMap["_subset"] = subset.name();
-            QJsonDocument sampleDoc = QJsonDocument::fromVariant(sampleMap);
-            out << sampleDoc.toJson(QJsonDocument::Compact) << "\n";
+    // Serialized directly, as QJsonDocument would write sample.toVariantMap()
+    // with "_subset" added; that key sorts before all of the sample's
+    json_.clear();
+    json_.beginObject();
+    if (!subsetName.isNull()) {
+        json_.key("_subset");
+        json_.value(subsetName);
+    }
+    const QString blob = sample.writeJsonMembers(json_, store_.get());
+    json_.endObject();
+    if (!blob.isEmpty()) blobs_.insert(blob);
+    if (!writeBuffer()) {
+        return false;
+    }
+    return !progress_ || progress_(++written_, total_, file_->pos());
+}
+
+bool JSONLWriter::writeSample(const DatasetSample& sample) {
+    return writeLine(sample, QString());
+}
+
+bool JSONLWriter::writeSubset(const DatasetSubset& subset) {
+    for (const auto& sample : subset.samples()) {
+        if (!writeLine(sample, subset.name())) {
+            return false;
         }
     }
-    
     return true;
 }
 
+bool JSONLWriter::endWrite() {
+    if (!file_) {
+        return false;
+    }
+    const bool ok = file_->commit();
+    file_.reset();
+    if (ok && store_) {
+        store_->setReferences(outputPath_, blobs_);
+    }
+    return ok;
+}
+
+void JSONLWriter::abortWrite() {
+    if (file_) {
+        file_->cancelWriting();
+        file_.reset();
+    }
+}
+
+QVariantMap JSONLWriter::defaultOptions() const {
+    QVariantMap options;
+    options["blob_store"] = QString();
+    return options;
+}
+
+void JSONLWriter::setOptions(const QVariantMap& options) {
+    // Kept across exports so source files already stored are not hashed again
+    const QString path = options.value("blob_store").toString();
+    if (path.isEmpty()) {
+        store_.reset();
+    } else if (!store_ || store_->rootPath() != QDir(path).absolutePath()) {
+        store_ = std::make_unique<BlobStore>(path);
+    }
+}
+
+QVariantMap JSONLWriter::currentOptions() const {
+    QVariantMap options;
+    options["blob_store"] = store_ ? store_->rootPath() : QString();
+    return options;
+}
+
 }
@@ -1,5 +1,10 @@
 #pragma once
+#include "core/BlobStore.h"
+#include "core/JsonEmitter.h"
 #include "core/PluginInterface.h"
+#include <QSaveFile>
+#include <QSet>
+#include <memory>
 
 namespace DatasetCreator {
 class JSONLWriter : public IDataWriter {
@@ -10,5 +15,42 @@ public:
     QString formatName() const override { return "JSONL"; }
     QString description() const override { return "JSON Lines format (newline-delimited JSON)"; }
     bool write(const QString& outputPath, const Dataset& dataset) override;
+    
+    // One line per call; subset samples carry "_subset"
+    bool supportsStreaming() const override { return true; }
+    bool beginWrite(const QString& outputPath, const DatasetMetadata& metadata) override;
+    bool writeSample(const DatasetSample& sample) override;
+    bool writeSubset(const DatasetSubset& subset) override;
+    bool endWrite() override;
+    void abortWrite() override;
+    
+    // "blob_store": directory of a BlobStore to put payloads in and refer
+    // to by hash, instead of embedding them as base64 (empty: embed)
+    QVariantMap defaultOptions() const override;
+    void setOptions(const QVariantMap& options) override;
+    QVariantMap currentOptions() const override;
+    
+    void setProgressCallback(const ProgressCallback& callback) override { progress_ = callback; }
+    
+    std::unique_ptr<IDataWriter> clone() const override {
+        auto writer = std::make_unique<JSONLWriter>();
+        writer->setOptions(currentOptions());
+        return writer;
+    }
+
+private:
+    bool writeLine(const DatasetSample& sample, const QString& subsetName);
+    bool writeBuffer();     // json_ as one line
+    
+    std::unique_ptr<BlobStore> store_;
+    ProgressCallback progress_;
+    JsonEmitter json_;      // Reused for every line
+    
+    // Streamed write in progress
+    std::unique_ptr<QSaveFile> file_;
+    QString outputPath_;
+    QSet<QString> blobs_;
+    int written_ = 0;
+    int total_ = 0;     // Known only inside write()
 };
 }
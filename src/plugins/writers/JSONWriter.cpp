@@ -1,22 +1,151 @@
 #include "JSONWriter.h"
-#include <QFile>
-#include <QJsonDocument>
-#include <QJsonObject>
-#include <QJsonArray>
+#include <QDir>
 
 namespace DatasetCreator {
 
 bool JSONWriter::write(const QString& outputPath, const Dataset& dataset) {
-    QVariantMap rootMap = dataset.toVariantMap();
-    QJsonDocument doc = QJsonDocument::fromVariant(rootMap);
-    
-    QFile file(outputPath);
-    if (!file.open(QIODevice::WriteOnly)) {
+    total_ = dataset.samples().size();
+    for (const auto& subset : dataset.subsets()) {
+        total_ += subset.samples().size();
+    }
+    const bool ok = streamDataset(*this, outputPath, dataset);
+    total_ = 0;
+    return ok;
+}
+
+bool JSONWriter::writeSampleJson(const DatasetSample& sample, int depth, bool reference) {
+    // The sample's map nested depth levels deep, as the indented document
+    // would contain it; the caller writes the indentation of its first line
+    json_.clear(depth);
+    json_.beginObject();
+    if (reference) {
+        json_.key("ref");
+        json_.value(sample.metadata().id);
+    } else {
+        const QString blob = sample.writeJsonMembers(json_, store_.get());
+        if (!blob.isEmpty()) blobs_.insert(blob);
+    }
+    json_.endObject();
+    return writeBytes(json_.buffer());
+}
+
+bool JSONWriter::writeBytes(const QByteArray& bytes) {
+    return file_ && file_->write(bytes) == bytes.size();
+}
+
+bool JSONWriter::sampleWritten() {
+    return !progress_ || progress_(++written_, total_, file_->pos());
+}
+
+bool JSONWriter::beginWrite(const QString& outputPath, const DatasetMetadata& metadata) {
+    // Renamed over the output on commit, so a cancelled or failed export
+    // leaves no partial file
+    file_ = std::make_unique<QSaveFile>(outputPath);
+    if (!file_->open(QIODevice::WriteOnly)) {
+        file_.reset();
         return false;
     }
+    outputPath_ = outputPath;
+    blobs_.clear();
+    writtenRows_.clear();
+    samplesOpen_ = false;
+    subsetsOpen_ = false;
+    written_ = 0;
     
-    file.write(doc.toJson(QJsonDocument::Indented));
+    json_.clear(1);
+    json_.value(metadata.toVariantMap());
+    if (!writeBytes("{\n    \"metadata\": ") || !writeBytes(json_.buffer())) {
+        abortWrite();
+        return false;
+    }
     return true;
 }
 
+bool JSONWriter::writeSample(const DatasetSample& sample) {
+    if (!file_ || subsetsOpen_) {
+        return false;
+    }
+    
+    const QByteArray separator = samplesOpen_ ? ",\n        " : ",\n    \"samples\": [\n        ";
+    samplesOpen_ = true;
+    return writeBytes(separator) && writeSampleJson(sample, 2, false) && sampleWritten();
+}
+
+bool JSONWriter::writeSubset(const DatasetSubset& subset) {
+    if (!file_) {
+        return false;
+    }
+    
+    QByteArray head = samplesOpen_ ? "\n    ]" : "";
+    head += subsetsOpen_ ? ",\n" : ",\n    \"subsets\": [\n";
+    head += "        {\n            \"metadata\": ";
+    json_.clear(3);
+    json_.value(subset.metadata().toVariantMap());
+    samplesOpen_ = false;
+    subsetsOpen_ = true;
+    if (!writeBytes(head) || !writeBytes(json_.buffer()) || !writeBytes(",\n            \"samples\": [\n")) {
+        return false;
+    }
+    
+    // A sample in several subsets is written once; later subsets refer to it by ID
+    const SampleView samples = subset.samples();
+    for (int i = 0; i < samples.size(); ++i) {
+        const DatasetSample& sample = samples[i];
+        const SampleRow row = samples.rowAt(i);
+        const bool reference = writtenRows_.contains(row) && !sample.metadata().id.isEmpty();
+        writtenRows_.insert(row);
+        
+        const QByteArray separator = i > 0 ? ",\n                " : "                ";
+        if (!writeBytes(separator) || !writeSampleJson(sample, 4, reference) || !sampleWritten()) {
+            return false;
+        }
+    }
+    
+    return writeBytes(samples.isEmpty() ? "            ]\n        }" : "\n            ]\n        }");
+}
+
+bool JSONWriter::endWrite() {
+    const QByteArray tail = samplesOpen_ || subsetsOpen_ ? "\n    ]\n}\n" : "\n}\n";
+    if (!writeBytes(tail)) {
+        abortWrite();
+        return false;
+    }
+    
+    const bool ok = file_->commit();
+    file_.reset();
+    if (ok && store_) {
+        store_->setReferences(outputPath_, blobs_);
+    }
+    return ok;
+}
+
+void JSONWriter::abortWrite() {
+    if (file_) {
+        file_->cancelWriting();
+        file_.reset();
+    }
+}
+
+QVariantMap JSONWriter::defaultOptions() const {
+    QVariantMap options;
+    options["blob_store"] = QString();
+    return options;
+}
+
+void JSONWriter::setOptions(const QVariantMap& options) {
+    // Kept across exports so source files already stored are not hashed again
+    const QString path = options.value("blob_store").toString();
+    if (path.isEmpty()) {
+        store_.reset();
+    } else if (!store_ || store_->rootPath() != QDir(path).absolutePath()) {
+        store_ = std::make_unique<BlobStore>(path);
+    }
+}
+
+QVariantMap JSONWriter::currentOptions() const {
+    QVariantMap options;
+    options["blob_store"] = store_ ? store_->rootPath() : QString();
+    return options;
+}
+
 }
@@ -1,5 +1,10 @@
 #pragma once
+#include "core/BlobStore.h"
+#include "core/JsonEmitter.h"
 #include "core/PluginInterface.h"
+#include <QSaveFile>
+#include <QSet>
+#include <memory>
 
 namespace DatasetCreator {
 class JSONWriter : public IDataWriter {
@@ -10,5 +15,47 @@ public:
     QString formatName() const override { return "JSON"; }
     QString description() const override { return "Standard JSON format"; }
     bool write(const QString& outputPath, const Dataset& dataset) override;
+    
+    // Writes the document Dataset::toVariantMap() describes, byte for byte
+    // as QJsonDocument would indent it, one sample at a time
+    bool supportsStreaming() const override { return true; }
+    bool beginWrite(const QString& outputPath, const DatasetMetadata& metadata) override;
+    bool writeSample(const DatasetSample& sample) override;
+    bool writeSubset(const DatasetSubset& subset) override;
+    bool endWrite() override;
+    void abortWrite() override;
+    
+    // "blob_store": directory of a BlobStore to put payloads in and refer
+    // to by hash, instead of embedding them as base64 (empty: embed)
+    QVariantMap defaultOptions() const override;
+    void setOptions(const QVariantMap& options) override;
+    QVariantMap currentOptions() const override;
+    
+    void setProgressCallback(const ProgressCallback& callback) override { progress_ = callback; }
+    
+    std::unique_ptr<IDataWriter> clone() const override {
+        auto writer = std::make_unique<JSONWriter>();
+        writer->setOptions(currentOptions());
+        return writer;
+    }
+
+private:
+    bool writeSampleJson(const DatasetSample& sample, int depth, bool reference);
+    bool writeBytes(const QByteArray& bytes);
+    bool sampleWritten();
+    
+    std::unique_ptr<BlobStore> store_;
+    ProgressCallback progress_;
+    JsonEmitter json_{JsonEmitter::Style::Indented};  // Reused for every sample
+    
+    // Streamed write in progress
+    std::unique_ptr<QSaveFile> file_;
+    QString outputPath_;
+    QSet<QString> blobs_;
+    QSet<SampleRow> writtenRows_;   // Subset samples already written in full
+    bool samplesOpen_ = false;
+    bool subsetsOpen_ = false;
+    int written_ = 0;
+    int total_ = 0;     // Known only inside write()
 };
 }
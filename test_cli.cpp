@@ -1,10 +1,19 @@
+#include "core/BlobStore.h"
 #include "core/Dataset.h"
+#include "core/JsonEmitter.h"
+#include "core/PayloadCache.h"
 #include "plugins/PluginManager.h"
 #include "managers/ImportManager.h"
 #include "managers/ExportManager.h"
 #include <QCoreApplication>
 #include <QDebug>
 #include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QJsonDocument>
+#include <QTemporaryDir>
+#include <cmath>
+#include <cstring>
 
 using namespace DatasetCreator;
 
@@ -49,10 +58,142 @@ int main(int argc, char *argv[]) {
         }
     }
     
+    // Streamed CSV: one sample per row, with quoting that spans lines and
+    // chunks small enough that rows straddle them
+    IDataReader* csvReader = pluginManager.getReaderForFile("rows.csv");
+    QTemporaryDir csvDir;
+    if (csvReader && csvDir.isValid()) {
+        const QString csvPath = csvDir.filePath("rows.csv");
+        QFile csv(csvPath);
+        QByteArray content = "text,label,source\r\n";
+        for (int i = 0; i < 2000; ++i) {
+            content += QString("\"row %1, \"\"quoted\"\"\nsecond line\",%2,gen\r\n").arg(i).arg(i % 3).toUtf8();
+        }
+        if (csv.open(QIODevice::WriteOnly)) {
+            csv.write(content);
+            csv.close();
+        }
+
+        std::unique_ptr<IDataReader> rows = csvReader->clone();
+        rows->setOption("chunk_size", 1024);
+        QList<DatasetSample> parsed;
+        if (rows->beginRead(csvPath)) {
+            while (!rows->atEnd()) {
+                parsed.append(rows->readNext());
+            }
+            rows->endRead();
+        }
+        const bool rowsMatch = parsed.size() == 2000
+            && parsed.last().asText() == "row 1999, \"quoted\"\nsecond line"
+            && parsed.last().metadata().labels.value("label").toString() == "1"
+            && parsed.last().metadata().attributes.value("source").toString() == "gen"
+            && parsed.last().metadata().id == "rows.csv:2000";
+        qDebug() << "   Streamed CSV rows:" << parsed.size() << (rowsMatch ? "MATCH" : "MISMATCH");
+    }
+
+    // Text split into pieces of 100 lines, with CRLF endings and multibyte text
+    IDataReader* textReader = pluginManager.getReaderForFile("log.txt");
+    if (textReader && csvDir.isValid()) {
+        const QString logPath = csvDir.filePath("log.txt");
+        QFile log(logPath);
+        QByteArray content = "\xef\xbb\xbf";
+        for (int i = 0; i < 1000; ++i) {
+            content += QString("line %1 caf\u00e9 \u2192 \U0001F600\r\n").arg(i).toUtf8();
+        }
+        if (log.open(QIODevice::WriteOnly)) {
+            log.write(content);
+            log.close();
+        }
+
+        std::unique_ptr<IDataReader> pieces = textReader->clone();
+        pieces->setOption("split", "lines");
+        pieces->setOption("split_lines", 100);
+        QList<DatasetSample> parsed;
+        if (pieces->beginRead(logPath)) {
+            while (!pieces->atEnd()) {
+                parsed.append(pieces->readNext());
+            }
+            pieces->endRead();
+        }
+        const QString whole = textReader->read(logPath).asText();
+        QString joined;
+        for (const DatasetSample& piece : parsed) {
+            joined += piece.asText();
+        }
+        const bool piecesMatch = parsed.size() == 10 && joined == whole
+            && whole.startsWith("line 0 caf\u00e9") && !whole.contains(u'\r')
+            && parsed.last().metadata().id == "log.txt:10"
+            && !parsed.last().metadata().attributes.contains("invalid_utf8")
+            && parsed.first().asUtf8Text().utf8().startsWith("line 0 caf\xc3\xa9");
+        qDebug() << "   Split text pieces:" << parsed.size() << (piecesMatch ? "MATCH" : "MISMATCH");
+    }
+
+    // One second of 44.1 kHz stereo tone, streamed as 16 kHz mono in quarter seconds
+    IDataReader* audioReader = pluginManager.getReaderForFile("tone.wav");
+    if (audioReader && csvDir.isValid()) {
+        const QString tonePath = csvDir.filePath("tone.wav");
+        const quint32 rate = 44100;
+        QByteArray pcm(rate * 4, Qt::Uninitialized);
+        for (quint32 i = 0; i < rate; ++i) {
+            const qint16 sample = qint16(16000 * std::sin(2 * 3.14159265 * 440 * i / rate));
+            std::memcpy(pcm.data() + 4 * i, &sample, 2);
+            std::memcpy(pcm.data() + 4 * i + 2, &sample, 2);
+        }
+        QByteArray header = "RIFF";
+        const auto put = [&](quint32 value, int bytes) {
+            for (int b = 0; b < bytes; ++b) {
+                header += char(value >> (8 * b));
+            }
+        };
+        put(36 + pcm.size(), 4);
+        header += "WAVEfmt ";
+        put(16, 4);
+        put(1, 2);          // PCM
+        put(2, 2);
+        put(rate, 4);
+        put(rate * 4, 4);
+        put(4, 2);
+        put(16, 2);
+        header += "data";
+        put(pcm.size(), 4);
+        QFile tone(tonePath);
+        if (tone.open(QIODevice::WriteOnly)) {
+            tone.write(header + pcm);
+            tone.close();
+        }
+
+        std::unique_ptr<IDataReader> chunks = audioReader->clone();
+        chunks->setOption("sample_rate", 16000);
+        chunks->setOption("channels", 1);
+        chunks->setOption("chunk_ms", 250);
+        QList<DatasetSample> parsed;
+        if (chunks->beginRead(tonePath)) {
+            while (!chunks->atEnd()) {
+                parsed.append(chunks->readNext());
+            }
+            chunks->endRead();
+        }
+        bool chunksMatch = parsed.size() == 4 && parsed.last().metadata().id == "tone.wav:4"
+            && parsed.last().metadata().attributes.value("offset_ms").toLongLong() == 750;
+        for (const DatasetSample& chunk : parsed) {
+            const AudioData audio = chunk.asAudio();
+            chunksMatch = chunksMatch && audio.format.sampleRate() == 16000 && audio.format.channelCount() == 1
+                && audio.format.sampleFormat() == QAudioFormat::Int16 && audio.samples.size() == 4000 * 2
+                && audio.durationMs == 250;
+        }
+        const AudioData whole = audioReader->read(tonePath).asAudio();
+        chunksMatch = chunksMatch && whole.samples == pcm && whole.durationMs == 1000;
+        qDebug() << "   Resampled audio chunks:" << parsed.size() << (chunksMatch ? "MATCH" : "MISMATCH");
+    }
+
     qDebug() << "\n4. Dataset statistics:";
     qDebug() << "   Total samples:" << dataset.totalSampleCount();
     qDebug() << "   Total size:" << dataset.totalSize() << "bytes";
     
+    // Images are file-backed and exported as their original bytes, so the
+    // exports below should not need to decode any of them
+    PayloadCache::instance().resetCounters();
+    
     // Test exporting to different formats
     qDebug() << "\n5. Exporting dataset...";
     
@@ -61,6 +202,31 @@ int main(int argc, char *argv[]) {
     if (jsonlWriter) {
         bool success = jsonlWriter->write("output.jsonl", dataset);
         qDebug() << "   JSONL export:" << (success ? "SUCCESS" : "FAILED");
+        
+        // Lines are serialized directly, but read the same as QJsonDocument's
+        QFile lines("output.jsonl");
+        bool linesMatch = lines.open(QIODevice::ReadOnly) && !lines.readLine().isEmpty();
+        for (const DatasetSample& sample : dataset.samples()) {
+            linesMatch = linesMatch && lines.readLine().trimmed()
+                == QJsonDocument::fromVariant(sample.toVariantMap()).toJson(QJsonDocument::Compact);
+        }
+        qDebug() << "   JSONL matches QJsonDocument:" << linesMatch;
+    }
+    
+    // Escapes, non-ASCII text and number formats
+    QVariantMap tricky;
+    tricky["text"] = QString::fromUtf8("tab\t \"quoted\" back\\slash \x01 caf\xc3\xa9 \xf0\x9f\x98\x80") + QChar(0xd800);
+    tricky["numbers"] = QVariantList{0.1, 1e-5, 0.0001, 0.00012, 1.5e-5, 100000.0, 1200000.0, 12000000.0,
+                                     12300000.0, 123000000.0, 1e21, -2.5, qint64(1) << 60};
+    tricky["flags"] = QVariantList{true, false, QVariant()};
+    tricky["empty"] = QVariantMap();
+    JsonEmitter emitter(JsonEmitter::Style::Indented);
+    emitter.value(tricky);
+    const QByteArray trickyExpected = QJsonDocument::fromVariant(tricky).toJson(QJsonDocument::Indented);
+    const bool emitterMatches = emitter.buffer() + '\n' == trickyExpected;
+    qDebug() << "   Emitter matches QJsonDocument:" << (emitterMatches ? "MATCH" : "MISMATCH");
+    if (!emitterMatches) {
+        qDebug().noquote() << emitter.buffer() << "\n   expected:\n" << trickyExpected;
     }
     
     // Export to JSON
@@ -68,6 +234,12 @@ int main(int argc, char *argv[]) {
     if (jsonWriter) {
         bool success = jsonWriter->write("output.json", dataset);
         qDebug() << "   JSON export:" << (success ? "SUCCESS" : "FAILED");
+        
+        // Streamed output matches the document built in memory
+        QFile written("output.json");
+        const QByteArray expected = QJsonDocument::fromVariant(dataset.toVariantMap()).toJson(QJsonDocument::Indented);
+        qDebug() << "   JSON matches in-memory document:"
+                 << (written.open(QIODevice::ReadOnly) && written.readAll() == expected);
     }
     
     // Export to CSV
@@ -77,6 +249,40 @@ int main(int argc, char *argv[]) {
         qDebug() << "   CSV export:" << (success ? "SUCCESS" : "FAILED");
     }
     
+    // Export to JSONL with payloads in a blob store; exporting again stores nothing new
+    QTemporaryDir storeDir;
+    if (jsonlWriter && storeDir.isValid()) {
+        auto countBlobs = [&storeDir]() {
+            int count = 0;
+            QDirIterator it(storeDir.path() + "/objects", QDir::Files, QDirIterator::Subdirectories);
+            while (it.hasNext()) {
+                it.next();
+                ++count;
+            }
+            return count;
+        };
+        
+        QVariantMap options;
+        options["blob_store"] = storeDir.path();
+        jsonlWriter->setOptions(options);
+        bool success = jsonlWriter->write("output.blobs.jsonl", dataset);
+        const int firstCount = countBlobs();
+        success = jsonlWriter->write("output.blobs.jsonl", dataset) && success;
+        qDebug() << "   JSONL export with blob store:" << (success ? "SUCCESS" : "FAILED")
+                 << "-" << firstCount << "blobs, then" << countBlobs() << "after re-export";
+        
+        // Once the removed export is forgotten, nothing refers to the blobs
+        QFile::remove("output.blobs.jsonl");
+        BlobStore store(storeDir.path());
+        store.removeReferences("output.blobs.jsonl");
+        qDebug() << "   Blobs collected after removing the export:" << store.collectGarbage(0).removedBlobs;
+        jsonlWriter->setOptions(QVariantMap());
+    }
+    
+    qDebug() << "   Payload cache:" << PayloadCache::instance().hits() << "hits,"
+             << PayloadCache::instance().misses() << "misses,"
+             << PayloadCache::instance().bytesUsed() << "bytes resident";
+    
     qDebug() << "\n6. Checking output files:";
     QDir currentDir(".");
     QStringList outputs = currentDir.entryList(QStringList() << "output.*", QDir::Files);
@@ -87,5 +293,5 @@ int main(int argc, char *argv[]) {
     
     qDebug() << "\n=== Test Complete ===";
     
-    return 0;
+    return emitterMatches ? 0 : 1;
 }
@@ -74,6 +74,14 @@ int main(int argc, char *argv[]) {
     qDebug() << "  Sample 1 labels after add:" << dataset.samples()[1].metadata().labels;
     qDebug() << "";
     
+    // Running statistics follow the updates above
+    qDebug() << "Testing running statistics...";
+    qDebug() << "  Label keys:" << dataset.labelCounts().keys();
+    qDebug() << "  sentiment values:" << dataset.labelCounts().valueCounts("sentiment");
+    qDebug() << "  Total size:" << dataset.totalSize() << "bytes";
+    qDebug() << "  Text samples:" << dataset.rootStats().typeCount(SampleType::Text);
+    qDebug() << "";
+    
     // Test with invalid index
     qDebug() << "Testing with invalid index (999)...";
     result = dataset.updateSampleTags(999, tags1);
@@ -1,11 +1,16 @@
 #include <QCoreApplication>
 #include <QDebug>
 #include <QFile>
+#include <QJsonDocument>
+#include <QTemporaryDir>
 #include <QTextStream>
 #include "src/core/Dataset.h"
 #include "src/core/DatasetSample.h"
+#include "src/core/PayloadCache.h"
 #include "src/plugins/PluginManager.h"
+#include "src/plugins/readers/JSONLReader.h"
 #include "src/managers/ExportManager.h"
+#include "src/managers/ProjectManager.h"
 
 using namespace DatasetCreator;
 
@@ -77,6 +82,151 @@ int main(int argc, char *argv[]) {
     }
     qDebug() << "";
     
+    // Lookup and move by sample ID
+    qDebug() << "Testing ID index...";
+    Dataset::SampleLocation location = dataset.findSample("sample_8");
+    qDebug() << "  sample_8 location:" << location.subsetName << location.index;
+    dataset.moveSampleById("sample_8", "test");
+    location = dataset.findSample("sample_8");
+    qDebug() << "  sample_8 after move:" << location.subsetName << location.index;
+    dataset.moveSampleById("sample_8", "validation");
+    
+    DatasetSample duplicate(SampleType::Text);
+    duplicate.setText("Duplicate ID");
+    duplicate.metadata().id = "sample_0";
+    dataset.addSample(duplicate);
+    qDebug() << "  Duplicate ID stored as:" << dataset.samples().last().metadata().id;
+    dataset.removeSample(dataset.sampleCount() - 1);
+    qDebug() << "";
+    
+    // Shared membership: one stored sample, referenced by two subsets
+    qDebug() << "Testing shared subset membership...";
+    dataset.addSampleToSubset("sample_0", "test");
+    qDebug() << "  Distinct samples:" << dataset.totalSampleCount();
+    qDebug() << "  test subset count:" << dataset.getSubset("test")->sampleCount();
+    Dataset reloaded = Dataset::fromVariantMap(dataset.toVariantMap());
+    qDebug() << "  Distinct samples after round trip:" << reloaded.totalSampleCount();
+    dataset.moveSampleById("sample_0", "training");
+    qDebug() << "";
+    
+    // Bulk operations: indices refer to positions before the call
+    qDebug() << "Testing bulk operations...";
+    int movedBack = dataset.moveSamplesFromSubset("training", {6, 0, 3, 3});
+    qDebug() << "  Moved back to root:" << movedBack << "root now:" << dataset.sampleCount();
+    int tagged = dataset.addTagToSamples({0, 1, 2}, "bulk");
+    qDebug() << "  Tagged:" << tagged;
+    int movedOut = dataset.moveSamplesToSubset({0, 1, 2}, "training");
+    qDebug() << "  Moved to training:" << movedOut << "training now:"
+             << dataset.getSubset("training")->sampleCount();
+    qDebug() << "";
+    
+    // Binary project round trip keeps samples and memberships
+    qDebug() << "Testing project save/load...";
+    ProjectManager projectManager;
+    Dataset fromProject;
+    bool saved = projectManager.saveProject(dataset, "test_subsets_project.dscp");
+    bool loaded = saved && projectManager.loadProject("test_subsets_project.dscp", fromProject);
+    qDebug() << "  Saved:" << saved << "Loaded:" << loaded;
+    qDebug() << "  Distinct samples:" << fromProject.totalSampleCount() << "expected:" << dataset.totalSampleCount();
+    qDebug() << "  Root samples:" << fromProject.sampleCount() << "expected:" << dataset.sampleCount();
+    for (const auto& subset : dataset.subsets()) {
+        const DatasetSubset* copy = fromProject.getSubset(subset.name());
+        qDebug() << "  " << subset.name() << ":" << (copy ? copy->sampleCount() : -1)
+                 << "expected:" << subset.sampleCount();
+    }
+    
+    // A second save only appends the changes to the journal
+    dataset.addSampleTag(0, "journaled");
+    dataset.moveSamplesToSubset({1}, "validation");
+    bool appended = projectManager.saveProject(dataset, "test_subsets_project.dscp");
+    Dataset replayed;
+    projectManager.loadProject("test_subsets_project.dscp", replayed);
+    qDebug() << "  Journaled save:" << appended
+             << "journal size:" << QFile("test_subsets_project.dscp.journal").size();
+    bool replayMatches = replayed.sampleCount() == dataset.sampleCount()
+        && replayed.totalSampleCount() == dataset.totalSampleCount();
+    for (const auto& subset : dataset.subsets()) {
+        const DatasetSubset* copy = replayed.getSubset(subset.name());
+        replayMatches = replayMatches && copy && copy->sampleCount() == subset.sampleCount();
+    }
+    qDebug() << "  Replayed tag:" << (replayed.getSample(0) && replayed.getSample(0)->metadata().tags.contains("journaled"))
+             << "root samples:" << replayed.sampleCount() << "expected:" << dataset.sampleCount()
+             << (replayMatches ? "MATCH" : "MISMATCH");
+
+    // Samples shared by subsets keep every membership, whatever their ids
+    {
+        QTemporaryDir projectDir;
+        ProjectManager sharedManager;
+        sharedManager.setJournaling(false);
+        Dataset shared("Shared");
+        DatasetSample unnamed(SampleType::Text);
+        unnamed.setText("no id");
+        shared.addSample(unnamed, QStringList{"first", "second"});
+        shared.addSample(unnamed, QStringList{"second", "third"});
+        Dataset opened;
+        const QString path = projectDir.filePath("shared.dscp");
+        const bool reopened = sharedManager.saveProject(shared, path) && sharedManager.loadProject(path, opened);
+        bool sharedMatches = opened.totalSampleCount() == 2 && opened.sampleCount() == 0;
+        for (const auto& subset : shared.subsets()) {
+            const DatasetSubset* copy = opened.getSubset(subset.name());
+            sharedMatches = sharedMatches && copy && copy->sampleCount() == subset.sampleCount();
+        }
+        qDebug() << "  Shared samples without ids:" << reopened << (sharedMatches ? "MATCH" : "MISMATCH");
+    }
+
+    // Stored payloads stay in the store until they are accessed
+    {
+        QTemporaryDir storeDir;
+        BlobStore store(storeDir.filePath("blobs"));
+        ProjectManager lazyManager;
+        lazyManager.setBlobStore(&store);
+        Dataset large("Large");
+        DatasetSample text(SampleType::Text);
+        text.setText(QString(8192, 'x'));
+        text.metadata().id = "large_text";
+        large.addSample(text);
+        Dataset opened;
+        const QString path = storeDir.filePath("large.dscp");
+        bool reopened = lazyManager.saveProject(large, path) && lazyManager.loadProject(path, opened);
+        const DatasetSample* lazyText = opened.getSample(0);
+        qDebug() << "  Lazy open:" << reopened << "file-backed:" << (lazyText && lazyText->isFileBacked())
+                 << "text intact:" << (lazyText && lazyText->asText() == text.asText());
+        lazyManager.collectGarbage();  // The manager waits for it before the store goes
+    }
+    
+    // Inline payloads are read from the project file, and survive a save replacing it
+    {
+        QTemporaryDir projectDir;
+        ProjectManager inlineManager;
+        inlineManager.setJournaling(false);
+        Dataset large("Large");
+        DatasetSample text(SampleType::Text);
+        text.setText(QString(8192, 'y'));
+        text.metadata().id = "inline_text";
+        large.addSample(text);
+        Dataset opened;
+        const QString path = projectDir.filePath("inline.dscp");
+        bool reopened = inlineManager.saveProject(large, path) && inlineManager.loadProject(path, opened);
+        opened.addSample(DatasetSample(SampleType::Binary));
+        reopened = reopened && inlineManager.saveProject(opened, path);
+        PayloadCache::instance().clear();
+        const DatasetSample* inlineText = opened.getSample(0);
+        qDebug() << "  Inline open:" << reopened << "file-backed:" << (inlineText && inlineText->isFileBacked())
+                 << "text intact after resave:" << (inlineText && inlineText->asText() == text.asText());
+    }
+    qDebug() << "";
+    
+    // A snapshot keeps its contents while the dataset changes
+    qDebug() << "Testing snapshots...";
+    std::shared_ptr<const Dataset> snapshot = dataset.snapshot();
+    const int snapshotRoot = snapshot->sampleCount();
+    dataset.addSampleTag(0, "after_snapshot");
+    dataset.moveSamplesToSubset({0}, "test");
+    qDebug() << "  Snapshot root samples:" << snapshot->sampleCount() << "expected:" << snapshotRoot;
+    qDebug() << "  Snapshot tags unchanged:"
+             << !snapshot->getSample(0)->metadata().tags.contains("after_snapshot");
+    qDebug() << "";
+    
     // Export to JSONL
     qDebug() << "Exporting to JSONL...";
     PluginManager pluginManager;
@@ -85,6 +235,110 @@ int main(int argc, char *argv[]) {
     bool exportResult = exportManager.exportDataset(dataset, "test_subsets_output.jsonl", "jsonl");
     qDebug() << "  Export result:" << exportResult;
     
+    // A cancelled background export leaves no file behind
+    BackgroundJob* cancelledExport = exportManager.exportDatasetAsync(dataset, "test_subsets_cancelled.jsonl", "jsonl");
+    cancelledExport->cancel();
+    cancelledExport->wait();
+    qDebug() << "  Cancelled export left a file:" << QFile::exists("test_subsets_cancelled.jsonl") << "expected: false";
+    
+    // Sharded export: one set of shards per subset, plus a manifest
+    {
+        QTemporaryDir shardDir;
+        ExportManager::ShardOptions shardOptions;
+        shardOptions.shardCount = 2;
+        shardOptions.perSubset = true;
+        bool sharded = exportManager.exportSharded(dataset, shardDir.filePath("shards.jsonl"), "jsonl", shardOptions);
+        QFile manifestFile(shardDir.filePath("shards.manifest.json"));
+        const QVariantMap manifest = manifestFile.open(QIODevice::ReadOnly)
+            ? QJsonDocument::fromJson(manifestFile.readAll()).toVariant().toMap() : QVariantMap();
+        qDebug() << "  Sharded export:" << sharded << "shards:" << manifest.value("shards").toList().size()
+                 << "samples:" << manifest.value("samples").toInt()
+                 << "training shard exists:" << QFile::exists(shardDir.filePath("training-00000-of-00002.jsonl"));
+        
+        // A subset named like the output gets shards of its own
+        Dataset clash("Clash");
+        DatasetSample rootSample(SampleType::Text);
+        rootSample.setText("root");
+        rootSample.metadata().id = "same";
+        clash.addSample(rootSample);
+        clash.addSample(rootSample, "Clash");
+        shardOptions.shardCount = 1;
+        sharded = exportManager.exportSharded(clash, shardDir.filePath("clash.jsonl"), "jsonl", shardOptions);
+        qDebug() << "  Clashing shard names:" << sharded
+                 << (QFile::exists(shardDir.filePath("clash-00000-of-00001.jsonl")) &&
+                     QFile::exists(shardDir.filePath("Clash_2-00000-of-00001.jsonl")) ? "MATCH" : "MISMATCH");
+        
+        // Two subsets in one JSON shard read back with all their own samples
+        Dataset pair("Pair");
+        for (int i = 0; i < 4; ++i) {
+            DatasetSample member(SampleType::Text);
+            member.setText(QString("member %1").arg(i));
+            member.metadata().id = QString("member_%1").arg(i);
+            pair.addSample(member, i < 2 ? "first" : "second");
+        }
+        ExportManager::ShardOptions pairOptions;
+        sharded = exportManager.exportSharded(pair, shardDir.filePath("pair.json"), "json", pairOptions);
+        QFile pairFile(shardDir.filePath("pair-00000-of-00001.json"));
+        const Dataset pairBack = pairFile.open(QIODevice::ReadOnly)
+            ? Dataset::fromVariantMap(QJsonDocument::fromJson(pairFile.readAll()).toVariant().toMap()) : Dataset();
+        const DatasetSubset* second = pairBack.getSubset("second");
+        const bool pairMatches = second && second->sampleCount() == 2 &&
+                                 second->samples()[0].metadata().id == "member_2" &&
+                                 second->samples()[1].asText() == "member 3";
+        qDebug() << "  Two-subset JSON shard:" << sharded << (pairMatches ? "MATCH" : "MISMATCH");
+    }
+    
+    // Re-import: the export streams back with its metadata and subsets
+    IDataReader* jsonlReader = pluginManager.getReaderForFile("test_subsets_output.jsonl");
+    if (exportResult && jsonlReader) {
+        std::unique_ptr<IDataReader> reader = jsonlReader->clone();
+        reader->setOption("chunk_size", 1024);
+        Dataset reimported;
+        const bool streamed = IDataReader::streamInto(*reader, "test_subsets_output.jsonl", reimported);
+        bool subsetsMatch = reimported.subsetCount() == dataset.subsetCount();
+        for (const auto& subset : dataset.subsets()) {
+            const DatasetSubset* copy = reimported.getSubset(subset.name());
+            subsetsMatch = subsetsMatch && copy && copy->sampleCount() == subset.sampleCount();
+        }
+        const QVariantMap header = jsonlReader->extractMetadata("test_subsets_output.jsonl");
+        qDebug() << "  Re-imported JSONL:" << streamed
+                 << "root samples:" << reimported.sampleCount() << "expected:" << dataset.sampleCount()
+                 << "subsets match:" << subsetsMatch
+                 << "name:" << header.value("dataset").toMap().value("name").toString();
+
+        // A second import adds copies instead of merging with the first
+        Dataset twice = reimported;
+        IDataReader::streamInto(*reader, "test_subsets_output.jsonl", twice);
+        bool copiesAdded = twice.totalSampleCount() == 2 * reimported.totalSampleCount();
+        for (const auto& subset : reimported.subsets()) {
+            const DatasetSubset* copy = twice.getSubset(subset.name());
+            copiesAdded = copiesAdded && copy && copy->sampleCount() == 2 * subset.sampleCount();
+        }
+        Dataset merged;
+        merged.merge(reimported);
+        merged.merge(reimported);
+        copiesAdded = copiesAdded && merged.totalSampleCount() == twice.totalSampleCount();
+        qDebug() << "  Imported twice:" << twice.totalSampleCount() << "samples"
+                 << (copiesAdded ? "MATCH" : "MISMATCH");
+
+        // A malformed line fails the read instead of vanishing
+        QTemporaryDir brokenDir;
+        const QString brokenPath = brokenDir.filePath("broken.jsonl");
+        QFile broken(brokenPath);
+        if (broken.open(QIODevice::WriteOnly)) {
+            QFile source("test_subsets_output.jsonl");
+            source.open(QIODevice::ReadOnly);
+            broken.write(source.readAll() + "{\"type\": \"text\",\n\n");
+            broken.close();
+        }
+        Dataset partial;
+        const bool brokenRead = IDataReader::streamInto(*reader, brokenPath, partial);
+        const auto* jsonl = dynamic_cast<const JSONLReader*>(reader.get());
+        const qint64 skipped = jsonl ? jsonl->malformedLines() : -1;
+        qDebug() << "  Malformed JSONL line:" << brokenRead << "skipped:" << skipped
+                 << (!brokenRead && skipped == 1 ? "MATCH" : "MISMATCH");
+    }
+    
     if (exportResult) {
         qDebug() << "\n=== Contents of test_subsets_output.jsonl ===";
         QFile file("test_subsets_output.jsonl");